@@ -274,5 +274,9 @@ namespace steemit {
             return _app.p2p_node()->set_advanced_node_parameters(params);
         }
 
+        fc::variant network_node_api::get_metrics() const {
+            return _app.p2p_node()->get_metrics();
+        }
+
     }
 } // steemit::app
@@ -0,0 +1,48 @@
+#include <steemit/app/api_worker_pool.hpp>
+
+#include <fc/log/logger.hpp>
+
+namespace steemit {
+    namespace app {
+
+        api_worker_pool::api_worker_pool(uint32_t thread_count, const std::string &name)
+                : _name(name) {
+            _workers.reserve(thread_count);
+            for (uint32_t i = 0; i < thread_count; ++i) {
+                std::unique_ptr<worker> w(new worker);
+                w->thread = std::make_shared<fc::thread>(name + " " + std::to_string(i));
+                _workers.push_back(std::move(w));
+            }
+
+            if (thread_count) {
+                ilog("Started ${n} ${name} threads", ("n", thread_count)("name", name));
+            }
+        }
+
+        api_worker_pool::~api_worker_pool() {
+            for (auto &w : _workers) {
+                w->thread->quit();
+            }
+        }
+
+        bool api_worker_pool::in_worker() const {
+            for (const auto &w : _workers) {
+                if (w->thread->is_current()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        api_worker_pool::worker &api_worker_pool::least_loaded() {
+            worker *result = _workers.front().get();
+            for (auto &w : _workers) {
+                if (w->pending.load() < result->pending.load()) {
+                    result = w.get();
+                }
+            }
+            return *result;
+        }
+
+    }
+}
@@ -22,6 +22,10 @@
  * THE SOFTWARE.
  */
 #include <steemit/app/api.hpp>
+#include <steemit/app/discussion_cache.hpp>
+#include <steemit/app/api_worker_pool.hpp>
+#include <steemit/app/transaction_admission.hpp>
+#include <steemit/app/replica_channel.hpp>
 
 #include <steemit/chain/database_exceptions.hpp>
 
@@ -32,6 +36,7 @@
 #include <fc/smart_ref_impl.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/network/http/server.hpp>
 #include <fc/network/resolve.hpp>
 
 #include <boost/algorithm/string.hpp>
@@ -54,6 +59,7 @@ namespace steemit {
         using protocol::block_header;
         using protocol::signed_block_header;
         using protocol::signed_block;
+        using protocol::signed_transaction;
         using protocol::block_id_type;
 
         using std::vector;
@@ -79,6 +85,13 @@ namespace steemit {
                         _p2p_network->load_configuration(data_dir / "p2p");
                         _p2p_network->set_node_delegate(this);
 
+                        // set before the first connection is made, connections keep the thread they were given
+                        if (_options->count("p2p-io-threads")) {
+                            _p2p_network->set_advanced_node_parameters(fc::variant_object(
+                                    "io_thread_count",
+                                    fc::variant(_options->at("p2p-io-threads").as<uint32_t>())));
+                        }
+
                         if (_options->count("seed-node")) {
                             auto seeds = _options->at("seed-node").as<vector<string>>();
                             for (const string &endpoint_string : seeds) {
@@ -124,6 +137,39 @@ namespace steemit {
                     } FC_CAPTURE_AND_RETHROW()
                 }
 
+                void reset_metrics_server() {
+                    try {
+                        if (!_options->count("p2p-metrics-endpoint") || !_p2p_network) {
+                            return;
+                        }
+
+                        _metrics_server = std::make_shared<fc::http::server>();
+
+                        auto metrics_endpoint = _options->at("p2p-metrics-endpoint").as<string>();
+                        if (metrics_endpoint.find(':') == std::string::npos) {
+                            // a bare port is served on localhost only, the metrics aren't authenticated
+                            metrics_endpoint = "127.0.0.1:" + metrics_endpoint;
+                        }
+                        ilog("Configured p2p metrics to be served on ${ip}", ("ip", metrics_endpoint));
+                        auto endpoints = resolve_string_to_ip_endpoints(metrics_endpoint);
+                        FC_ASSERT(endpoints.size(), "p2p-metrics-endpoint ${hostname} did not resolve", ("hostname", metrics_endpoint));
+                        if (endpoints[0].get_address() != fc::ip::address("127.0.0.1")) {
+                            wlog("p2p metrics are served without authentication on ${ip}, "
+                                 "make sure it can't be reached from untrusted networks", ("ip", endpoints[0]));
+                        }
+                        _metrics_server->listen(endpoints[0]);
+                        // due to implementation, on_request() must come AFTER listen()
+                        _metrics_server->on_request(
+                                [this](const fc::http::request &req, const fc::http::server::response &resp) {
+                                    std::string text = _p2p_network ? _p2p_network->get_metrics_text() : std::string();
+                                    resp.add_header("Content-Type", "text/plain; version=0.0.4");
+                                    resp.set_status(fc::http::reply::OK);
+                                    resp.set_length(text.size());
+                                    resp.write(text.c_str(), text.size());
+                                });
+                    } FC_CAPTURE_AND_RETHROW()
+                }
+
                 std::vector<fc::ip::endpoint> resolve_string_to_ip_endpoints(const std::string &endpoint_string) {
                     try {
                         string::size_type colon_pos = endpoint_string.find(':');
@@ -236,6 +282,9 @@ namespace steemit {
                             _chain_db->set_require_locking(true);
                         }
 
+                        _chain_db->locks().set_writer_priority(_options->at("read-lock-writer-priority").as<bool>());
+                        _chain_db->locks().set_read_quantum(fc::milliseconds(_options->at("read-lock-quantum").as<uint32_t>()));
+
                         if (_options->count("shared-file-dir")) {
                             _shared_dir = fc::path(_options->at("shared-file-dir").as<string>());
                         } else {
@@ -315,6 +364,32 @@ namespace steemit {
                             }
                         }
 
+                        auto discussion_cache_size = _options->at("discussion-cache-size").as<uint32_t>();
+                        if (discussion_cache_size) {
+                            _discussion_cache = std::make_shared<discussion_cache>(*_chain_db, discussion_cache_size);
+                            _discussion_cache->connect();
+                        }
+
+                        _api_worker_pool = std::make_shared<api_worker_pool>(_options->at("api-worker-threads").as<uint32_t>());
+                        _transaction_admission = std::make_shared<transaction_admission_queue>(*_chain_db,
+                                _options->at("transaction-admission-threads").as<uint32_t>(),
+                                _options->at("transaction-admission-batch").as<uint32_t>());
+
+                        if (_options->count("replica-endpoint")) {
+                            auto replica_endpoint = _options->at("replica-endpoint").as<string>();
+                            auto endpoints = resolve_string_to_ip_endpoints(replica_endpoint);
+                            FC_ASSERT(endpoints.size(), "replica-endpoint ${hostname} did not resolve", ("hostname", replica_endpoint));
+                            auto replica_secret = _options->count("replica-secret") ? _options->at("replica-secret").as<string>() : string();
+
+                            if (read_only) {
+                                _replica_subscriber = std::make_shared<replica_subscriber>(endpoints[0], replica_secret);
+                                _replica_subscriber->start();
+                            } else {
+                                _replica_publisher = std::make_shared<replica_publisher>(*_chain_db, replica_secret);
+                                _replica_publisher->listen(endpoints[0]);
+                            }
+                        }
+
                         if (_options->count("api-user")) {
                             for (const std::string &api_access_str : _options->at("api-user").as<std::vector<std::string>>()) {
                                 api_access_info info = fc::json::from_string(api_access_str).as<api_access_info>();
@@ -347,6 +422,7 @@ namespace steemit {
 
                         if (!read_only) {
                             reset_p2p_node(_data_dir);
+                            reset_metrics_server();
                         }
 
                         reset_websocket_server();
@@ -483,7 +559,7 @@ namespace steemit {
                 virtual void handle_transaction(const graphene::net::trx_message &transaction_message) override {
                     try {
                         if (_running) {
-                            _chain_db->push_transaction(transaction_message.trx);
+                            _transaction_admission->push(transaction_message.trx);
                         }
                     } FC_CAPTURE_AND_RETHROW((transaction_message))
                 }
@@ -582,6 +658,16 @@ namespace steemit {
                     } FC_CAPTURE_AND_RETHROW((id))
                 }
 
+                virtual vector<signed_transaction> get_pending_transactions() override {
+                    return _chain_db->pending_transactions();
+                }
+
+                virtual std::vector<std::vector<char>> get_packed_blocks(uint32_t first_block_num, uint32_t limit, uint32_t max_bytes) override {
+                    try {
+                        return _chain_db->fetch_packed_blocks(first_block_num, limit, max_bytes);
+                    } FC_CAPTURE_AND_RETHROW((first_block_num)(limit)(max_bytes))
+                }
+
                 /**
                  * Returns a synopsis of the blockchain used for syncing.  This consists of a list of
                  * block hashes at intervals exponentially increasing towards the genesis block.
@@ -823,6 +909,9 @@ namespace steemit {
 
                 void shutdown() {
                     _running = false;
+                    _replica_publisher.reset();
+                    _replica_subscriber.reset();
+                    _metrics_server.reset();
                     fc::usleep(fc::seconds(1));
                     if (_p2p_network) {
                         _p2p_network->close();
@@ -842,9 +931,15 @@ namespace steemit {
 
                 //std::shared_ptr<graphene::db::object_database>   _pending_trx_db;
                 std::shared_ptr<steemit::chain::database> _chain_db;
+                std::shared_ptr<discussion_cache> _discussion_cache;
+                std::shared_ptr<api_worker_pool> _api_worker_pool;
+                std::shared_ptr<transaction_admission_queue> _transaction_admission;
+                std::shared_ptr<replica_publisher> _replica_publisher;
+                std::shared_ptr<replica_subscriber> _replica_subscriber;
                 std::shared_ptr<graphene::net::node> _p2p_network;
                 std::shared_ptr<fc::http::websocket_server> _websocket_server;
                 std::shared_ptr<fc::http::websocket_tls_server> _websocket_tls_server;
+                std::shared_ptr<fc::http::server> _metrics_server;
 
                 std::map<string, std::shared_ptr<abstract_plugin>> _plugins_available;
                 std::map<string, std::shared_ptr<abstract_plugin>> _plugins_enabled;
@@ -895,6 +990,8 @@ namespace steemit {
             configuration_file_options.add_options()
                     ("p2p-endpoint", bpo::value<string>(), "Endpoint for P2P node to listen on")
                     ("p2p-max-connections", bpo::value<uint32_t>(), "Maxmimum number of incoming connections on P2P endpoint")
+                    ("p2p-io-threads", bpo::value<uint32_t>()->default_value(2), "Number of threads doing encryption and framing of P2P connections, 0 to do it on the P2P thread")
+                    ("p2p-metrics-endpoint", bpo::value<string>(), "Endpoint to serve P2P metrics on in the Prometheus text format without authentication, disabled by default. A bare port like 9101 is served on 127.0.0.1 only")
                     ("seed-node,s", bpo::value<vector<string>>()->composing(), "P2P nodes to connect to on startup (may specify multiple times)")
                     ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
                     ("shared-file-dir", bpo::value<string>(), "Location of the shared memory file. Defaults to data_dir/blockchain")
@@ -908,7 +1005,15 @@ namespace steemit {
                     ("public-api", bpo::value<vector<string>>()->composing()->default_value(default_apis, str_default_apis), "Set an API to be publicly available, may be specified multiple times")
                     ("enable-plugin", bpo::value<vector<string>>()->composing()->default_value(default_plugins, str_default_plugins), "Plugin(s) to enable, may be specified multiple times")
                     ("max-block-age", bpo::value<int32_t>()->default_value(200), "Maximum age of head block when broadcasting tx via API")
-                    ("flush", bpo::value<uint32_t>()->default_value(100000), "Flush shared memory file to disk this many blocks");
+                    ("flush", bpo::value<uint32_t>()->default_value(100000), "Flush shared memory file to disk this many blocks")
+                    ("discussion-cache-size", bpo::value<uint32_t>()->default_value(0), "Maximum amount of materialized discussions cached for get_discussions_by_* calls, 0 (default) disables the cache")
+                    ("api-worker-threads", bpo::value<uint32_t>()->default_value(0), "Number of threads running read-only database API calls concurrently, 0 runs them on the application thread")
+                    ("transaction-admission-threads", bpo::value<uint32_t>()->default_value(2), "Number of threads checking P2P transactions before they take the write lock, 0 pushes them directly")
+                    ("transaction-admission-batch", bpo::value<uint32_t>()->default_value(100), "Maximum amount of checked P2P transactions pushed under one write lock")
+                    ("replica-endpoint", bpo::value<string>(), "Local endpoint the writer node publishes applied blocks on for read-only replicas sharing its memory file. In read-only mode the endpoint to receive them from")
+                    ("replica-secret", bpo::value<string>(), "Shared secret read-only replicas use to answer the challenge of the writer node. Without it only loopback replica connections are accepted")
+                    ("read-lock-writer-priority", bpo::value<bool>()->default_value(true), "Delay new API readers while a block or transaction is waiting for the database write lock")
+                    ("read-lock-quantum", bpo::value<uint32_t>()->default_value(20), "Milliseconds a long API scan keeps the read lock while a writer is waiting");
             command_line_options.add(configuration_file_options);
             command_line_options.add_options()
                     ("replay-blockchain", "Rebuild object graph by replaying all blocks")
@@ -955,6 +1060,21 @@ namespace steemit {
             return my->_chain_db;
         }
 
+        std::shared_ptr<discussion_cache> application::get_discussion_cache() const {
+            return my->_discussion_cache;
+        }
+
+        std::shared_ptr<api_worker_pool> application::get_api_worker_pool() const {
+            return my->_api_worker_pool;
+        }
+
+        fc::signal<void(const chain::signed_block &)> &application::applied_block_signal() {
+            if (my->_replica_subscriber) {
+                return my->_replica_subscriber->applied_block;
+            }
+            return my->_chain_db->applied_block;
+        }
+
 /*std::shared_ptr<graphene::db::object_database> application::pending_trx_database() const
 {
    return my->_pending_trx_db;
@@ -1,11 +1,14 @@
 #include <steemit/app/api_context.hpp>
 #include <steemit/app/application.hpp>
 #include <steemit/app/database_api.hpp>
+#include <steemit/app/discussion_cache.hpp>
+#include <steemit/app/api_worker_pool.hpp>
 
 #include <steemit/protocol/get_config.hpp>
 
 #include <fc/bloom_filter.hpp>
 #include <fc/smart_ref_impl.hpp>
+#include <fc/thread/mutex.hpp>
 
 #include <boost/range/iterator_range.hpp>
 #include <boost/algorithm/string.hpp>
@@ -85,9 +88,53 @@ namespace steemit {
 
             bool verify_account_authority(const std::string &name_or_id, const flat_set<public_key_type> &signers) const;
 
+            // History
+            std::map<uint32_t, applied_operation> get_account_history_by_query(const account_history_query &query) const;
+
             // signal handlers
             void on_applied_block(const chain::signed_block &b);
 
+            void on_changed_objects(const std::vector<changed_object> &ids);
+
+            /// Adds the object to the subscribe filter if a subscribe callback is set
+            void subscribe_to_item(uint16_t type, int64_t id) const;
+
+            template<typename ObjectType>
+            void subscribe_to_object(const ObjectType &obj) const {
+                subscribe_to_item(ObjectType::type_id, obj.id._id);
+            }
+
+            /// Converts a changed object to the API object, removed and unknown objects are returned as ids
+            fc::variant changed_object_to_variant(const changed_object &item) const;
+
+            /**
+             *  Runs read-only call under the read lock on the API worker pool,
+             *  calls touching the block log or subscriptions should stay on the
+             *  application thread and use _db.with_read_lock directly
+             */
+            template<typename Lambda>
+            auto with_read_lock(Lambda &&callback) const -> decltype(callback()) {
+                if (!_api_worker_pool) {
+                    return _db.with_read_lock(callback);
+                }
+                return _api_worker_pool->run([&]() {
+                    return _db.with_read_lock(callback);
+                });
+            }
+
+            /// Runs a long scan on the API worker pool, see database::with_preemptible_read_lock
+            template<typename Lambda>
+            void with_preemptible_read_lock(Lambda &&scan) const {
+                if (!_api_worker_pool) {
+                    _db.with_preemptible_read_lock(scan);
+                    return;
+                }
+                _api_worker_pool->run([&]() {
+                    _db.with_preemptible_read_lock(scan);
+                });
+            }
+
+            mutable fc::mutex _subscribe_mutex;
             mutable fc::bloom_filter _subscribe_filter;
             std::function<void(const fc::variant &)> _subscribe_callback;
             std::function<void(const fc::variant &)> _pending_trx_callback;
@@ -95,8 +142,12 @@ namespace steemit {
 
             steemit::chain::database &_db;
             std::shared_ptr<steemit::follow::follow_api> _follow_api;
+            std::shared_ptr<discussion_cache> _discussion_cache;
+            std::shared_ptr<api_worker_pool> _api_worker_pool;
 
+            fc::signal<void(const chain::signed_block &)> &_applied_block_signal;
             boost::signals2::scoped_connection _block_applied_connection;
+            boost::signals2::scoped_connection _changed_objects_connection;
         };
 
         applied_operation::applied_operation() {
@@ -130,6 +181,7 @@ namespace steemit {
         }
 
         void database_api_impl::set_subscribe_callback(std::function<void(const variant &)> cb, bool clear_filter) {
+            fc::scoped_lock<fc::mutex> lock(_subscribe_mutex);
             _subscribe_callback = cb;
             if (clear_filter || !cb) {
                 static fc::bloom_parameters param;
@@ -139,6 +191,90 @@ namespace steemit {
                 param.compute_optimal_parameters();
                 _subscribe_filter = fc::bloom_filter(param);
             }
+
+            if (cb) {
+                _db.track_changed_objects();
+                _changed_objects_connection = connect_signal(_db.changed_objects, *this, &database_api_impl::on_changed_objects);
+            } else {
+                _changed_objects_connection.disconnect();
+            }
+        }
+
+        static uint64_t subscription_key(uint16_t type, int64_t id) {
+            return (uint64_t(type) << 48) | (uint64_t(id) & 0xFFFFFFFFFFFFull);
+        }
+
+        void database_api_impl::subscribe_to_item(uint16_t type, int64_t id) const {
+            fc::scoped_lock<fc::mutex> lock(_subscribe_mutex);
+            if (!_subscribe_callback) {
+                return;
+            }
+
+            auto key = subscription_key(type, id);
+            _subscribe_filter.insert(reinterpret_cast<const char *>(&key), sizeof(key));
+        }
+
+        /**
+         *  Called at the end of every block and pushed transaction under the
+         *  write lock. Only matching objects are converted here, the callback
+         *  itself is invoked by a separate task, because sending to the client
+         *  may yield.
+         */
+        void database_api_impl::on_changed_objects(const std::vector<changed_object> &ids) {
+            std::function<void(const fc::variant &)> callback;
+            std::vector<fc::variant> updates;
+            {
+                fc::scoped_lock<fc::mutex> lock(_subscribe_mutex);
+                if (!_subscribe_callback) {
+                    return;
+                }
+                callback = _subscribe_callback;
+
+                for (const auto &item : ids) {
+                    auto key = subscription_key(item.type, item.id);
+                    if (_subscribe_filter.contains(reinterpret_cast<const char *>(&key), sizeof(key))) {
+                        updates.push_back(changed_object_to_variant(item));
+                    }
+                }
+            }
+
+            if (updates.empty()) {
+                return;
+            }
+
+            std::weak_ptr<database_api_impl> weak_self = shared_from_this();
+            fc::async([weak_self, callback, updates]() {
+                try {
+                    callback(fc::variant(updates));
+                } catch (...) {
+                    if (auto self = weak_self.lock()) {
+                        self->_changed_objects_connection.disconnect();
+                    }
+                }
+            }, "subscribe callback");
+        }
+
+        fc::variant database_api_impl::changed_object_to_variant(const changed_object &item) const {
+            switch (item.type) {
+                case account_object_type:
+                    if (auto obj = _db.find<account_object>(account_id_type(item.id))) {
+                        return fc::variant(account_api_obj(*obj, _db));
+                    }
+                    break;
+                case witness_object_type:
+                    if (auto obj = _db.find<witness_object>(witness_id_type(item.id))) {
+                        return fc::variant(witness_api_obj(*obj));
+                    }
+                    break;
+                case dynamic_global_property_object_type:
+                    if (auto obj = _db.find<dynamic_global_property_object>(dynamic_global_property_id_type(item.id))) {
+                        return fc::variant(dynamic_global_property_api_obj(*obj));
+                    }
+                    break;
+                default:
+                    break;
+            }
+            return fc::variant(item);
         }
 
         void database_api::set_pending_transaction_callback(std::function<void(const variant &)> cb) {
@@ -168,7 +304,7 @@ namespace steemit {
 
         void database_api_impl::set_block_applied_callback(std::function<void(const variant &block_header)> cb) {
             _block_applied_callback = cb;
-            _block_applied_connection = connect_signal(_db.applied_block, *this, &database_api_impl::on_applied_block);
+            _block_applied_connection = connect_signal(_applied_block_signal, *this, &database_api_impl::on_applied_block);
         }
 
         void database_api::cancel_all_subscriptions() {
@@ -195,7 +331,10 @@ namespace steemit {
         }
 
         database_api_impl::database_api_impl(const steemit::app::api_context &ctx)
-                : _db(*ctx.app.chain_database()) {
+                : _db(*ctx.app.chain_database()),
+                  _discussion_cache(ctx.app.get_discussion_cache()),
+                  _api_worker_pool(ctx.app.get_api_worker_pool()),
+                  _applied_block_signal(ctx.app.applied_block_signal()) {
             wlog("creating database api ${x}", ("x", int64_t(this)));
 
             try {
@@ -245,7 +384,7 @@ namespace steemit {
         }
 
         std::vector<applied_operation> database_api::get_ops_in_block(uint32_t block_num, bool only_virtual) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_ops_in_block(block_num, only_virtual);
             });
         }
@@ -273,7 +412,7 @@ namespace steemit {
 //////////////////////////////////////////////////////////////////////=
 
         fc::variant_object database_api::get_config() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_config();
             });
         }
@@ -287,47 +426,49 @@ namespace steemit {
         }
 
         dynamic_global_property_api_obj database_api::get_dynamic_global_properties() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_dynamic_global_properties();
             });
         }
 
         chain_properties database_api::get_chain_properties() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->_db.get_witness_schedule_object().median_props;
             });
         }
 
         feed_history_api_obj database_api::get_feed_history() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return feed_history_api_obj(my->_db.get_feed_history());
             });
         }
 
         price database_api::get_current_median_history_price() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->_db.get_feed_history().current_median_history;
             });
         }
 
         dynamic_global_property_api_obj database_api_impl::get_dynamic_global_properties() const {
-            return _db.get(dynamic_global_property_id_type());
+            const auto &props = _db.get_dynamic_global_properties();
+            subscribe_to_object(props);
+            return props;
         }
 
         witness_schedule_api_obj database_api::get_witness_schedule() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->_db.get(witness_schedule_id_type());
             });
         }
 
         hardfork_version database_api::get_hardfork_version() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->_db.get(hardfork_property_id_type()).current_hardfork_version;
             });
         }
 
         scheduled_hardfork database_api::get_next_scheduled_hardfork() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 scheduled_hardfork shf;
                 const auto &hpo = my->_db.get(hardfork_property_id_type());
                 shf.hf_version = hpo.next_hardfork;
@@ -343,7 +484,7 @@ namespace steemit {
 //////////////////////////////////////////////////////////////////////
 
         std::vector<std::set<std::string>> database_api::get_key_references(std::vector<public_key_type> key) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_key_references(key);
             });
         }
@@ -364,7 +505,7 @@ namespace steemit {
 //////////////////////////////////////////////////////////////////////
 
         std::vector<extended_account> database_api::get_accounts(std::vector<std::string> names) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_accounts(names);
             });
         }
@@ -377,12 +518,9 @@ namespace steemit {
             for (auto name: names) {
                 auto itr = idx.find(name);
                 if (itr != idx.end()) {
+                    subscribe_to_object(*itr);
                     results.push_back(extended_account(*itr, _db));
 
-                    if (_follow_api) {
-                        results.back().reputation = _follow_api->get_account_reputations(itr->name, 1)[0].reputation;
-                    }
-
                     auto vitr = vidx.lower_bound(boost::make_tuple(itr->id, witness_id_type()));
                     while (vitr != vidx.end() && vitr->account == itr->id) {
                         results.back().witness_votes.insert(_db.get(vitr->witness).owner);
@@ -391,11 +529,27 @@ namespace steemit {
                 }
             }
 
+            if (_follow_api && !results.empty()) {
+                std::set<std::string> accounts;
+                for (const auto &account : results) {
+                    accounts.insert(account.name);
+                }
+
+                std::map<std::string, share_type> reputations;
+                for (const auto &rep : _follow_api->get_reputations(accounts)) {
+                    reputations[rep.account] = rep.reputation;
+                }
+
+                for (auto &account : results) {
+                    account.reputation = reputations[account.name];
+                }
+            }
+
             return results;
         }
 
         std::vector<account_id_type> database_api::get_account_references(account_id_type account_id) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_account_references(account_id);
             });
         }
@@ -417,7 +571,7 @@ namespace steemit {
         }
 
         std::vector<optional<account_api_obj>> database_api::lookup_account_names(const std::vector<std::string> &account_names) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->lookup_account_names(account_names);
             });
         }
@@ -430,6 +584,7 @@ namespace steemit {
                 auto itr = _db.find<account_object, by_name>(name);
 
                 if (itr) {
+                    subscribe_to_object(*itr);
                     result.push_back(account_api_obj(*itr, _db));
                 } else {
                     result.push_back(optional<account_api_obj>());
@@ -440,7 +595,7 @@ namespace steemit {
         }
 
         std::set<std::string> database_api::lookup_accounts(const std::string &lower_bound_name, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->lookup_accounts(lower_bound_name, limit);
             });
         }
@@ -460,7 +615,7 @@ namespace steemit {
         }
 
         uint64_t database_api::get_account_count() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_account_count();
             });
         }
@@ -470,7 +625,7 @@ namespace steemit {
         }
 
         std::vector<owner_authority_history_api_obj> database_api::get_owner_history(std::string account) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 std::vector<owner_authority_history_api_obj> results;
 
                 const auto &hist_idx = my->_db.get_index<owner_authority_history_index>().indices().get<by_account>();
@@ -486,7 +641,7 @@ namespace steemit {
         }
 
         optional<account_recovery_request_api_obj> database_api::get_recovery_request(std::string account) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 optional<account_recovery_request_api_obj> result;
 
                 const auto &rec_idx = my->_db.get_index<account_recovery_request_index>().indices().get<by_account>();
@@ -501,7 +656,7 @@ namespace steemit {
         }
 
         optional<escrow_api_obj> database_api::get_escrow(std::string from, uint32_t escrow_id) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 optional<escrow_api_obj> result;
 
                 try {
@@ -515,7 +670,7 @@ namespace steemit {
         }
 
         std::vector<withdraw_route> database_api::get_withdraw_routes(std::string account, withdraw_route_type type) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 std::vector<withdraw_route> result;
 
                 const auto &acc = my->_db.get_account(account);
@@ -577,7 +732,7 @@ namespace steemit {
 //////////////////////////////////////////////////////////////////////
 
         std::vector<optional<witness_api_obj>> database_api::get_witnesses(const std::vector<witness_id_type> &witness_ids) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_witnesses(witness_ids);
             });
         }
@@ -588,6 +743,7 @@ namespace steemit {
             std::transform(witness_ids.begin(), witness_ids.end(), std::back_inserter(result),
                     [this](witness_id_type id) -> optional<witness_api_obj> {
                         if (auto o = _db.find(id)) {
+                            subscribe_to_object(*o);
                             return *o;
                         }
                         return {};
@@ -596,13 +752,13 @@ namespace steemit {
         }
 
         fc::optional<witness_api_obj> database_api::get_witness_by_account(std::string account_name) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_witness_by_account(account_name);
             });
         }
 
         std::vector<witness_api_obj> database_api::get_witnesses_by_vote(std::string from, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 //idump((from)(limit));
                 FC_ASSERT(limit <= 100);
 
@@ -634,13 +790,14 @@ namespace steemit {
             const auto &idx = _db.get_index<witness_index>().indices().get<by_name>();
             auto itr = idx.find(account_name);
             if (itr != idx.end()) {
+                subscribe_to_object(*itr);
                 return witness_api_obj(*itr);
             }
             return {};
         }
 
         std::set<account_name_type> database_api::lookup_witness_accounts(const std::string &lower_bound_name, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->lookup_witness_accounts(lower_bound_name, limit);
             });
         }
@@ -669,7 +826,7 @@ namespace steemit {
         }
 
         uint64_t database_api::get_witness_count() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_witness_count();
             });
         }
@@ -685,13 +842,13 @@ namespace steemit {
 //////////////////////////////////////////////////////////////////////
 
         order_book database_api::get_order_book(uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_order_book(limit);
             });
         }
 
         std::vector<extended_limit_order> database_api::get_open_orders(std::string owner) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 std::vector<extended_limit_order> result;
                 const auto &idx = my->_db.get_index<limit_order_index>().indices().get<by_account>();
                 auto itr = idx.lower_bound(owner);
@@ -758,7 +915,7 @@ namespace steemit {
         }
 
         std::vector<liquidity_balance> database_api::get_liquidity_queue(std::string start_account, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_liquidity_queue(start_account, limit);
             });
         }
@@ -802,7 +959,7 @@ namespace steemit {
 //////////////////////////////////////////////////////////////////////
 
         std::string database_api::get_transaction_hex(const signed_transaction &trx) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_transaction_hex(trx);
             });
         }
@@ -812,7 +969,7 @@ namespace steemit {
         }
 
         std::set<public_key_type> database_api::get_required_signatures(const signed_transaction &trx, const flat_set<public_key_type> &available_keys) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_required_signatures(trx, available_keys);
             });
         }
@@ -830,7 +987,7 @@ namespace steemit {
         }
 
         std::set<public_key_type> database_api::get_potential_signatures(const signed_transaction &trx) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->get_potential_signatures(trx);
             });
         }
@@ -870,7 +1027,7 @@ namespace steemit {
         }
 
         bool database_api::verify_authority(const signed_transaction &trx) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->verify_authority(trx);
             });
         }
@@ -885,7 +1042,7 @@ namespace steemit {
         }
 
         bool database_api::verify_account_authority(const std::string &name_or_id, const flat_set<public_key_type> &signers) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 return my->verify_account_authority(name_or_id, signers);
             });
         }
@@ -905,7 +1062,7 @@ namespace steemit {
         }
 
         std::vector<convert_request_api_obj> database_api::get_conversion_requests(const std::string &account) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 const auto &idx = my->_db.get_index<convert_request_index>().indices().get<by_owner>();
                 std::vector<convert_request_api_obj> result;
                 auto itr = idx.lower_bound(account);
@@ -918,12 +1075,13 @@ namespace steemit {
         }
 
         discussion database_api::get_content(std::string author, std::string permlink) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 const auto &by_permlink_idx = my->_db.get_index<comment_index>().indices().get<by_permlink>();
                 auto itr = by_permlink_idx.find(boost::make_tuple(author, permlink));
                 if (itr != by_permlink_idx.end()) {
                     discussion result(*itr);
                     set_pending_payout(result);
+                    set_author_reputations({&result});
                     result.active_votes = get_active_votes(author, permlink);
                     return result;
                 }
@@ -932,12 +1090,13 @@ namespace steemit {
         }
 
         std::vector<vote_state> database_api::get_active_votes(std::string author, std::string permlink) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 std::vector<vote_state> result;
                 const auto &comment = my->_db.get_comment(author, permlink);
                 const auto &idx = my->_db.get_index<comment_vote_index>().indices().get<by_comment_voter>();
                 comment_id_type cid(comment.id);
                 auto itr = idx.lower_bound(cid);
+                std::set<std::string> voters;
                 while (itr != idx.end() && itr->comment == cid) {
                     const auto &vo = my->_db.get(itr->voter);
                     vote_state vstate;
@@ -947,39 +1106,115 @@ namespace steemit {
                     vstate.percent = itr->vote_percent;
                     vstate.time = itr->last_update;
 
-                    if (my->_follow_api) {
-                        auto reps = my->_follow_api->get_account_reputations(vo.name, 1);
-                        if (reps.size()) {
-                            vstate.reputation = reps[0].reputation;
+                    voters.insert(vstate.voter);
+                    result.push_back(vstate);
+                    ++itr;
+                }
+
+                // Reputations of all voters are resolved at once, they come back ordered by name
+                if (my->_follow_api && !voters.empty()) {
+                    auto reps = my->_follow_api->get_reputations(voters);
+                    for (auto &vstate : result) {
+                        auto rep = std::lower_bound(reps.begin(), reps.end(), vstate.voter,
+                                [](const follow::account_reputation &r, const std::string &name) {
+                                    return r.account < name;
+                                });
+                        if (rep != reps.end() && rep->account == vstate.voter) {
+                            vstate.reputation = rep->reputation;
                         }
                     }
+                }
+                return result;
+            });
+        }
 
-                    result.push_back(vstate);
+        static account_vote make_account_vote(const chain::database &db, const comment_vote_object &vote) {
+            const auto &vo = db.get(vote.comment);
+            account_vote avote;
+            avote.authorperm = vo.author + "/" + to_string(vo.permlink);
+            avote.weight = vote.weight;
+            avote.rshares = vote.rshares;
+            avote.percent = vote.vote_percent;
+            avote.time = vote.last_update;
+            return avote;
+        }
+
+        std::vector<account_vote> database_api::get_account_votes(std::string voter) const {
+            std::vector<account_vote> result;
+            optional<account_id_type> aid;
+            comment_id_type next;
+
+            // Votes are scanned in comment order, after the lock was released
+            // the scan continues from the first comment not returned yet
+            my->with_preemptible_read_lock([&]() {
+                if (!aid.valid()) {
+                    aid = account_id_type(my->_db.get_account(voter).id);
+                }
+
+                const auto &idx = my->_db.get_index<comment_vote_index>().indices().get<by_voter_comment>();
+                auto itr = idx.lower_bound(boost::make_tuple(*aid, next));
+                auto end = idx.upper_bound(*aid);
+                while (itr != end) {
+                    if (my->_db.should_yield_read_lock()) {
+                        next = itr->comment;
+                        return false;
+                    }
+                    result.push_back(make_account_vote(my->_db, *itr));
+                    ++itr;
+                }
+                return true;
+            });
+            return result;
+        }
+
+        std::vector<account_vote> database_api::get_account_votes_by_time(std::string voter, std::string start_author, std::string start_permlink, uint32_t limit) const {
+            FC_ASSERT(limit <= 1000, "Limit of ${l} is greater than maxmimum allowed", ("l", limit));
+
+            return my->with_read_lock([&]() {
+                std::vector<account_vote> result;
+                result.reserve(limit);
+
+                account_id_type aid(my->_db.get_account(voter).id);
+                const auto &idx = my->_db.get_index<comment_vote_index>().indices().get<by_voter_last_update>();
+
+                auto itr = idx.lower_bound(aid);
+                if (start_author.size() || start_permlink.size()) {
+                    const auto &comment = my->_db.get_comment(start_author, start_permlink);
+                    const auto &vote_idx = my->_db.get_index<comment_vote_index>().indices().get<by_comment_voter>();
+                    auto start = vote_idx.find(boost::make_tuple(comment.id, aid));
+                    FC_ASSERT(start != vote_idx.end(), "${voter} did not vote for ${author}/${permlink}",
+                            ("voter", voter)("author", start_author)("permlink", start_permlink));
+                    itr = idx.iterator_to(*start);
+                }
+
+                auto end = idx.upper_bound(aid);
+                while (itr != end && result.size() < limit) {
+                    result.push_back(make_account_vote(my->_db, *itr));
                     ++itr;
                 }
                 return result;
             });
         }
 
-        std::vector<account_vote> database_api::get_account_votes(std::string voter) const {
-            return my->_db.with_read_lock([&]() {
+        std::vector<account_vote> database_api::get_account_votes_by_comment(std::string voter, std::string start_author, std::string start_permlink, uint32_t limit) const {
+            FC_ASSERT(limit <= 1000, "Limit of ${l} is greater than maxmimum allowed", ("l", limit));
+
+            return my->with_read_lock([&]() {
                 std::vector<account_vote> result;
+                result.reserve(limit);
 
-                const auto &voter_acnt = my->_db.get_account(voter);
+                account_id_type aid(my->_db.get_account(voter).id);
                 const auto &idx = my->_db.get_index<comment_vote_index>().indices().get<by_voter_comment>();
 
-                account_id_type aid(voter_acnt.id);
-                auto itr = idx.lower_bound(aid);
+                comment_id_type start;
+                if (start_author.size() || start_permlink.size()) {
+                    start = my->_db.get_comment(start_author, start_permlink).id;
+                }
+
+                auto itr = idx.lower_bound(boost::make_tuple(aid, start));
                 auto end = idx.upper_bound(aid);
-                while (itr != end) {
-                    const auto &vo = my->_db.get(itr->comment);
-                    account_vote avote;
-                    avote.authorperm = vo.author + "/" + to_string(vo.permlink);
-                    avote.weight = itr->weight;
-                    avote.rshares = itr->rshares;
-                    avote.percent = itr->vote_percent;
-                    avote.time = itr->last_update;
-                    result.push_back(avote);
+                while (itr != end && result.size() < limit) {
+                    result.push_back(make_account_vote(my->_db, *itr));
                     ++itr;
                 }
                 return result;
@@ -1028,10 +1263,6 @@ namespace steemit {
 
                 d.pending_payout_value = asset(static_cast<uint64_t>(r2), pot.symbol);
                 d.total_pending_payout_value = asset(static_cast<uint64_t>(tpp), pot.symbol);
-
-                if (my->_follow_api) {
-                    d.author_reputation = my->_follow_api->get_account_reputations(d.author, 1)[0].reputation;
-                }
             }
 
             if (d.parent_author != STEEMIT_ROOT_POST_PARENT) {
@@ -1048,18 +1279,48 @@ namespace steemit {
             set_url(d);
         }
 
+        void database_api::set_author_reputations(const std::vector<discussion *> &discussions) const {
+            if (!my->_follow_api || discussions.empty()) {
+                return;
+            }
+
+            std::set<std::string> authors;
+            for (const discussion *d : discussions) {
+                authors.insert(d->author);
+            }
+
+            std::map<std::string, share_type> reputations;
+            for (const auto &rep : my->_follow_api->get_reputations(authors)) {
+                reputations[rep.account] = rep.reputation;
+            }
+
+            for (discussion *d : discussions) {
+                auto itr = reputations.find(d->author);
+                d->author_reputation = itr != reputations.end() ? itr->second : share_type(0);
+            }
+        }
+
+        void database_api::set_author_reputations(std::vector<discussion> &discussions) const {
+            std::vector<discussion *> pointers;
+            pointers.reserve(discussions.size());
+            for (auto &d : discussions) {
+                pointers.push_back(&d);
+            }
+            set_author_reputations(pointers);
+        }
+
         void database_api::set_url(discussion &d) const {
-            const comment_api_obj root(my->_db.get<comment_object, by_id>(d.root_comment));
-            d.url = "/" + root.category + "/@" + root.author + "/" +
-                    root.permlink;
-            d.root_title = root.title;
+            const comment_object &root = my->_db.get<comment_object, by_id>(d.root_comment);
+            d.url = "/" + to_string(root.category) + "/@" + std::string(root.author) + "/" +
+                    to_string(root.permlink);
+            d.root_title = to_string(root.title);
             if (root.id != d.id) {
                 d.url += "#@" + d.author + "/" + d.permlink;
             }
         }
 
         std::vector<discussion> database_api::get_content_replies(std::string author, std::string permlink) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 account_name_type acc_name = account_name_type(author);
                 const auto &by_permlink_idx = my->_db.get_index<comment_index>().indices().get<by_parent>();
                 auto itr = by_permlink_idx.find(boost::make_tuple(acc_name, permlink));
@@ -1075,6 +1336,7 @@ namespace steemit {
                     set_pending_payout(result.back());
                     ++itr;
                 }
+                set_author_reputations(result);
                 return result;
             });
         }
@@ -1086,7 +1348,7 @@ namespace steemit {
  *  Subsequent calls should be (last_author, last_permlink, limit)
  */
         std::vector<discussion> database_api::get_replies_by_last_update(account_name_type start_parent_author, std::string start_permlink, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 std::vector<discussion> result;
 
 #ifndef IS_LOW_MEM
@@ -1112,36 +1374,111 @@ namespace steemit {
                     result.back().active_votes = get_active_votes(itr->author, to_string(itr->permlink));
                     ++itr;
                 }
-
+                set_author_reputations(result);
 #endif
                 return result;
             });
         }
 
         std::map<uint32_t, applied_operation> database_api::get_account_history(std::string account, uint64_t from, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
-                FC_ASSERT(limit <=
-                          2000, "Limit of ${l} is greater than maxmimum allowed", ("l", limit));
-                FC_ASSERT(from >= limit, "From must be greater than limit");
-                //   idump((account)(from)(limit));
+            FC_ASSERT(limit <=
+                      2000, "Limit of ${l} is greater than maxmimum allowed", ("l", limit));
+            FC_ASSERT(from >= limit, "From must be greater than limit");
+
+            std::map<uint32_t, applied_operation> result;
+            optional<int64_t> last;
+            uint64_t next = from;
+
+            // History is append-only, so the scan resumes from the next sequence
+            // after the lock was released for a pending block
+            my->with_preemptible_read_lock([&]() {
                 const auto &idx = my->_db.get_index<account_history_index>().indices().get<by_account>();
-                auto itr = idx.lower_bound(boost::make_tuple(account, from));
-                //   if( itr != idx.end() ) idump((*itr));
-                auto end = idx.upper_bound(boost::make_tuple(account, std::max(int64_t(0),
-                        int64_t(itr->sequence) - limit)));
-                //   if( end != idx.end() ) idump((*end));
+                auto itr = idx.lower_bound(boost::make_tuple(account, next));
+                if (!last.valid()) {
+                    if (itr == idx.end() || itr->account != account) {
+                        return true;
+                    }
+                    last = std::max(int64_t(0), int64_t(itr->sequence) - limit);
+                }
 
-                std::map<uint32_t, applied_operation> result;
+                auto end = idx.upper_bound(boost::make_tuple(account, *last));
                 while (itr != end) {
+                    if (my->_db.should_yield_read_lock()) {
+                        next = itr->sequence;
+                        return false;
+                    }
                     result[itr->sequence] = my->_db.get(itr->op);
                     ++itr;
                 }
-                return result;
+                return true;
+            });
+            return result;
+        }
+
+        std::map<uint32_t, applied_operation> database_api::get_account_history_by_query(const account_history_query &query) const {
+            query.validate();
+            return my->with_read_lock([&]() {
+                return my->get_account_history_by_query(query);
             });
         }
 
+        std::map<uint32_t, applied_operation> database_api_impl::get_account_history_by_query(const account_history_query &query) const {
+            std::map<uint32_t, applied_operation> result;
+            const auto &account = query.account;
+
+            uint32_t from = static_cast<uint32_t>(std::min<uint64_t>(query.from, uint32_t(-1)));
+            if (query.end_time) {
+                const auto &time_idx = _db.get_index<account_history_index>().indices().get<by_account_time>();
+                auto itr = time_idx.lower_bound(boost::make_tuple(account, *query.end_time));
+                if (itr == time_idx.end() || itr->account != account) {
+                    return result;
+                }
+                from = std::min(from, itr->sequence);
+            }
+
+            auto in_time = [&](const account_history_object &ahist) {
+                return !query.start_time || ahist.timestamp >= *query.start_time;
+            };
+
+            // Every index walk is ordered by sequence descending, so the newest
+            // limit entries of each selected type are enough to merge
+            std::vector<std::pair<uint32_t, operation_id_type>> matches;
+            if (!query.operations) {
+                const auto &idx = _db.get_index<account_history_index>().indices().get<by_account>();
+                auto itr = idx.lower_bound(boost::make_tuple(account, from));
+                for (; itr != idx.end() && itr->account == account && matches.size() < query.limit && in_time(*itr); ++itr) {
+                    matches.emplace_back(itr->sequence, itr->op);
+                }
+            } else {
+                const auto &idx = _db.get_index<account_history_index>().indices().get<by_account_operation>();
+                for (uint16_t type = 0; type < 64; ++type) {
+                    if (!(query.operations & (uint64_t(1) << type))) {
+                        continue;
+                    }
+
+                    uint32_t count = 0;
+                    auto itr = idx.lower_bound(boost::make_tuple(account, type, from));
+                    for (; itr != idx.end() && itr->account == account && itr->op_type == type && count < query.limit && in_time(*itr); ++itr, ++count) {
+                        matches.emplace_back(itr->sequence, itr->op);
+                    }
+                }
+
+                std::sort(matches.begin(), matches.end(), [](const std::pair<uint32_t, operation_id_type> &a, const std::pair<uint32_t, operation_id_type> &b) {
+                    return a.first > b.first;
+                });
+                if (matches.size() > query.limit) {
+                    matches.resize(query.limit);
+                }
+            }
+
+            for (const auto &match : matches) {
+                result[match.first] = _db.get(match.second);
+            }
+            return result;
+        }
+
         std::vector<pair<std::string, uint32_t>> database_api::get_tags_used_by_author(const std::string &author) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 const auto *acnt = my->_db.find_account(author);
                 FC_ASSERT(acnt != nullptr);
                 const auto &tidx = my->_db.get_index<tags::author_tag_stats_index>().indices().get<tags::by_author_posts_tag>();
@@ -1161,7 +1498,7 @@ namespace steemit {
         }
 
         std::vector<tag_api_obj> database_api::get_trending_tags(std::string after, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 limit = std::min(limit, uint32_t(1000));
                 std::vector<tag_api_obj> result;
                 result.reserve(limit);
@@ -1193,15 +1530,61 @@ namespace steemit {
             });
         }
 
+        /**
+         *  Returns the message replacing oversized body, the same rules as in
+         *  set_pending_payout, or nullptr if the body is returned as is
+         */
+        static const char *pruned_body(const comment_object &comment) {
+            if (comment.body.size() > 1024 * 128) {
+                return "body pruned due to size";
+            }
+            if (comment.parent_author != STEEMIT_ROOT_POST_PARENT &&
+                comment.body.size() > 1024 * 16) {
+                return "comment pruned due to size";
+            }
+            return nullptr;
+        }
+
         discussion database_api::get_discussion(comment_id_type id, uint32_t truncate_body) const {
-            discussion d = my->_db.get(id);
-            set_url(d);
-            set_pending_payout(d);
-            d.active_votes = get_active_votes(d.author, d.permlink);
-            d.body_length = static_cast<uint32_t>(d.body.size());
-            if (truncate_body) {
-                d.body = d.body.substr(0, truncate_body);
+            comment_projection projection;
+            projection.body_bytes = truncate_body;
+            return get_discussion(id, projection);
+        }
+
+        discussion database_api::get_discussion(comment_id_type id, const comment_projection &projection) const {
+            const auto &comment = my->_db.get(id);
+
+            // Cached discussions never hold body and json_metadata, they are
+            // copied from the shared memory only as far as the query asks for
+            discussion d;
+            if (!my->_discussion_cache || !my->_discussion_cache->get(id, d)) {
+                d = discussion(comment, comment_projection::none());
+                set_url(d);
+                set_pending_payout(d);
+                d.active_votes = get_active_votes(d.author, d.permlink);
+                d.body_length = static_cast<uint32_t>(comment.body.size());
+                if (const char *pruned = pruned_body(comment)) {
+                    d.body_length = static_cast<uint32_t>(std::string(pruned).size());
+                }
 
+                if (my->_discussion_cache) {
+                    my->_discussion_cache->put(d);
+                }
+            }
+
+            if (projection.body) {
+                if (const char *pruned = pruned_body(comment)) {
+                    d.body = std::string(pruned).substr(0, projection.body_bytes ? projection.body_bytes : std::string::npos);
+                } else {
+                    d.body = copy_prefix(comment.body, projection.body_bytes);
+                }
+            }
+
+            if (projection.json_metadata) {
+                d.json_metadata = to_string(comment.json_metadata);
+            }
+
+            if (projection.body_bytes) {
                 if (!fc::is_utf8(d.title)) {
                     d.title = fc::prune_invalid_utf8(d.title);
                 }
@@ -1257,7 +1640,7 @@ namespace steemit {
                 }
 
                 try {
-                    discussion insert_discussion = get_discussion(tidx_itr->comment, query.truncate_body);
+                    discussion insert_discussion = get_discussion(tidx_itr->comment, query.projection());
                     insert_discussion.promoted = asset(tidx_itr->promoted_balance, SBD_SYMBOL);
 
                     if (filter(insert_discussion)) {
@@ -1275,11 +1658,18 @@ namespace steemit {
 
                 ++tidx_itr;
             }
+
+            std::vector<discussion *> discussions;
+            discussions.reserve(result.size());
+            for (auto &item : result) {
+                discussions.push_back(&item.second);
+            }
+            set_author_reputations(discussions);
             return result;
         }
 
         comment_id_type database_api::get_parent(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 comment_id_type parent;
                 if (query.parent_author && query.parent_permlink) {
                     parent = my->_db.get_comment(*query.parent_author, *query.parent_permlink).id;
@@ -1289,10 +1679,11 @@ namespace steemit {
         }
 
         std::vector<discussion> database_api::get_discussions_by_trending(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 auto parent = get_parent(query);
 
+                const auto filter_tags = tags::normalize_tags(query.filter_tags);
                 std::function<bool(const comment_api_obj &)> filter_function = [&](const comment_api_obj &c) -> bool {
                     if (query.select_authors.size()) {
                         if (query.select_authors.find(c.author) ==
@@ -1301,12 +1692,8 @@ namespace steemit {
                         }
                     }
 
-                    tags::comment_metadata meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-
-                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                        if (meta.tags.find(iterator) != meta.tags.end()) {
-                            return true;
-                        }
+                    if (tags::comment_has_any_tag(my->_db, c.id, filter_tags)) {
+                        return true;
                     }
 
                     return c.children_rshares2 <= 0 || c.mode != first_payout ||
@@ -1345,10 +1732,11 @@ namespace steemit {
         }
 
         std::vector<discussion> database_api::get_discussions_by_promoted(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 auto parent = get_parent(query);
 
+                const auto filter_tags = tags::normalize_tags(query.filter_tags);
                 std::function<bool(const comment_api_obj &c)> filter_function = [&](const comment_api_obj &c) -> bool {
                     if (query.select_authors.size()) {
                         if (query.select_authors.find(c.author) ==
@@ -1357,12 +1745,8 @@ namespace steemit {
                         }
                     }
 
-                    tags::comment_metadata meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-
-                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                        if (meta.tags.find(iterator) != meta.tags.end()) {
-                            return true;
-                        }
+                    if (tags::comment_has_any_tag(my->_db, c.id, filter_tags)) {
+                        return true;
                     }
 
                     return c.children_rshares2 <= 0 ||
@@ -1405,10 +1789,11 @@ namespace steemit {
         }
 
         std::vector<discussion> database_api::get_discussions_by_trending30(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 auto parent = get_parent(query);
 
+                const auto filter_tags = tags::normalize_tags(query.filter_tags);
                 std::function<bool(const comment_api_obj &c)> filter_function = [&](const comment_api_obj &c) -> bool {
                     if (query.select_authors.size()) {
                         if (query.select_authors.find(c.author) ==
@@ -1417,12 +1802,8 @@ namespace steemit {
                         }
                     }
 
-                    tags::comment_metadata meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-
-                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                        if (meta.tags.find(iterator) != meta.tags.end()) {
-                            return true;
-                        }
+                    if (tags::comment_has_any_tag(my->_db, c.id, filter_tags)) {
+                        return true;
                     }
 
                     return c.children_rshares2 <= 0 ||
@@ -1462,10 +1843,11 @@ namespace steemit {
         }
 
         std::vector<discussion> database_api::get_discussions_by_created(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 auto parent = get_parent(query);
 
+                const auto filter_tags = tags::normalize_tags(query.filter_tags);
                 std::function<bool(const comment_api_obj &c)> filter_function = [&](const comment_api_obj &c) -> bool {
                     if (query.select_authors.size()) {
                         if (query.select_authors.find(c.author) ==
@@ -1474,12 +1856,8 @@ namespace steemit {
                         }
                     }
 
-                    tags::comment_metadata meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-
-                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                        if (meta.tags.find(iterator) != meta.tags.end()) {
-                            return true;
-                        }
+                    if (tags::comment_has_any_tag(my->_db, c.id, filter_tags)) {
+                        return true;
                     }
 
                     return query.filter_tags.find(c.category) !=
@@ -1517,10 +1895,11 @@ namespace steemit {
         }
 
         std::vector<discussion> database_api::get_discussions_by_active(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 auto parent = get_parent(query);
 
+                const auto filter_tags = tags::normalize_tags(query.filter_tags);
                 std::function<bool(const comment_api_obj &c)> filter_function = [&](const comment_api_obj &c) -> bool {
                     if (query.select_authors.size()) {
                         if (query.select_authors.find(c.author) ==
@@ -1529,12 +1908,8 @@ namespace steemit {
                         }
                     }
 
-                    tags::comment_metadata meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-
-                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                        if (meta.tags.find(iterator) != meta.tags.end()) {
-                            return true;
-                        }
+                    if (tags::comment_has_any_tag(my->_db, c.id, filter_tags)) {
+                        return true;
                     }
 
                     return query.filter_tags.find(c.category) !=
@@ -1572,10 +1947,11 @@ namespace steemit {
         }
 
         std::vector<discussion> database_api::get_discussions_by_cashout(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 auto parent = get_parent(query);
 
+                const auto filter_tags = tags::normalize_tags(query.filter_tags);
                 std::function<bool(const comment_api_obj &c)> filter_function = [&](const comment_api_obj &c) -> bool {
                     if (query.select_authors.size()) {
                         if (query.select_authors.find(c.author) ==
@@ -1584,12 +1960,8 @@ namespace steemit {
                         }
                     }
 
-                    tags::comment_metadata meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-
-                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                        if (meta.tags.find(iterator) != meta.tags.end()) {
-                            return true;
-                        }
+                    if (tags::comment_has_any_tag(my->_db, c.id, filter_tags)) {
+                        return true;
                     }
 
                     return c.children_rshares2 <= 0 ||
@@ -1630,10 +2002,11 @@ namespace steemit {
         }
 
         std::vector<discussion> database_api::get_discussions_by_payout(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 auto parent = get_parent(query);
 
+                const auto filter_tags = tags::normalize_tags(query.filter_tags);
                 std::function<bool(const comment_api_obj &c)> filter_function = [&](const comment_api_obj &c) -> bool {
                     if (query.select_authors.size()) {
                         if (query.select_authors.find(c.author) ==
@@ -1642,12 +2015,8 @@ namespace steemit {
                         }
                     }
 
-                    tags::comment_metadata meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-
-                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                        if (meta.tags.find(iterator) != meta.tags.end()) {
-                            return true;
-                        }
+                    if (tags::comment_has_any_tag(my->_db, c.id, filter_tags)) {
+                        return true;
                     }
 
                     return c.net_rshares <= 0 ||
@@ -1686,10 +2055,11 @@ namespace steemit {
         }
 
         std::vector<discussion> database_api::get_discussions_by_votes(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 auto parent = get_parent(query);
 
+                const auto filter_tags = tags::normalize_tags(query.filter_tags);
                 std::function<bool(const comment_api_obj &c)> filter_function = [&](const comment_api_obj &c) -> bool {
                     if (query.select_authors.size()) {
                         if (query.select_authors.find(c.author) ==
@@ -1698,12 +2068,8 @@ namespace steemit {
                         }
                     }
 
-                    tags::comment_metadata meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-
-                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                        if (meta.tags.find(iterator) != meta.tags.end()) {
-                            return true;
-                        }
+                    if (tags::comment_has_any_tag(my->_db, c.id, filter_tags)) {
+                        return true;
                     }
 
                     return query.filter_tags.find(c.category) !=
@@ -1741,10 +2107,11 @@ namespace steemit {
         }
 
         std::vector<discussion> database_api::get_discussions_by_children(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 auto parent = get_parent(query);
 
+                const auto filter_tags = tags::normalize_tags(query.filter_tags);
                 std::function<bool(const comment_api_obj &c)> filter_function = [&](const comment_api_obj &c) -> bool {
                     if (query.select_authors.size()) {
                         if (query.select_authors.find(c.author) ==
@@ -1753,12 +2120,8 @@ namespace steemit {
                         }
                     }
 
-                    tags::comment_metadata meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-
-                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                        if (meta.tags.find(iterator) != meta.tags.end()) {
-                            return true;
-                        }
+                    if (tags::comment_has_any_tag(my->_db, c.id, filter_tags)) {
+                        return true;
                     }
 
                     return query.filter_tags.find(c.category) !=
@@ -1797,10 +2160,11 @@ namespace steemit {
 
         std::vector<discussion> database_api::get_discussions_by_hot(const discussion_query &query) const {
 
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 auto parent = get_parent(query);
 
+                const auto filter_tags = tags::normalize_tags(query.filter_tags);
                 std::function<bool(const comment_api_obj &c)> filter_function = [&](const comment_api_obj &c) -> bool {
                     if (query.select_authors.size()) {
                         if (query.select_authors.find(c.author) ==
@@ -1809,12 +2173,8 @@ namespace steemit {
                         }
                     }
 
-                    tags::comment_metadata meta = fc::json::from_string(c.json_metadata).as<tags::comment_metadata>();
-
-                    for (const std::set<std::string>::value_type &iterator : query.filter_tags) {
-                        if (meta.tags.find(iterator) != meta.tags.end()) {
-                            return true;
-                        }
+                    if (tags::comment_has_any_tag(my->_db, c.id, filter_tags)) {
+                        return true;
                     }
 
                     return c.net_rshares <= 0 ||
@@ -1853,7 +2213,7 @@ namespace steemit {
         }
 
         std::vector<discussion> database_api::get_discussions_by_feed(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 FC_ASSERT(my->_follow_api, "Node is not running the follow plugin");
                 FC_ASSERT(query.select_authors.size(), "No such author to select feed from");
@@ -1906,7 +2266,7 @@ namespace steemit {
                                 }
                             }
 
-                            result.push_back(get_discussion(feed_itr->comment));
+                            result.push_back(get_discussion(feed_itr->comment, query.projection()));
                             if (feed_itr->first_reblogged_by !=
                                 account_name_type()) {
                                 result.back().reblogged_by = std::vector<account_name_type>(feed_itr->reblogged_by.begin(), feed_itr->reblogged_by.end());
@@ -1921,12 +2281,13 @@ namespace steemit {
                         ++feed_itr;
                     }
                 }
+                set_author_reputations(result);
                 return result;
             });
         }
 
         std::vector<discussion> database_api::get_discussions_by_blog(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 query.validate();
                 FC_ASSERT(my->_follow_api, "Node is not running the follow plugin");
                 FC_ASSERT(query.select_authors.size(), "No such author to select feed from");
@@ -1980,7 +2341,7 @@ namespace steemit {
                                 }
                             }
 
-                            result.push_back(get_discussion(blog_itr->comment, query.truncate_body));
+                            result.push_back(get_discussion(blog_itr->comment, query.projection()));
                             if (blog_itr->reblogged_on > time_point_sec()) {
                                 result.back().first_reblogged_on = blog_itr->reblogged_on;
                             }
@@ -1992,12 +2353,13 @@ namespace steemit {
                         ++blog_itr;
                     }
                 }
+                set_author_reputations(result);
                 return result;
             });
         }
 
         std::vector<discussion> database_api::get_discussions_by_comments(const discussion_query &query) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 std::vector<discussion> result;
 #ifndef IS_LOW_MEM
                 query.validate();
@@ -2033,7 +2395,7 @@ namespace steemit {
                                 continue;
                             }
 
-                            result.push_back(get_discussion(comment_itr->id));
+                            result.push_back(get_discussion(comment_itr->id, query.projection()));
                         }
                         catch (const fc::exception &e) {
                             edump((e.to_detail_string()));
@@ -2042,13 +2404,14 @@ namespace steemit {
 
                     ++comment_itr;
                 }
+                set_author_reputations(result);
 #endif
                 return result;
             });
         }
 
         std::vector<category_api_obj> database_api::get_trending_categories(std::string after, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 limit = std::min(limit, uint32_t(100));
                 std::vector<category_api_obj> result;
                 result.reserve(limit);
@@ -2075,7 +2438,7 @@ namespace steemit {
         }
 
         std::vector<category_api_obj> database_api::get_best_categories(std::string after, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 limit = std::min(limit, uint32_t(100));
                 std::vector<category_api_obj> result;
                 result.reserve(limit);
@@ -2084,7 +2447,7 @@ namespace steemit {
         }
 
         std::vector<category_api_obj> database_api::get_active_categories(std::string after, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 limit = std::min(limit, uint32_t(100));
                 std::vector<category_api_obj> result;
                 result.reserve(limit);
@@ -2093,7 +2456,7 @@ namespace steemit {
         }
 
         std::vector<category_api_obj> database_api::get_recent_categories(std::string after, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 limit = std::min(limit, uint32_t(100));
                 std::vector<category_api_obj> result;
                 result.reserve(limit);
@@ -2110,7 +2473,7 @@ namespace steemit {
  *
  */
         void database_api::recursively_fetch_content(state &_state, discussion &root, std::set<std::string> &referenced_accounts) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 try {
                     if (root.author.size()) {
                         referenced_accounts.insert(root.author);
@@ -2137,7 +2500,7 @@ namespace steemit {
         }
 
         std::vector<account_name_type> database_api::get_miner_queue() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 std::vector<account_name_type> result;
                 const auto &pow_idx = my->_db.get_index<witness_index>().indices().get<by_pow>();
 
@@ -2153,7 +2516,7 @@ namespace steemit {
         }
 
         std::vector<account_name_type> database_api::get_active_witnesses() const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 const auto &wso = my->_db.get_witness_schedule_object();
                 size_t n = wso.current_shuffled_witnesses.size();
                 std::vector<account_name_type> result(n);
@@ -2166,7 +2529,7 @@ namespace steemit {
 
         std::vector<discussion> database_api::get_discussions_by_author_before_date(
                 std::string author, std::string start_permlink, time_point_sec before_date, uint32_t limit) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 try {
                     std::vector<discussion> result;
 #ifndef IS_LOW_MEM
@@ -2198,7 +2561,7 @@ namespace steemit {
                         }
                         ++itr;
                     }
-
+                    set_author_reputations(result);
 #endif
                     return result;
                 }
@@ -2207,7 +2570,7 @@ namespace steemit {
         }
 
         std::vector<savings_withdraw_api_obj> database_api::get_savings_withdraw_from(std::string account) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 std::vector<savings_withdraw_api_obj> result;
 
                 const auto &from_rid_idx = my->_db.get_index<savings_withdraw_index>().indices().get<by_from_rid>();
@@ -2221,7 +2584,7 @@ namespace steemit {
         }
 
         std::vector<savings_withdraw_api_obj> database_api::get_savings_withdraw_to(std::string account) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 std::vector<savings_withdraw_api_obj> result;
 
                 const auto &to_complete_idx = my->_db.get_index<savings_withdraw_index>().indices().get<by_to_complete>();
@@ -2236,7 +2599,7 @@ namespace steemit {
 
 
         state database_api::get_state(std::string path) const {
-            return my->_db.with_read_lock([&]() {
+            return my->with_read_lock([&]() {
                 state _state;
                 _state.props = get_dynamic_global_properties();
                 _state.current_route = path;
@@ -2260,6 +2623,10 @@ namespace steemit {
 
                     std::set<std::string> accounts;
 
+                    // Account pages show the same body prefix as discussion lists below
+                    comment_projection projection;
+                    projection.body_bytes = 1024;
+
                     std::vector<std::string> part;
                     part.reserve(4);
                     boost::split(part, path, boost::is_any_of("/"));
@@ -2277,7 +2644,17 @@ namespace steemit {
                         }
                         auto &eacnt = _state.accounts[acnt];
                         if (part[1] == "transfers") {
-                            auto history = get_account_history(acnt, uint64_t(-1), 1000);
+                            // Posts, votes and market operations are not shown on
+                            // the page, so they are not even unpacked
+                            account_history_query query;
+                            query.account = acnt;
+                            query.limit = 1000;
+                            query.operations = ~operation_mask<
+                                    comment_operation, vote_operation,
+                                    limit_order_create_operation, limit_order_cancel_operation,
+                                    fill_convert_request_operation, fill_order_operation,
+                                    account_witness_vote_operation, account_witness_proxy_operation>();
+                            auto history = my->get_account_history_by_query(query);
                             for (auto &item : history) {
                                 switch (item.second.op.which()) {
                                     case operation::tag<transfer_to_vesting_operation>::value:
@@ -2345,8 +2722,7 @@ namespace steemit {
                                     const auto link = acnt + "/" +
                                                       to_string(itr->permlink);
                                     eacnt.comments->push_back(link);
-                                    _state.content[link] = *itr;
-                                    set_pending_payout(_state.content[link]);
+                                    _state.content[link] = get_discussion(itr->id, projection);
                                     ++count;
                                 }
 
@@ -2362,8 +2738,7 @@ namespace steemit {
                                     const auto link =
                                             b.author + "/" + b.permlink;
                                     eacnt.blog->push_back(link);
-                                    _state.content[link] = my->_db.get_comment(b.author, b.permlink);
-                                    set_pending_payout(_state.content[link]);
+                                    _state.content[link] = get_discussion(my->_db.get_comment(b.author, b.permlink).id, projection);
 
                                     if (b.reblog_on > time_point_sec()) {
                                         _state.content[link].first_reblogged_on = b.reblog_on;
@@ -2379,8 +2754,7 @@ namespace steemit {
                                     const auto link =
                                             f.author + "/" + f.permlink;
                                     eacnt.feed->push_back(link);
-                                    _state.content[link] = my->_db.get_comment(f.author, f.permlink);
-                                    set_pending_payout(_state.content[link]);
+                                    _state.content[link] = get_discussion(my->_db.get_comment(f.author, f.permlink).id, projection);
                                     if (f.reblog_by.size()) {
                                         if (f.reblog_by.size()) {
                                             _state.content[link].first_reblogged_by = f.reblog_by[0];
@@ -2612,13 +2986,18 @@ namespace steemit {
                     for (const auto &a : accounts) {
                         _state.accounts.erase("");
                         _state.accounts[a] = extended_account(my->_db.get_account(a), my->_db);
-                        if (my->_follow_api) {
-                            _state.accounts[a].reputation = my->_follow_api->get_account_reputations(a, 1)[0].reputation;
+                    }
+                    if (my->_follow_api) {
+                        for (const auto &rep : my->_follow_api->get_reputations(accounts)) {
+                            _state.accounts[rep.account].reputation = rep.reputation;
                         }
                     }
+                    std::vector<discussion *> discussions;
                     for (auto &d : _state.content) {
                         d.second.active_votes = get_active_votes(d.second.author, d.second.permlink);
+                        discussions.push_back(&d.second);
                     }
+                    set_author_reputations(discussions);
 
                     _state.witness_schedule = my->_db.get_witness_schedule_object();
 
@@ -0,0 +1,203 @@
+#include <steemit/app/discussion_cache.hpp>
+
+#include <steemit/chain/comment_object.hpp>
+#include <steemit/chain/operation_notification.hpp>
+
+#include <vector>
+
+namespace steemit {
+    namespace app {
+
+        using namespace steemit::protocol;
+
+        struct discussion_invalidation_visitor {
+            typedef void result_type;
+
+            discussion_invalidation_visitor(discussion_cache &cache)
+                    : _cache(cache) {
+            }
+
+            discussion_cache &_cache;
+
+            void operator()(const comment_operation &op) const {
+                _cache.invalidate(op.author, op.permlink);
+                if (op.parent_author != STEEMIT_ROOT_POST_PARENT) {
+                    _cache.invalidate(op.parent_author, op.parent_permlink);
+                }
+            }
+
+            void operator()(const vote_operation &op) const {
+                _cache.invalidate(op.author, op.permlink);
+                // Reputation of the author changes with the vote
+                _cache.invalidate_account(op.author);
+            }
+
+            void operator()(const comment_options_operation &op) const {
+                _cache.invalidate(op.author, op.permlink);
+            }
+
+            void operator()(const delete_comment_operation &op) const {
+                // Parent is not known from the operation, the reply count of it changes
+                _cache.clear();
+            }
+
+            void operator()(const author_reward_operation &op) const {
+                _cache.invalidate(op.author, op.permlink);
+            }
+
+            void operator()(const curation_reward_operation &op) const {
+                _cache.invalidate(op.comment_author, op.comment_permlink);
+            }
+
+            void operator()(const comment_reward_operation &op) const {
+                _cache.invalidate(op.author, op.permlink);
+            }
+
+            void operator()(const comment_payout_update_operation &op) const {
+                _cache.invalidate(op.author, op.permlink);
+            }
+
+            void operator()(const transfer_operation &op) const {
+                // Promotion is a transfer to the null account
+                if (op.to == STEEMIT_NULL_ACCOUNT) {
+                    _cache.clear();
+                }
+            }
+
+            template<typename Op>
+            void operator()(const Op &) const {
+            }
+        };
+
+        discussion_cache::discussion_cache(chain::database &db, size_t max_size)
+                : _db(db), _max_size(max_size) {
+        }
+
+        void discussion_cache::connect() {
+            std::weak_ptr<discussion_cache> weak_self = shared_from_this();
+            _db.subscribe_operations<
+                    comment_operation, vote_operation, comment_options_operation,
+                    delete_comment_operation, transfer_operation,
+                    author_reward_operation, curation_reward_operation,
+                    comment_reward_operation, comment_payout_update_operation
+            >(_db.pre_apply_handlers(), "discussion_cache.pre_apply_operation", [weak_self](const chain::operation_notification &note) {
+                auto self = weak_self.lock();
+                if (self) {
+                    self->on_operation(note);
+                }
+            });
+        }
+
+        void discussion_cache::on_operation(const chain::operation_notification &note) {
+            note.op.visit(discussion_invalidation_visitor(*this));
+        }
+
+        void discussion_cache::sync_head_block() const {
+            auto head_block_id = _db.head_block_id();
+            if (head_block_id != _head_block_id) {
+                clear_locked();
+                _head_block_id = head_block_id;
+            }
+        }
+
+        void discussion_cache::erase(index_type::iterator itr) const {
+            const discussion &d = *itr->second;
+
+            auto unlink = [&](const std::string &account) {
+                auto range = _by_account.equal_range(account);
+                for (auto account_itr = range.first; account_itr != range.second; ++account_itr) {
+                    if (account_itr->second == itr->first) {
+                        _by_account.erase(account_itr);
+                        break;
+                    }
+                }
+            };
+
+            unlink(d.author);
+            for (const auto &vote : d.active_votes) {
+                unlink(vote.voter);
+            }
+
+            _lru.erase(itr->second);
+            _index.erase(itr);
+        }
+
+        void discussion_cache::clear_locked() const {
+            _lru.clear();
+            _index.clear();
+            _by_account.clear();
+        }
+
+        bool discussion_cache::get(chain::comment_id_type id, discussion &result) const {
+            fc::scoped_lock<fc::mutex> lock(_mutex);
+            sync_head_block();
+
+            auto itr = _index.find(id._id);
+            if (itr == _index.end()) {
+                return false;
+            }
+
+            _lru.splice(_lru.begin(), _lru, itr->second);
+            result = *itr->second;
+            return true;
+        }
+
+        void discussion_cache::put(const discussion &d) const {
+            fc::scoped_lock<fc::mutex> lock(_mutex);
+            sync_head_block();
+
+            auto itr = _index.find(d.id._id);
+            if (itr != _index.end()) {
+                erase(itr);
+            }
+
+            while (!_lru.empty() && _index.size() >= _max_size) {
+                erase(_index.find(_lru.back().id._id));
+            }
+
+            _lru.push_front(d);
+            _index[d.id._id] = _lru.begin();
+
+            _by_account.emplace(d.author, d.id._id);
+            for (const auto &vote : d.active_votes) {
+                _by_account.emplace(vote.voter, d.id._id);
+            }
+        }
+
+        void discussion_cache::invalidate(const std::string &author, const std::string &permlink) {
+            const auto *comment = _db.find_comment(author, permlink);
+            if (comment == nullptr) {
+                return;
+            }
+
+            fc::scoped_lock<fc::mutex> lock(_mutex);
+            auto itr = _index.find(comment->id._id);
+            if (itr != _index.end()) {
+                erase(itr);
+            }
+        }
+
+        void discussion_cache::invalidate_account(const std::string &account) {
+            fc::scoped_lock<fc::mutex> lock(_mutex);
+
+            std::vector<int64_t> ids;
+            auto range = _by_account.equal_range(account);
+            for (auto itr = range.first; itr != range.second; ++itr) {
+                ids.push_back(itr->second);
+            }
+
+            for (auto id : ids) {
+                auto itr = _index.find(id);
+                if (itr != _index.end()) {
+                    erase(itr);
+                }
+            }
+        }
+
+        void discussion_cache::clear() {
+            fc::scoped_lock<fc::mutex> lock(_mutex);
+            clear_locked();
+        }
+
+    }
+}
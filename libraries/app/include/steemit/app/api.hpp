@@ -164,6 +164,12 @@ namespace steemit {
              */
             std::vector<graphene::net::potential_peer_record> get_potential_peers() const;
 
+            /**
+             * @brief Get p2p metrics: message rates, peer latencies, queue depths,
+             *        sync backlog and durations of blockchain calls
+             */
+            fc::variant get_metrics() const;
+
             /// internal method, not exposed via JSON RPC
             void on_api_startup();
 
@@ -241,6 +247,7 @@ FC_API(steemit::app::network_node_api,
                 (get_potential_peers)
                 (get_advanced_node_parameters)
                 (set_advanced_node_parameters)
+                (get_metrics)
 )
 FC_API(steemit::app::login_api,
         (login)
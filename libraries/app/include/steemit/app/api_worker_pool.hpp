@@ -0,0 +1,80 @@
+#pragma once
+
+#include <fc/thread/thread.hpp>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace steemit {
+    namespace app {
+
+        /**
+         *  @class api_worker_pool
+         *  @brief Runs read-only API calls on dedicated threads
+         *
+         *  API calls arrive on the application thread which also serves the
+         *  websocket connections and applies blocks. Calls wrapped into @ref run
+         *  are executed by the least loaded worker thread while the calling fc
+         *  task waits for the result, so the application thread keeps parsing
+         *  and dispatching other requests meanwhile. The callbacks take chainbase
+         *  read locks on their own, so any number of them run concurrently
+         *  between block writes.
+         *
+         *  A pool without threads runs callbacks in place, which is the old
+         *  single threaded behavior.
+         */
+        class api_worker_pool {
+        public:
+            explicit api_worker_pool(uint32_t thread_count, const std::string &name = "api worker");
+
+            ~api_worker_pool();
+
+            uint32_t size() const {
+                return static_cast<uint32_t>(_workers.size());
+            }
+
+            /// Returns true if called by one of the pool threads
+            bool in_worker() const;
+
+            template<typename Lambda>
+            auto run(Lambda &&callback) -> decltype(callback()) {
+                // Nested calls (e.g. get_state using get_discussions_by_*)
+                // are already on a worker and must not wait for another one
+                if (_workers.empty() || in_worker()) {
+                    return callback();
+                }
+
+                worker &w = least_loaded();
+                pending_guard guard(w.pending);
+                return w.thread->async(callback, _name.c_str()).wait();
+            }
+
+        private:
+            struct worker {
+                std::shared_ptr<fc::thread> thread;
+                std::atomic<uint32_t> pending{0};
+            };
+
+            struct pending_guard {
+                explicit pending_guard(std::atomic<uint32_t> &counter)
+                        : _counter(counter) {
+                    ++_counter;
+                }
+
+                ~pending_guard() {
+                    --_counter;
+                }
+
+                std::atomic<uint32_t> &_counter;
+            };
+
+            worker &least_loaded();
+
+            std::string _name;
+            std::vector<std::unique_ptr<worker>> _workers;
+        };
+
+    }
+}
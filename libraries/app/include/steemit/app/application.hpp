@@ -50,6 +50,10 @@ namespace steemit {
 
         class login_api;
 
+        class discussion_cache;
+
+        class api_worker_pool;
+
         class application {
         public:
             application();
@@ -95,6 +99,17 @@ namespace steemit {
             graphene::net::node_ptr p2p_node();
 
             std::shared_ptr<chain::database> chain_database() const;
+
+            /// Returns nullptr if the cache is disabled
+            std::shared_ptr<discussion_cache> get_discussion_cache() const;
+
+            std::shared_ptr<api_worker_pool> get_api_worker_pool() const;
+
+            /**
+             *  Signal API subscriptions are notified of applied blocks with,
+             *  received from the writer node in read-only replica mode
+             */
+            fc::signal<void(const chain::signed_block &)> &applied_block_signal();
             //std::shared_ptr<graphene::db::object_database> pending_trx_database() const;
 
             void set_block_production(bool producing_blocks);
@@ -92,12 +92,52 @@ namespace steemit {
             std::set<std::string> select_tags; ///< list of tags to include, posts without these tags are filtered
             std::set<std::string> filter_tags; ///< list of tags to exclude, posts with these tags are filtered;
             uint32_t truncate_body = 0; ///< the amount of bytes of the post body to return, 0 for all
+            bool exclude_body = false; ///< do not return the post body at all, body_length is still set
+            bool exclude_json_metadata = false; ///< do not return json_metadata of the posts
             optional<std::string> start_author; ///< the author of discussion to start searching from
             optional<std::string> start_permlink; ///< the permlink of discussion to start searching from
             optional<std::string> parent_author; ///< the author of parent discussion
             optional<std::string> parent_permlink; ///< the permlink of parent discussion
+
+            comment_projection projection() const {
+                comment_projection result;
+                result.body = !exclude_body;
+                result.body_bytes = truncate_body;
+                result.json_metadata = !exclude_json_metadata;
+                return result;
+            }
         };
 
+/**
+ * @class account_history_query
+ * @brief Filters account history by operation types and time, only matching operations are unpacked
+ */
+
+        class account_history_query {
+        public:
+            void validate() const {
+                FC_ASSERT(limit <= 2000, "Limit of ${l} is greater than maxmimum allowed", ("l", limit));
+                FC_ASSERT(!start_time || !end_time || *start_time <= *end_time);
+            }
+
+            std::string account;
+            uint64_t from = uint64_t(-1); ///< the sequence to start from, -1 means most recent
+            uint32_t limit = 0; ///< the maximum amount of operations returned
+            uint64_t operations = 0; ///< bit N selects the operation with tag N, 0 selects all operations
+            optional<time_point_sec> start_time; ///< the oldest operation time to return
+            optional<time_point_sec> end_time; ///< the newest operation time to return
+        };
+
+        /// Returns the account_history_query::operations mask selecting the given operation types
+        template<typename... Ops>
+        uint64_t operation_mask() {
+            uint64_t result = 0;
+            for (int64_t tag : {int64_t(operation::tag<Ops>::value)...}) {
+                result |= uint64_t(1) << tag;
+            }
+            return result;
+        }
+
 /**
  * @brief The database_api class implements the RPC API for the chain database.
  *
@@ -115,6 +155,15 @@ namespace steemit {
             // Subscriptions //
             ///////////////////
 
+            /**
+             * @brief Register a callback for changes of the objects returned by this API
+             *
+             * Accounts, witnesses and dynamic global properties returned by get_accounts,
+             * lookup_account_names, get_witnesses, get_witness_by_account and
+             * get_dynamic_global_properties after this call are added to the subscribe
+             * filter. After every block and pushed transaction the callback receives an
+             * array of the changed objects, removed objects are sent as their type and id.
+             */
             void set_subscribe_callback(std::function<void(const variant &)> cb, bool clear_filter);
 
             void set_pending_transaction_callback(std::function<void(const variant &)> cb);
@@ -364,6 +413,19 @@ namespace steemit {
 
             std::vector<account_vote> get_account_votes(std::string voter) const;
 
+            /**
+             *  Returns up to limit votes of voter starting from the most recent one. If start_author
+             *  and start_permlink are given the page starts from the vote on that comment inclusively,
+             *  so the last vote of the previous page may be used as the start of the next one.
+             */
+            std::vector<account_vote> get_account_votes_by_time(std::string voter, std::string start_author, std::string start_permlink, uint32_t limit) const;
+
+            /**
+             *  Returns up to limit votes of voter ordered by the comment creation, starting from the
+             *  vote on start_author/start_permlink inclusively or from the first vote if they are empty
+             */
+            std::vector<account_vote> get_account_votes_by_comment(std::string voter, std::string start_author, std::string start_permlink, uint32_t limit) const;
+
 
             discussion get_content(std::string author, std::string permlink) const;
 
@@ -489,6 +551,13 @@ namespace steemit {
              */
             std::map<uint32_t, applied_operation> get_account_history(std::string account, uint64_t from, uint32_t limit) const;
 
+            /**
+             *  Returns up to limit most recent operations of the account matching the query, starting
+             *  from the sequence query.from. Operations are selected by the history indexes by type
+             *  and time, so only the returned ones are unpacked.
+             */
+            std::map<uint32_t, applied_operation> get_account_history_by_query(const account_history_query &query) const;
+
             ////////////////////////////
             // Handlers - not exposed //
             ////////////////////////////
@@ -497,10 +566,17 @@ namespace steemit {
         private:
             void set_pending_payout(discussion &d) const;
 
+            /// Resolves the reputations of the authors of a result set at once
+            void set_author_reputations(const std::vector<discussion *> &discussions) const;
+
+            void set_author_reputations(std::vector<discussion> &discussions) const;
+
             void set_url(discussion &d) const;
 
             discussion get_discussion(comment_id_type, uint32_t truncate_body = 0) const;
 
+            discussion get_discussion(comment_id_type, const comment_projection &projection) const;
+
             static bool filter_default(const comment_api_obj &c) {
                 return false;
             }
@@ -537,7 +613,9 @@ FC_REFLECT(steemit::app::scheduled_hardfork, (hf_version)(live_time));
 FC_REFLECT(steemit::app::liquidity_balance, (account)(weight));
 FC_REFLECT(steemit::app::withdraw_route, (from_account)(to_account)(percent)(auto_vest));
 
-FC_REFLECT(steemit::app::discussion_query, (select_tags)(filter_tags)(select_authors)(truncate_body)(start_author)(start_permlink)(parent_author)(parent_permlink)(limit));
+FC_REFLECT(steemit::app::discussion_query, (select_tags)(filter_tags)(select_authors)(truncate_body)(exclude_body)(exclude_json_metadata)(start_author)(start_permlink)(parent_author)(parent_permlink)(limit));
+
+FC_REFLECT(steemit::app::account_history_query, (account)(from)(limit)(operations)(start_time)(end_time));
 
 FC_REFLECT_ENUM(steemit::app::withdraw_route_type, (incoming)(outgoing)(all));
 
@@ -597,6 +675,7 @@ FC_API(steemit::app::database_api,
                 (get_account_count)
                 (get_conversion_requests)
                 (get_account_history)
+                (get_account_history_by_query)
                 (get_owner_history)
                 (get_recovery_request)
                 (get_escrow)
@@ -621,6 +700,8 @@ FC_API(steemit::app::database_api,
                 // votes
                 (get_active_votes)
                 (get_account_votes)
+                (get_account_votes_by_time)
+                (get_account_votes_by_comment)
 
                 // content
                 (get_content)
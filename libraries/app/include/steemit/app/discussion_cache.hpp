@@ -0,0 +1,84 @@
+#pragma once
+
+#include <steemit/app/state.hpp>
+
+#include <steemit/chain/database.hpp>
+
+#include <fc/thread/mutex.hpp>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace steemit {
+    namespace app {
+
+        /**
+         *  @class discussion_cache
+         *  @brief Keeps materialized discussions shared by all database_api instances
+         *
+         *  A cached discussion contains everything database_api::get_discussion
+         *  computes (url, pending payout, active votes with reputations) except
+         *  body and json_metadata, which are copied from the comment per request
+         *  according to the query projection. The cache is versioned by head block: pending payout
+         *  depends on global properties which change with every block, so the whole
+         *  cache is dropped as soon as the head block changes. Between blocks the
+         *  entries affected by pending transactions (comments, votes, comment
+         *  options, deletes, payouts) are invalidated when the operations are applied.
+         *  A vote changes the reputation of the voted author, so every entry
+         *  written or voted by that author is dropped too.
+         *
+         *  Entries are evicted in least recently used order. Lookups are made
+         *  under the database read lock by many API sessions at once,
+         *  invalidation is made under the write lock.
+         */
+        class discussion_cache : public std::enable_shared_from_this<discussion_cache> {
+        public:
+            discussion_cache(chain::database &db, size_t max_size);
+
+            /// Subscribes to database operations, should be called once the cache is owned by a shared_ptr
+            void connect();
+
+            bool get(chain::comment_id_type id, discussion &result) const;
+
+            void put(const discussion &d) const;
+
+            void invalidate(const std::string &author, const std::string &permlink);
+
+            /// Drops discussions written or voted by the account, their reputation is part of the entry
+            void invalidate_account(const std::string &account);
+
+            void clear();
+
+            size_t max_size() const {
+                return _max_size;
+            }
+
+        private:
+            typedef std::list<discussion> lru_list_type;
+            typedef std::unordered_map<int64_t, lru_list_type::iterator> index_type;
+            typedef std::unordered_multimap<std::string, int64_t> account_index_type;
+
+            /// Drops entries of the previous head block, should be called with the mutex locked
+            void sync_head_block() const;
+
+            /// Removes the entry with its account references, should be called with the mutex locked
+            void erase(index_type::iterator itr) const;
+
+            void clear_locked() const;
+
+            void on_operation(const chain::operation_notification &note);
+
+            chain::database &_db;
+            const size_t _max_size;
+
+            mutable fc::mutex _mutex;
+            mutable lru_list_type _lru; ///< most recently used discussions first
+            mutable index_type _index;
+            mutable account_index_type _by_account; ///< author and voters of cached discussions
+            mutable chain::block_id_type _head_block_id;
+        };
+
+    }
+}
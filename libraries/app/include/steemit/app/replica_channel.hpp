@@ -0,0 +1,113 @@
+#pragma once
+
+#include <steemit/chain/database.hpp>
+
+#include <fc/network/ip.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/future.hpp>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace steemit {
+    namespace app {
+
+        /**
+         *  Message sent by the writer node to read-only replicas after every
+         *  applied block
+         */
+        struct replica_notification {
+            chain::signed_block block;
+        };
+
+        /**
+         *  @class replica_publisher
+         *  @brief Notifies read-only replicas sharing the memory file of applied blocks
+         *
+         *  Replicas map the same shared memory file as the writer node and read
+         *  it under the chainbase read lock, which is shared between processes,
+         *  so every read sees a consistent state between two blocks. The
+         *  publisher only tells them a new block was applied, to let them run
+         *  block subscriptions of their API clients.
+         *
+         *  Notifications are queued in the applied_block handler and written by
+         *  a separate task per replica, because the handler runs under the write
+         *  lock and must not yield. A replica which lets its queue grow beyond
+         *  the limit is disconnected, it resyncs by connecting again.
+         *
+         *  With a shared secret the publisher sends a random nonce to a connecting
+         *  replica, which answers with the HMAC-SHA256 of the nonce keyed by the
+         *  secret, so a captured handshake can't be replayed. Without a secret
+         *  only loopback connections are accepted.
+         *
+         *  Has to be owned by a shared pointer, the connection tasks keep only a
+         *  weak reference to it.
+         */
+        class replica_publisher : public std::enable_shared_from_this<replica_publisher> {
+        public:
+            replica_publisher(chain::database &db, const std::string &secret);
+
+            ~replica_publisher();
+
+            void listen(const fc::ip::endpoint &endpoint);
+
+        private:
+            struct replica {
+                std::shared_ptr<fc::tcp_socket> socket;
+                std::deque<std::shared_ptr<std::vector<char>>> queue;
+                bool sending = false;
+                bool closed = false;
+            };
+
+            void accept_loop();
+
+            /// Runs the handshake of a new connection, returns true if the replica may subscribe
+            static bool authenticate(replica &r, const std::string &secret);
+
+            void publish(const chain::signed_block &block);
+
+            static void send_loop(std::shared_ptr<replica> r);
+
+            chain::database &_db;
+            std::string _secret;
+            fc::tcp_server _server;
+            fc::future<void> _accept_loop_done;
+            std::vector<std::shared_ptr<replica>> _replicas;
+            boost::signals2::scoped_connection _applied_block_connection;
+        };
+
+        /**
+         *  @class replica_subscriber
+         *  @brief Receives applied block notifications in a read-only replica
+         *
+         *  Reconnects to the writer node if the connection is lost. The replica
+         *  database is opened read-only, so the blocks are emitted through
+         *  @ref applied_block instead of database::applied_block, whose plugin
+         *  subscribers write to the database.
+         */
+        class replica_subscriber {
+        public:
+            replica_subscriber(const fc::ip::endpoint &endpoint, const std::string &secret);
+
+            ~replica_subscriber();
+
+            void start();
+
+            fc::signal<void(const chain::signed_block &)> applied_block;
+
+        private:
+            void read_loop();
+
+            fc::ip::endpoint _endpoint;
+            std::string _secret;
+            bool _closing = false;
+            std::shared_ptr<fc::tcp_socket> _socket;
+            fc::future<void> _read_loop_done;
+        };
+
+    }
+}
+
+FC_REFLECT(steemit::app::replica_notification, (block))
@@ -71,6 +71,10 @@ namespace steemit {
             discussion(const comment_object &o) : comment_api_obj(o) {
             }
 
+            discussion(const comment_object &o, const comment_projection &projection)
+                    : comment_api_obj(o, projection) {
+            }
+
             discussion() {
             }
 
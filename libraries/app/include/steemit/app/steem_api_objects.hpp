@@ -53,8 +53,38 @@ namespace steemit {
         typedef chain::witness_schedule_object witness_schedule_api_obj;
         typedef chain::account_bandwidth_object account_bandwidth_api_obj;
 
+        /**
+         *  Declares which of the large text fields of a comment are copied from
+         *  the shared memory into the API object
+         */
+        struct comment_projection {
+            bool body = true;
+            uint32_t body_bytes = 0; ///< the amount of body bytes to copy, 0 for all
+            bool json_metadata = true;
+
+            /// Copies neither body nor json_metadata
+            static comment_projection none() {
+                comment_projection result;
+                result.body = false;
+                result.json_metadata = false;
+                return result;
+            }
+        };
+
+        /// Copies at most max_bytes of the shared string, the whole string if max_bytes is 0
+        inline string copy_prefix(const shared_string &s, uint32_t max_bytes) {
+            if (max_bytes == 0 || max_bytes >= s.size()) {
+                return string(s.begin(), s.end());
+            }
+            return string(s.begin(), s.begin() + max_bytes);
+        }
+
         struct comment_api_obj {
-            comment_api_obj(const chain::comment_object &o) :
+            comment_api_obj(const chain::comment_object &o)
+                    : comment_api_obj(o, comment_projection()) {
+            }
+
+            comment_api_obj(const chain::comment_object &o, const comment_projection &projection) :
                     id(o.id),
                     category(to_string(o.category)),
                     parent_author(o.parent_author),
@@ -62,8 +92,8 @@ namespace steemit {
                     author(o.author),
                     permlink(to_string(o.permlink)),
                     title(to_string(o.title)),
-                    body(to_string(o.body)),
-                    json_metadata(to_string(o.json_metadata)),
+                    body(projection.body ? copy_prefix(o.body, projection.body_bytes) : string()),
+                    json_metadata(projection.json_metadata ? to_string(o.json_metadata) : string()),
                     last_update(o.last_update),
                     created(o.created),
                     active(o.active),
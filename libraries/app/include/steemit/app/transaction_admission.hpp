@@ -0,0 +1,59 @@
+#pragma once
+
+#include <steemit/app/api_worker_pool.hpp>
+
+#include <steemit/chain/database.hpp>
+
+#include <fc/thread/future.hpp>
+
+#include <unordered_set>
+#include <vector>
+
+namespace steemit {
+    namespace app {
+
+        /**
+         *  @class transaction_admission_queue
+         *  @brief Validates transactions received from the network before they take the write lock
+         *
+         *  Checks which don't change the state (validate(), size, duplicates,
+         *  expiration, TaPoS and signature recovery) run on worker threads under
+         *  the read lock, so floods of duplicated, expired or badly signed
+         *  transactions never reach the write lock. Transactions passing them
+         *  are pushed in batches, one write lock per batch, together with the
+         *  recovered keys, so the push only checks the authorities.
+         *
+         *  @ref push must be called on the application thread. Without worker
+         *  threads transactions are pushed directly, which is the old behavior.
+         */
+        class transaction_admission_queue {
+        public:
+            transaction_admission_queue(chain::database &db, uint32_t thread_count, uint32_t max_batch_size);
+
+            ~transaction_admission_queue();
+
+            /// Waits until the transaction is pushed, throws if it was rejected
+            void push(const chain::signed_transaction &trx);
+
+        private:
+            struct pending_transaction {
+                chain::signed_transaction trx;
+                flat_set<protocol::public_key_type> signature_keys;
+                fc::promise<void>::ptr result;
+            };
+
+            /// Duplicate of the checks done by database::_apply_transaction which need no write lock, returns the signature keys
+            flat_set<protocol::public_key_type> prevalidate(const chain::signed_transaction &trx);
+
+            void push_batches();
+
+            chain::database &_db;
+            api_worker_pool _workers;
+            uint32_t _max_batch_size;
+            std::unordered_set<chain::transaction_id_type> _in_flight; ///< ids between @ref push and the end of their batch
+            std::vector<pending_transaction> _pending;
+            fc::future<void> _push_batches_done;
+        };
+
+    }
+}
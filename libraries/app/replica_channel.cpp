@@ -0,0 +1,240 @@
+#include <steemit/app/replica_channel.hpp>
+
+#include <fc/crypto/hmac.hpp>
+#include <fc/crypto/rand.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/thread/thread.hpp>
+
+namespace steemit {
+    namespace app {
+
+        namespace {
+
+            /// A notification holds a single block, which is never larger than this
+            const uint32_t max_notification_size = STEEMIT_MAX_BLOCK_SIZE * 2;
+
+            const fc::microseconds reconnect_interval = fc::seconds(1);
+
+            /// Replica which is this many blocks behind is disconnected
+            const size_t max_queued_notifications = 100;
+
+            const fc::microseconds handshake_timeout = fc::seconds(5);
+
+            fc::sha256 handshake_response(const std::string &secret, const fc::sha256 &nonce) {
+                fc::hmac<fc::sha256> hmac;
+                return hmac.digest(secret.data(), static_cast<uint32_t>(secret.size()), nonce.data(), nonce.data_size());
+            }
+
+            /// Compares all bytes whatever the first difference is, not to leak it by the timing
+            bool constant_time_equal(const fc::sha256 &a, const fc::sha256 &b) {
+                unsigned char difference = 0;
+                for (uint32_t i = 0; i < a.data_size(); ++i) {
+                    difference |= static_cast<unsigned char>(a.data()[i] ^ b.data()[i]);
+                }
+                return difference == 0;
+            }
+
+        }
+
+        replica_publisher::replica_publisher(chain::database &db, const std::string &secret)
+                : _db(db), _secret(secret) {
+        }
+
+        replica_publisher::~replica_publisher() {
+            _applied_block_connection.disconnect();
+            _server.close();
+
+            if (_accept_loop_done.valid() && !_accept_loop_done.ready()) {
+                _accept_loop_done.cancel_and_wait("replica_publisher destroyed");
+            }
+
+            for (auto &r : _replicas) {
+                r->closed = true;
+                r->socket->close();
+            }
+        }
+
+        void replica_publisher::listen(const fc::ip::endpoint &endpoint) {
+            try {
+                _server.set_reuse_address();
+                _server.listen(endpoint);
+                _applied_block_connection = _db.applied_block.connect([this](const chain::signed_block &b) { publish(b); });
+                _accept_loop_done = fc::async([this]() { accept_loop(); }, "replica accept loop");
+                ilog("Publishing applied blocks to read-only replicas on ${e}", ("e", endpoint));
+            } FC_CAPTURE_AND_RETHROW((endpoint))
+        }
+
+        void replica_publisher::accept_loop() {
+            while (!_accept_loop_done.canceled()) {
+                auto r = std::make_shared<replica>();
+                r->socket = std::make_shared<fc::tcp_socket>();
+                try {
+                    _server.accept(*r->socket);
+                } catch (const fc::canceled_exception &) {
+                    return;
+                } catch (const fc::exception &e) {
+                    wlog("Error accepting replica connection: ${e}", ("e", e.to_detail_string()));
+                    continue;
+                }
+
+                std::weak_ptr<replica_publisher> weak_self(shared_from_this());
+                std::string secret = _secret;
+                fc::async([weak_self, secret, r]() {
+                    auto remote_endpoint = r->socket->remote_endpoint();
+                    if (!authenticate(*r, secret)) {
+                        wlog("Rejected read-only replica connection from ${e}", ("e", remote_endpoint));
+                        r->socket->close();
+                        return;
+                    }
+
+                    auto self = weak_self.lock();
+                    if (!self) {
+                        r->socket->close();
+                        return;
+                    }
+                    ilog("Read-only replica connected from ${e}", ("e", remote_endpoint));
+                    self->_replicas.push_back(r);
+                }, "replica handshake");
+            }
+        }
+
+        bool replica_publisher::authenticate(replica &r, const std::string &secret) {
+            if (secret.empty()) {
+                return r.socket->remote_endpoint().get_address().is_loopback_address();
+            }
+
+            auto socket = r.socket;
+            auto timeout = fc::schedule([socket]() { socket->close(); },
+                    fc::time_point::now() + handshake_timeout, "replica handshake timeout");
+
+            fc::sha256 nonce;
+            fc::rand_bytes(nonce.data(), nonce.data_size());
+            fc::sha256 response;
+            try {
+                r.socket->write(nonce.data(), nonce.data_size());
+                r.socket->flush();
+                r.socket->read(response.data(), response.data_size());
+            } catch (const fc::exception &) {
+                return false;
+            }
+
+            if (!timeout.ready()) {
+                timeout.cancel("replica handshake done");
+            }
+            return constant_time_equal(response, handshake_response(secret, nonce));
+        }
+
+        void replica_publisher::publish(const chain::signed_block &block) {
+            if (_replicas.empty()) {
+                return;
+            }
+
+            replica_notification notification;
+            notification.block = block;
+            auto data = std::make_shared<std::vector<char>>(fc::raw::pack(notification));
+
+            for (auto itr = _replicas.begin(); itr != _replicas.end();) {
+                auto r = *itr;
+                if (r->closed) {
+                    itr = _replicas.erase(itr);
+                    continue;
+                }
+
+                if (r->queue.size() >= max_queued_notifications) {
+                    wlog("Read-only replica ${e} is ${n} blocks behind, disconnecting it",
+                            ("e", r->socket->remote_endpoint())("n", r->queue.size()));
+                    r->closed = true;
+                    r->queue.clear();
+                    r->socket->close();
+                    itr = _replicas.erase(itr);
+                    continue;
+                }
+
+                r->queue.push_back(data);
+                if (!r->sending) {
+                    r->sending = true;
+                    fc::async([r]() { send_loop(r); }, "replica send loop");
+                }
+                ++itr;
+            }
+        }
+
+        void replica_publisher::send_loop(std::shared_ptr<replica> r) {
+            try {
+                while (!r->closed && !r->queue.empty()) {
+                    auto data = r->queue.front();
+                    r->queue.pop_front();
+
+                    uint32_t size = static_cast<uint32_t>(data->size());
+                    r->socket->write(reinterpret_cast<const char *>(&size), sizeof(size));
+                    r->socket->write(data->data(), data->size());
+                    r->socket->flush();
+                }
+            } catch (const fc::exception &e) {
+                wlog("Read-only replica disconnected: ${e}", ("e", e.to_string()));
+                r->closed = true;
+                r->queue.clear();
+            }
+            r->sending = false;
+        }
+
+        replica_subscriber::replica_subscriber(const fc::ip::endpoint &endpoint, const std::string &secret)
+                : _endpoint(endpoint), _secret(secret) {
+        }
+
+        replica_subscriber::~replica_subscriber() {
+            _closing = true;
+            if (_socket) {
+                _socket->close();
+            }
+
+            if (_read_loop_done.valid() && !_read_loop_done.ready()) {
+                _read_loop_done.cancel_and_wait("replica_subscriber destroyed");
+            }
+        }
+
+        void replica_subscriber::start() {
+            _read_loop_done = fc::async([this]() { read_loop(); }, "replica read loop");
+        }
+
+        void replica_subscriber::read_loop() {
+            while (!_closing) {
+                try {
+                    _socket = std::make_shared<fc::tcp_socket>();
+                    _socket->connect_to(_endpoint);
+                    if (!_secret.empty()) {
+                        fc::sha256 nonce;
+                        _socket->read(nonce.data(), nonce.data_size());
+                        fc::sha256 response = handshake_response(_secret, nonce);
+                        _socket->write(response.data(), response.data_size());
+                        _socket->flush();
+                    }
+                    ilog("Connected to the writer node at ${e}", ("e", _endpoint));
+
+                    while (!_closing) {
+                        uint32_t size = 0;
+                        _socket->read(reinterpret_cast<char *>(&size), sizeof(size));
+                        FC_ASSERT(size <= max_notification_size, "Replica notification of ${s} bytes is too large", ("s", size));
+
+                        std::vector<char> data(size);
+                        _socket->read(data.data(), data.size());
+
+                        auto notification = fc::raw::unpack<replica_notification>(data);
+                        applied_block(notification.block);
+                    }
+                } catch (const fc::canceled_exception &) {
+                    return;
+                } catch (const fc::exception &e) {
+                    if (_closing) {
+                        return;
+                    }
+                    wlog("Lost connection to the writer node at ${e}: ${what}", ("e", _endpoint)("what", e.to_string()));
+                }
+
+                fc::usleep(reconnect_interval);
+            }
+        }
+
+    }
+}
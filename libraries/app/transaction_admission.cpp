@@ -0,0 +1,125 @@
+#include <steemit/app/transaction_admission.hpp>
+
+#include <steemit/chain/block_summary_object.hpp>
+
+#include <fc/thread/thread.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace steemit {
+    namespace app {
+
+        using chain::signed_transaction;
+
+        transaction_admission_queue::transaction_admission_queue(chain::database &db, uint32_t thread_count, uint32_t max_batch_size)
+                : _db(db),
+                  _workers(thread_count, "transaction admission"),
+                  _max_batch_size(std::max<uint32_t>(max_batch_size, 1)) {
+        }
+
+        transaction_admission_queue::~transaction_admission_queue() {
+            try {
+                if (_push_batches_done.valid() && !_push_batches_done.ready()) {
+                    _push_batches_done.cancel_and_wait("transaction admission queue destroyed");
+                }
+            } catch (const fc::exception &e) {
+                wlog("Exception while stopping transaction admission: ${e}", ("e", e.to_detail_string()));
+            }
+        }
+
+        flat_set<protocol::public_key_type> transaction_admission_queue::prevalidate(const signed_transaction &trx) {
+            trx.validate();
+
+            const auto trx_id = trx.id();
+            _db.with_read_lock([&]() {
+                FC_ASSERT(!_db.is_known_transaction(trx_id), "Duplicate transaction check failed", ("trx_id", trx_id));
+                FC_ASSERT(fc::raw::pack_size(trx) <=
+                          _db.get_dynamic_global_properties().maximum_block_size - 256);
+
+                if (_db.head_block_num() > 0) {
+                    const auto *tapos_block_summary = _db.find<chain::block_summary_object>(chain::block_summary_id_type(trx.ref_block_num));
+                    FC_ASSERT(tapos_block_summary != nullptr &&
+                              trx.ref_block_prefix == tapos_block_summary->block_id._hash[1],
+                            "Transaction refers to an unknown block", ("trx.ref_block_num", trx.ref_block_num)
+                            ("trx.ref_block_prefix", trx.ref_block_prefix));
+
+                    fc::time_point_sec now = _db.head_block_time();
+                    FC_ASSERT(trx.expiration <= now + fc::seconds(STEEMIT_MAX_TIME_UNTIL_EXPIRATION), "",
+                            ("trx.expiration", trx.expiration)("now", now)("max_til_exp", STEEMIT_MAX_TIME_UNTIL_EXPIRATION));
+                    FC_ASSERT(now < trx.expiration, "", ("now", now)("trx.exp", trx.expiration));
+                }
+            });
+
+            // The most expensive check goes last, throws on malformed and repeated signatures.
+            // Whether the keys satisfy the authorities depends on the state and is checked by the push.
+            return trx.get_signature_keys(STEEMIT_CHAIN_ID);
+        }
+
+        void transaction_admission_queue::push(const signed_transaction &trx) {
+            if (!_workers.size()) {
+                _db.push_transaction(trx);
+                return;
+            }
+
+            const auto trx_id = trx.id();
+            FC_ASSERT(_in_flight.insert(trx_id).second, "Duplicate transaction check failed", ("trx_id", trx_id));
+
+            try {
+                auto signature_keys = _workers.run([&]() { return prevalidate(trx); });
+
+                fc::promise<void>::ptr result(new fc::promise<void>("transaction admission"));
+                _pending.push_back({trx, std::move(signature_keys), result});
+
+                // Transactions which pass prevalidation until the batch task runs join the same batch
+                if (!_push_batches_done.valid() || _push_batches_done.ready()) {
+                    _push_batches_done = fc::async([this]() { push_batches(); }, "push transaction batches");
+                }
+
+                result->wait();
+            } catch (...) {
+                _in_flight.erase(trx_id);
+                throw;
+            }
+            _in_flight.erase(trx_id);
+        }
+
+        void transaction_admission_queue::push_batches() {
+            while (!_pending.empty()) {
+                const auto batch_end = _pending.begin() + std::min<size_t>(_pending.size(), _max_batch_size);
+                std::vector<pending_transaction> batch(std::make_move_iterator(_pending.begin()), std::make_move_iterator(batch_end));
+                _pending.erase(_pending.begin(), batch_end);
+
+                std::vector<signed_transaction> trxs;
+                std::vector<flat_set<protocol::public_key_type>> signature_keys;
+                trxs.reserve(batch.size());
+                signature_keys.reserve(batch.size());
+                for (auto &item : batch) {
+                    trxs.push_back(item.trx);
+                    signature_keys.push_back(std::move(item.signature_keys));
+                }
+
+                try {
+                    auto errors = _db.push_transactions(trxs, signature_keys);
+                    for (size_t i = 0; i < batch.size(); ++i) {
+                        if (errors[i]) {
+                            batch[i].result->set_exception(errors[i]);
+                        } else {
+                            batch[i].result->set_value();
+                        }
+                    }
+                } catch (const fc::exception &e) {
+                    for (auto &item : batch) {
+                        item.result->set_exception(e.dynamic_copy_exception());
+                    }
+                }
+
+                // let blocks waiting for the write lock in between batches
+                if (!_pending.empty()) {
+                    fc::yield();
+                }
+            }
+        }
+
+    }
+}
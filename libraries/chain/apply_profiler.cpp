@@ -0,0 +1,124 @@
+#include <steemit/chain/apply_profiler.hpp>
+
+#include <steemit/protocol/operation_util_impl.hpp>
+
+namespace steemit {
+    namespace chain {
+
+        namespace {
+
+            const char *block_stage_names[] = {
+                    "transactions",
+                    "update_global_dynamic_data",
+                    "update_signing_witness",
+                    "update_last_irreversible_block",
+                    "create_block_summary",
+                    "clear_expired_transactions",
+                    "clear_expired_orders",
+                    "update_witness_schedule",
+                    "update_median_feed",
+                    "update_virtual_supply",
+                    "clear_null_account_balance",
+                    "process_funds",
+                    "process_conversions",
+                    "process_comment_cashout",
+                    "process_vesting_withdrawals",
+                    "process_savings_withdraws",
+                    "pay_liquidity_reward",
+                    "account_recovery_processing",
+                    "expire_escrow_ratification",
+                    "process_decline_voting_rights",
+                    "process_hardforks",
+                    "notify_applied_block"
+            };
+
+            static_assert(sizeof(block_stage_names) / sizeof(block_stage_names[0]) ==
+                          static_cast<size_t>(block_stage::stage_count), "Names of all block stages should be defined");
+
+            struct operation_name_visitor {
+                typedef std::string result_type;
+
+                template<typename Op>
+                std::string operator()(const Op &) const {
+                    return fc::name_from_type(fc::get_typename<Op>::name());
+                }
+            };
+
+        }
+
+        apply_profiler::apply_profiler()
+                : _since(fc::time_point::now()),
+                  _operations(operation::count()),
+                  _stages(static_cast<size_t>(block_stage::stage_count)) {
+        }
+
+        void apply_profiler::enable(bool value) {
+            if (value && !_enabled) {
+                reset();
+            }
+            _enabled = value;
+        }
+
+        uint32_t apply_profiler::register_subscriber(const std::string &name) {
+            for (uint32_t i = 0; i < _subscriber_names.size(); ++i) {
+                if (_subscriber_names[i] == name) {
+                    return i;
+                }
+            }
+
+            _subscriber_names.push_back(name);
+            _subscribers.resize(_subscriber_names.size());
+            return static_cast<uint32_t>(_subscriber_names.size() - 1);
+        }
+
+        apply_profile apply_profiler::get_profile() const {
+            apply_profile result;
+            result.since = _since;
+            result.blocks = _blocks;
+            result.block_total = _block_total;
+
+            operation op;
+            for (int64_t tag = 0; tag < static_cast<int64_t>(_operations.size()); ++tag) {
+                if (_operations[tag].count == 0) {
+                    continue;
+                }
+
+                op.set_which(tag);
+                result.operations[op.visit(operation_name_visitor())] = _operations[tag];
+            }
+
+            for (size_t i = 0; i < _subscribers.size(); ++i) {
+                if (_subscribers[i].count) {
+                    result.subscribers[_subscriber_names[i]] = _subscribers[i];
+                }
+            }
+
+            for (size_t i = 0; i < _stages.size(); ++i) {
+                if (_stages[i].count) {
+                    result.block_stages[block_stage_names[i]] = _stages[i];
+                }
+            }
+
+            return result;
+        }
+
+        void apply_profiler::reset() {
+            _since = fc::time_point::now();
+            _blocks = 0;
+            _block_total = apply_profile_entry();
+
+            for (auto &entry : _operations) {
+                entry = apply_profile_entry();
+            }
+
+            for (auto &entry : _subscribers) {
+                entry = apply_profile_entry();
+            }
+
+            for (auto &entry : _stages) {
+                entry = apply_profile_entry();
+            }
+        }
+
+    }
+}
@@ -216,6 +216,48 @@ namespace steemit {
             return pos;
         }
 
+        std::vector<std::vector<char>> block_log::read_packed_blocks(uint32_t first_block_num, uint32_t count, uint64_t max_bytes) const {
+            try {
+                std::vector<std::vector<char>> result;
+                if (!my->head.valid() || first_block_num == 0 || count == 0) {
+                    return result;
+                }
+                uint32_t head_block_num = protocol::block_header::num_from_id(my->head_id);
+                if (first_block_num > head_block_num) {
+                    return result;
+                }
+                uint32_t last_block_num = uint32_t(std::min<uint64_t>(uint64_t(first_block_num) + count - 1, head_block_num));
+
+                // positions of the blocks and of the block after the last one, the end of the file for the head
+                my->check_index_read();
+                std::vector<uint64_t> positions(last_block_num - first_block_num + 2);
+                my->index_stream.seekg(sizeof(uint64_t) * (first_block_num - 1));
+                my->index_stream.read((char *)positions.data(), sizeof(uint64_t) * (positions.size() - 1));
+                my->check_block_read();
+                if (last_block_num < head_block_num) {
+                    my->index_stream.read((char *)&positions.back(), sizeof(uint64_t));
+                } else {
+                    my->block_stream.seekg(0, std::ios::end);
+                    positions.back() = uint64_t(my->block_stream.tellg());
+                }
+
+                uint64_t total_size = 0;
+                my->block_stream.seekg(positions.front());
+                for (size_t i = 0; i + 1 < positions.size(); ++i) {
+                    uint64_t block_size = positions[i + 1] - positions[i] - sizeof(uint64_t);
+                    if (!result.empty() && total_size + block_size > max_bytes) {
+                        break;
+                    }
+                    total_size += block_size;
+                    result.emplace_back(block_size);
+                    my->block_stream.read(result.back().data(), block_size);
+                    my->block_stream.ignore(sizeof(uint64_t));
+                }
+                return result;
+            }
+            FC_LOG_AND_RETHROW()
+        }
+
         signed_block block_log::read_head() const {
             my->check_block_read();
 
@@ -106,6 +106,8 @@ namespace steemit {
                         });
                     }
 
+                    cache_singletons();
+
                     _block_log.open(data_dir / "block_log");
 
                     auto log_head = _block_log.head();
@@ -129,6 +131,7 @@ namespace steemit {
                 }
 
                 with_read_lock([&]() {
+                    cache_singletons();
                     init_hardforks(); // Writes to local state, but reads from db
                 });
 
@@ -215,6 +218,8 @@ namespace steemit {
                 chainbase::database::flush();
                 chainbase::database::close();
 
+                reset_singletons_cache();
+
                 _block_log.close();
 
                 _fork_db.reset();
@@ -314,6 +319,12 @@ namespace steemit {
             } FC_LOG_AND_RETHROW()
         }
 
+        std::vector<std::vector<char>> database::fetch_packed_blocks(uint32_t first_block_num, uint32_t count, uint64_t max_bytes) const {
+            try {
+                return _block_log.read_packed_blocks(first_block_num, count, max_bytes);
+            } FC_CAPTURE_AND_RETHROW((first_block_num)(count)(max_bytes))
+        }
+
         const signed_transaction database::get_recent_transaction(const transaction_id_type &trx_id) const {
             try {
                 auto &index = get_index<transaction_index>().indices().get<by_trx_id>();
@@ -438,7 +449,25 @@ namespace steemit {
             return find<savings_withdraw_object, by_from_rid>(boost::make_tuple(owner, request_id));
         }
 
+        void database::cache_singletons() {
+            _dgp_cache = find<dynamic_global_property_object>();
+            _feed_history_cache = find<feed_history_object>();
+            _witness_schedule_cache = find<witness_schedule_object>();
+            _hardfork_property_cache = find<hardfork_property_object>();
+        }
+
+        void database::reset_singletons_cache() {
+            _dgp_cache = nullptr;
+            _feed_history_cache = nullptr;
+            _witness_schedule_cache = nullptr;
+            _hardfork_property_cache = nullptr;
+        }
+
         const dynamic_global_property_object &database::get_dynamic_global_properties() const {
+            if (_dgp_cache) {
+                return *_dgp_cache;
+            }
+
             try {
                 return get<dynamic_global_property_object>();
             } FC_CAPTURE_AND_RETHROW()
@@ -449,18 +478,30 @@ namespace steemit {
         }
 
         const feed_history_object &database::get_feed_history() const {
+            if (_feed_history_cache) {
+                return *_feed_history_cache;
+            }
+
             try {
                 return get<feed_history_object>();
             } FC_CAPTURE_AND_RETHROW()
         }
 
         const witness_schedule_object &database::get_witness_schedule_object() const {
+            if (_witness_schedule_cache) {
+                return *_witness_schedule_cache;
+            }
+
             try {
                 return get<witness_schedule_object>();
             } FC_CAPTURE_AND_RETHROW()
         }
 
         const hardfork_property_object &database::get_hardfork_property_object() const {
+            if (_hardfork_property_cache) {
+                return *_hardfork_property_cache;
+            }
+
             try {
                 return get<hardfork_property_object>();
             } FC_CAPTURE_AND_RETHROW()
@@ -774,7 +815,40 @@ namespace steemit {
             FC_CAPTURE_AND_RETHROW((trx))
         }
 
-        void database::_push_transaction(const signed_transaction &trx) {
+        std::vector<fc::exception_ptr> database::push_transactions(const std::vector<signed_transaction> &trxs, uint32_t skip) {
+            return push_transactions(trxs, std::vector<flat_set<public_key_type>>(), skip);
+        }
+
+        std::vector<fc::exception_ptr> database::push_transactions(const std::vector<signed_transaction> &trxs,
+                const std::vector<flat_set<public_key_type>> &signature_keys, uint32_t skip) {
+            FC_ASSERT(signature_keys.empty() || signature_keys.size() == trxs.size());
+            std::vector<fc::exception_ptr> result(trxs.size());
+            try {
+                set_producing(true);
+                detail::with_skip_flags(*this, skip,
+                        [&]() {
+                            with_write_lock([&]() {
+                                const auto max_trx_size = get_dynamic_global_properties().maximum_block_size - 256;
+                                for (size_t i = 0; i < trxs.size(); ++i) {
+                                    try {
+                                        FC_ASSERT(fc::raw::pack_size(trxs[i]) <= max_trx_size);
+                                        _push_transaction(trxs[i], signature_keys.empty() ? nullptr : &signature_keys[i]);
+                                    } catch (const fc::exception &e) {
+                                        result[i] = e.dynamic_copy_exception();
+                                    }
+                                }
+                            });
+                        });
+                set_producing(false);
+            }
+            catch (...) {
+                set_producing(false);
+                throw;
+            }
+            return result;
+        }
+
+        void database::_push_transaction(const signed_transaction &trx, const flat_set<public_key_type> *signature_keys) {
             // If this is the first transaction pushed after applying a block, start a new undo session.
             // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
             if (!_pending_tx_session.valid()) {
@@ -787,7 +861,12 @@ namespace steemit {
             // apply the changes.
 
             auto temp_session = start_undo_session(true);
-            _apply_transaction(trx);
+            try {
+                _apply_transaction(trx, signature_keys);
+            } catch (...) {
+                discard_changed_objects();
+                throw;
+            }
             _pending_tx.push_back(trx);
 
             notify_changed_objects();
@@ -892,6 +971,7 @@ namespace steemit {
                 }
 
                 _pending_tx_session.reset();
+                discard_changed_objects();
             });
 
             // We have temporarily broken the invariant that
@@ -965,6 +1045,8 @@ namespace steemit {
 
                 _fork_db.pop_block();
                 undo();
+                discard_changed_objects();
+                cache_singletons();
 
                 _popped_tx.insert(_popped_tx.begin(), head_block->transactions.begin(), head_block->transactions.end());
 
@@ -978,6 +1060,7 @@ namespace steemit {
                        _pending_tx_session.valid());
                 _pending_tx.clear();
                 _pending_tx_session.reset();
+                discard_changed_objects();
             }
             FC_CAPTURE_AND_RETHROW()
         }
@@ -989,10 +1072,12 @@ namespace steemit {
             note.op_in_trx = _current_op_in_trx;
 
             STEEMIT_TRY_NOTIFY(pre_apply_operation, note)
+            STEEMIT_TRY_NOTIFY(_pre_apply_handlers, note)
         }
 
         void database::notify_post_apply_operation(const operation_notification &note) {
             STEEMIT_TRY_NOTIFY(post_apply_operation, note)
+            STEEMIT_TRY_NOTIFY(_post_apply_handlers, note)
         }
 
         inline const void database::push_virtual_operation(const operation &op, bool force) {
@@ -1003,11 +1088,24 @@ namespace steemit {
             }
 
             FC_ASSERT(is_virtual_operation(op));
+            if (!is_virtual_operation_needed(op.which())) {
+                return;
+            }
+
             operation_notification note(op);
             notify_pre_apply_operation(note);
             notify_post_apply_operation(note);
         }
 
+        bool database::is_virtual_operation_needed(int64_t tag) const {
+            if (_pre_apply_handlers.has_handlers(tag) || _post_apply_handlers.has_handlers(tag)) {
+                return true;
+            }
+
+            return _virtual_operation_interest->is_needed(tag,
+                    pre_apply_operation.num_slots() + post_apply_operation.num_slots());
+        }
+
         void database::notify_applied_block(const signed_block &block) {
             STEEMIT_TRY_NOTIFY(applied_block, block)
         }
@@ -2969,36 +3067,37 @@ namespace steemit {
         void database::validate_transaction(const signed_transaction &trx) {
             database::with_write_lock([&]() {
                 auto session = start_undo_session(true);
-                _apply_transaction(trx);
+                try {
+                    _apply_transaction(trx);
+                } catch (...) {
+                    discard_changed_objects();
+                    throw;
+                }
                 session.undo();
+                discard_changed_objects();
             });
         }
 
         void database::notify_changed_objects() {
             try {
-                /*vector< graphene::chainbase::generic_id > ids;
-      get_changed_ids( ids );
-      STEEMIT_TRY_NOTIFY( changed_objects, ids )*/
-                /*
-      if( _undo_db.enabled() )
-      {
-         const auto& head_undo = _undo_db.head();
-         vector<object_id_type> changed_ids;  changed_ids.reserve(head_undo.old_values.size());
-         for( const auto& item : head_undo.old_values ) changed_ids.push_back(item.first);
-         for( const auto& item : head_undo.new_ids ) changed_ids.push_back(item);
-         vector<const object*> removed;
-         removed.reserve( head_undo.removed.size() );
-         for( const auto& item : head_undo.removed )
-         {
-            changed_ids.push_back( item.first );
-            removed.emplace_back( item.second.get() );
-         }
-         STEEMIT_TRY_NOTIFY( changed_objects, changed_ids )
-      }
-      */
+                if (_changed_objects.empty()) {
+                    return;
+                }
+
+                std::vector<changed_object> ids;
+                ids.swap(_changed_objects);
+
+                if (changed_objects.empty()) {
+                    _track_changed_objects = false;
+                    return;
+                }
+
+                std::sort(ids.begin(), ids.end());
+                ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+                STEEMIT_TRY_NOTIFY(changed_objects, ids)
             }
             FC_CAPTURE_AND_RETHROW()
-
         }
 
         void database::set_flush_interval(uint32_t flush_blocks) {
@@ -3086,6 +3185,10 @@ namespace steemit {
 
         void database::_apply_block(const signed_block &next_block) {
             try {
+                // Leftovers of failed or undone work must not be notified with this block
+                discard_changed_objects();
+
+                auto apply_start = fc::time_point::now();
                 uint32_t next_block_num = next_block.block_num();
                 //block_id_type next_block_id = next_block.id();
 
@@ -3141,47 +3244,53 @@ namespace steemit {
                     );
                 }
 
-                for (const auto &trx : next_block.transactions) {
-                    /* We do not need to push the undo state for each transaction
-       * because they either all apply and are valid or the
-       * entire block fails to apply.  We only need an "undo" state
-       * for transactions when validating broadcast transactions or
-       * when building a block.
-       */
-                    apply_transaction(trx, skip);
-                    ++_current_trx_in_block;
-                }
+                _profiler.measure(block_stage::transactions, [&]() {
+                    for (const auto &trx : next_block.transactions) {
+                        /* We do not need to push the undo state for each transaction
+                         * because they either all apply and are valid or the
+                         * entire block fails to apply.  We only need an "undo" state
+                         * for transactions when validating broadcast transactions or
+                         * when building a block.
+                         */
+                        apply_transaction(trx, skip);
+                        ++_current_trx_in_block;
+                    }
+                });
 
-                update_global_dynamic_data(next_block);
-                update_signing_witness(signing_witness, next_block);
+                _profiler.measure(block_stage::update_global_dynamic_data, [&]() { update_global_dynamic_data(next_block); });
+                _profiler.measure(block_stage::update_signing_witness, [&]() { update_signing_witness(signing_witness, next_block); });
 
-                update_last_irreversible_block();
+                _profiler.measure(block_stage::update_last_irreversible_block, [&]() { update_last_irreversible_block(); });
 
-                create_block_summary(next_block);
-                clear_expired_transactions();
-                clear_expired_orders();
-                update_witness_schedule();
+                _profiler.measure(block_stage::create_block_summary, [&]() { create_block_summary(next_block); });
+                _profiler.measure(block_stage::clear_expired_transactions, [&]() { clear_expired_transactions(); });
+                _profiler.measure(block_stage::clear_expired_orders, [&]() { clear_expired_orders(); });
+                _profiler.measure(block_stage::update_witness_schedule, [&]() { update_witness_schedule(); });
 
-                update_median_feed();
-                update_virtual_supply();
+                _profiler.measure(block_stage::update_median_feed, [&]() { update_median_feed(); });
+                _profiler.measure(block_stage::update_virtual_supply, [&]() { update_virtual_supply(); });
 
-                clear_null_account_balance();
-                process_funds();
-                process_conversions();
-                process_comment_cashout();
-                process_vesting_withdrawals();
-                process_savings_withdraws();
-                pay_liquidity_reward();
-                update_virtual_supply();
+                _profiler.measure(block_stage::clear_null_account_balance, [&]() { clear_null_account_balance(); });
+                _profiler.measure(block_stage::process_funds, [&]() { process_funds(); });
+                _profiler.measure(block_stage::process_conversions, [&]() { process_conversions(); });
+                _profiler.measure(block_stage::process_comment_cashout, [&]() { process_comment_cashout(); });
+                _profiler.measure(block_stage::process_vesting_withdrawals, [&]() { process_vesting_withdrawals(); });
+                _profiler.measure(block_stage::process_savings_withdraws, [&]() { process_savings_withdraws(); });
+                _profiler.measure(block_stage::pay_liquidity_reward, [&]() { pay_liquidity_reward(); });
+                _profiler.measure(block_stage::update_virtual_supply, [&]() { update_virtual_supply(); });
 
-                account_recovery_processing();
-                expire_escrow_ratification();
-                process_decline_voting_rights();
+                _profiler.measure(block_stage::account_recovery_processing, [&]() { account_recovery_processing(); });
+                _profiler.measure(block_stage::expire_escrow_ratification, [&]() { expire_escrow_ratification(); });
+                _profiler.measure(block_stage::process_decline_voting_rights, [&]() { process_decline_voting_rights(); });
 
-                process_hardforks();
+                _profiler.measure(block_stage::process_hardforks, [&]() { process_hardforks(); });
 
                 // notify observers that the block has been applied
-                notify_applied_block(next_block);
+                _profiler.measure(block_stage::notify_applied_block, [&]() { notify_applied_block(next_block); });
+
+                if (_profiler.enabled()) {
+                    _profiler.record_block(fc::time_point::now() - apply_start);
+                }
 
                 notify_changed_objects();
             } //FC_CAPTURE_AND_RETHROW( (next_block.block_num()) )  }
@@ -3304,7 +3413,7 @@ namespace steemit {
             notify_on_applied_transaction(trx);
         }
 
-        void database::_apply_transaction(const signed_transaction &trx) {
+        void database::_apply_transaction(const signed_transaction &trx, const flat_set<public_key_type> *signature_keys) {
             try {
                 _current_trx_id = trx.id();
                 uint32_t skip = get_node_properties().skip_flags;
@@ -3330,7 +3439,11 @@ namespace steemit {
                     auto get_posting = [&](const string &name) { return authority(get<account_authority_object, by_account>(name).posting); };
 
                     try {
-                        trx.verify_authority(chain_id, get_active, get_owner, get_posting, STEEMIT_MAX_SIG_CHECK_DEPTH);
+                        if (signature_keys) {
+                            protocol::verify_authority(trx.operations, *signature_keys, get_active, get_owner, get_posting, STEEMIT_MAX_SIG_CHECK_DEPTH);
+                        } else {
+                            trx.verify_authority(chain_id, get_active, get_owner, get_posting, STEEMIT_MAX_SIG_CHECK_DEPTH);
+                        }
                     }
                     catch (protocol::tx_missing_active_auth &e) {
                         if (get_shared_db_merkle().find(head_block_num() + 1) ==
@@ -3412,7 +3525,15 @@ namespace steemit {
         void database::apply_operation(const operation &op) {
             operation_notification note(op);
             notify_pre_apply_operation(note);
-            _my->_evaluator_registry.get_evaluator(op).apply(op);
+
+            if (_profiler.enabled()) {
+                auto start = fc::time_point::now();
+                _my->_evaluator_registry.get_evaluator(op).apply(op);
+                _profiler.record_operation(op.which(), fc::time_point::now() - start);
+            } else {
+                _my->_evaluator_registry.get_evaluator(op).apply(op);
+            }
+
             notify_post_apply_operation(note);
         }
 
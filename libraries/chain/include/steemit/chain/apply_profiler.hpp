@@ -0,0 +1,164 @@
+#pragma once
+
+#include <steemit/protocol/operations.hpp>
+
+#include <fc/time.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace steemit {
+    namespace chain {
+
+        /**
+         *  Stages of database::_apply_block measured by @ref apply_profiler
+         */
+        enum class block_stage : uint8_t {
+            transactions = 0,
+            update_global_dynamic_data,
+            update_signing_witness,
+            update_last_irreversible_block,
+            create_block_summary,
+            clear_expired_transactions,
+            clear_expired_orders,
+            update_witness_schedule,
+            update_median_feed,
+            update_virtual_supply,
+            clear_null_account_balance,
+            process_funds,
+            process_conversions,
+            process_comment_cashout,
+            process_vesting_withdrawals,
+            process_savings_withdraws,
+            pay_liquidity_reward,
+            account_recovery_processing,
+            expire_escrow_ratification,
+            process_decline_voting_rights,
+            process_hardforks,
+            notify_applied_block,
+            stage_count
+        };
+
+        struct apply_profile_entry {
+            uint64_t count = 0;
+            int64_t total_us = 0;
+            int64_t max_us = 0;
+
+            void add(const fc::microseconds &time) {
+                auto us = time.count();
+                ++count;
+                total_us += us;
+                if (us > max_us) {
+                    max_us = us;
+                }
+            }
+        };
+
+        /**
+         *  Snapshot of the collected timings, returned by API and logged periodically
+         */
+        struct apply_profile {
+            fc::time_point since;
+            uint32_t blocks = 0;
+            apply_profile_entry block_total;
+            std::map<std::string, apply_profile_entry> operations;  ///< evaluator time by operation name
+            std::map<std::string, apply_profile_entry> subscribers; ///< signal handler time by subscriber name
+            std::map<std::string, apply_profile_entry> block_stages; ///< time of _apply_block stages
+        };
+
+        /**
+         *  @class apply_profiler
+         *  @brief Collects timings of evaluators, signal subscribers and block apply stages
+         *
+         *  Profiling is disabled by default, in that case every measurement
+         *  point costs a single branch. All counters are stored in flat
+         *  vectors indexed by operation tag, subscriber id or stage, so
+         *  enabled profiling does not allocate on the apply path.
+         */
+        class apply_profiler {
+        public:
+            apply_profiler();
+
+            bool enabled() const {
+                return _enabled;
+            }
+
+            void enable(bool value);
+
+            /// Registers a named subscriber and returns its id for @ref record_subscriber
+            uint32_t register_subscriber(const std::string &name);
+
+            void record_operation(int64_t tag, const fc::microseconds &time) {
+                _operations[tag].add(time);
+            }
+
+            void record_subscriber(uint32_t id, const fc::microseconds &time) {
+                _subscribers[id].add(time);
+            }
+
+            void record_stage(block_stage stage, const fc::microseconds &time) {
+                _stages[static_cast<size_t>(stage)].add(time);
+            }
+
+            void record_block(const fc::microseconds &time) {
+                _block_total.add(time);
+                ++_blocks;
+            }
+
+            template<typename Lambda>
+            void measure(block_stage stage, Lambda &&callback) {
+                if (!_enabled) {
+                    callback();
+                    return;
+                }
+
+                auto start = fc::time_point::now();
+                callback();
+                record_stage(stage, fc::time_point::now() - start);
+            }
+
+            apply_profile get_profile() const;
+
+            void reset();
+
+        private:
+            bool _enabled = false;
+            fc::time_point _since;
+            uint32_t _blocks = 0;
+            apply_profile_entry _block_total;
+            std::vector<apply_profile_entry> _operations;
+            std::vector<apply_profile_entry> _subscribers;
+            std::vector<std::string> _subscriber_names;
+            std::vector<apply_profile_entry> _stages;
+        };
+
+        /**
+         *  Wraps signal handler to account time spent in it under the name of subscriber
+         */
+        template<typename Slot>
+        struct profiled_slot {
+            apply_profiler *profiler;
+            uint32_t id;
+            Slot slot;
+
+            template<typename... Args>
+            void operator()(Args &&... args) const {
+                if (!profiler->enabled()) {
+                    slot(std::forward<Args>(args)...);
+                    return;
+                }
+
+                auto start = fc::time_point::now();
+                slot(std::forward<Args>(args)...);
+                profiler->record_subscriber(id, fc::time_point::now() - start);
+            }
+        };
+
+    }
+}
+
+FC_REFLECT(steemit::chain::apply_profile_entry, (count)(total_us)(max_us))
+FC_REFLECT(steemit::chain::apply_profile,
+        (since)(blocks)(block_total)(operations)(subscribers)(block_stages))
@@ -60,6 +60,14 @@ namespace steemit {
              */
             uint64_t get_block_pos(uint32_t block_num) const;
 
+            /**
+             * Return up to count blocks starting with first_block_num exactly as they are stored,
+             * packed signed_blocks without the trailing positions. Blocks are read sequentially
+             * until adding one more would exceed max_bytes, at least one block is returned if
+             * first_block_num is in the log.
+             */
+            std::vector<std::vector<char>> read_packed_blocks(uint32_t first_block_num, uint32_t count, uint64_t max_bytes) const;
+
             signed_block read_head() const;
 
             const optional <signed_block> &head() const;
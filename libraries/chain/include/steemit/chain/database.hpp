@@ -8,6 +8,10 @@
 #include <steemit/chain/node_property_object.hpp>
 #include <steemit/chain/fork_database.hpp>
 #include <steemit/chain/block_log.hpp>
+#include <steemit/chain/apply_profiler.hpp>
+#include <steemit/chain/lock_scheduler.hpp>
+#include <steemit/chain/virtual_operation_interest.hpp>
+#include <steemit/chain/operation_dispatcher.hpp>
 
 #include <steemit/protocol/protocol.hpp>
 
@@ -15,6 +19,7 @@
 
 #include <fc/log/logger.hpp>
 
+#include <atomic>
 #include <map>
 
 namespace steemit {
@@ -33,6 +38,22 @@ namespace steemit {
 
         struct operation_notification;
 
+        /**
+         *  Identifies an object created, modified or removed by a transaction or a block
+         */
+        struct changed_object {
+            uint16_t type = 0;
+            int64_t id = 0;
+
+            bool operator<(const changed_object &o) const {
+                return type < o.type || (type == o.type && id < o.id);
+            }
+
+            bool operator==(const changed_object &o) const {
+                return type == o.type && id == o.id;
+            }
+        };
+
         /**
          *   @class database
          *   @brief tracks the blockchain state in an extensible manner
@@ -133,6 +154,9 @@ namespace steemit {
 
             optional<signed_block> fetch_block_by_number(uint32_t num) const;
 
+            /// Irreversible blocks packed as they are stored in the block log, see block_log::read_packed_blocks
+            std::vector<std::vector<char>> fetch_packed_blocks(uint32_t first_block_num, uint32_t count, uint64_t max_bytes) const;
+
             const signed_transaction get_recent_transaction(const transaction_id_type &trx_id) const;
 
             std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
@@ -217,11 +241,27 @@ namespace steemit {
 
             void push_transaction(const signed_transaction &trx, uint32_t skip = skip_nothing);
 
+            /**
+             *  Pushes transactions under a single write lock. A rejected transaction
+             *  doesn't stop the rest, its exception is returned at the same position,
+             *  accepted transactions have null there.
+             */
+            std::vector<fc::exception_ptr> push_transactions(const std::vector<signed_transaction> &trxs, uint32_t skip = skip_nothing);
+
+            /**
+             *  Same as above for transactions whose signature keys were already recovered,
+             *  @p signature_keys holds the keys of every transaction at the same position.
+             *  The authorities are still checked against the keys, only the recovery,
+             *  the most expensive part of the check, is skipped under the write lock.
+             */
+            std::vector<fc::exception_ptr> push_transactions(const std::vector<signed_transaction> &trxs,
+                    const std::vector<flat_set<public_key_type>> &signature_keys, uint32_t skip = skip_nothing);
+
             void _maybe_warn_multiple_production(uint32_t height) const;
 
             bool _push_block(const signed_block &b);
 
-            void _push_transaction(const signed_transaction &trx);
+            void _push_transaction(const signed_transaction &trx, const flat_set<public_key_type> *signature_keys = nullptr);
 
             signed_block generate_block(
                     const fc::time_point_sec when,
@@ -240,6 +280,11 @@ namespace steemit {
 
             void clear_pending();
 
+            /// Transactions accepted into the pending state, but not included into a block yet
+            const vector<signed_transaction> &pending_transactions() const {
+                return _pending_tx;
+            }
+
             /**
              *  This method is used to track applied operations during the evaluation of a block, these
              *  operations should include any operation actually included in a transaction as well
@@ -250,7 +295,8 @@ namespace steemit {
 
             void notify_post_apply_operation(const operation_notification &note);
 
-            inline const void push_virtual_operation(const operation &op, bool force = false); // vops are not needed for low mem. Force will push them on low mem.
+            /// Notifies subscribers about the virtual operation, skipped if no subscriber needs it. vops are not needed for low mem. Force will push them on low mem.
+            inline const void push_virtual_operation(const operation &op, bool force = false);
             void notify_applied_block(const signed_block &block);
 
             void notify_on_pending_transaction(const signed_transaction &tx);
@@ -263,6 +309,135 @@ namespace steemit {
             fc::signal<void(const operation_notification &)> pre_apply_operation;
             fc::signal<void(const operation_notification &)> post_apply_operation;
 
+            /**
+             *  Connects a handler to one of the database signals under the given name,
+             *  so time spent in it is accounted by @ref profiler when profiling is enabled
+             */
+            template<typename Signature, typename Slot>
+            boost::signals2::connection connect_profiled(
+                    boost::signals2::signal<Signature> &sig,
+                    const std::string &name, Slot slot) {
+                return sig.connect(profiled_slot<Slot>{&_profiler, _profiler.register_subscriber(name), slot});
+            }
+
+            /**
+             *  Connects a handler of pre_apply_operation or post_apply_operation which
+             *  needs only the listed virtual operations (see @ref virtual_operations).
+             *  Virtual operations nobody needs are neither built into a notification
+             *  nor dispatched.
+             */
+            template<typename Slot>
+            boost::signals2::connection connect_profiled(
+                    fc::signal<void(const operation_notification &)> &sig,
+                    const std::string &name, const flat_set<int64_t> &virtual_ops, Slot slot) {
+                auto subscription = std::make_shared<virtual_operation_subscription>(_virtual_operation_interest, virtual_ops);
+                profiled_slot<Slot> profiled{&_profiler, _profiler.register_subscriber(name), slot};
+                return sig.connect(filtered_operation_slot<profiled_slot<Slot>>{subscription, profiled});
+            }
+
+            /**
+             *  Subscribes the handler to notifications of the listed operation types only:
+             *
+             *  db.subscribe_operations<vote_operation, comment_operation>(db.post_apply_handlers(), "tags",
+             *          [&](const operation_notification &note) { ... });
+             *
+             *  Handlers are called after the slots of pre_apply_operation/post_apply_operation
+             *  and are accounted by @ref profiler under the given name.
+             */
+            template<typename... Ops, typename Handler>
+            void subscribe_operations(operation_dispatcher &dispatcher, const std::string &name, Handler handler) {
+                const auto subscriber_id = _profiler.register_subscriber(name);
+                const int64_t tags[] = {operation::tag<Ops>::value..., -1};
+                for (size_t i = 0; i < sizeof...(Ops); ++i) {
+                    dispatcher.subscribe(tags[i], subscriber_id, handler);
+                }
+            }
+
+            operation_dispatcher &pre_apply_handlers() {
+                return _pre_apply_handlers;
+            }
+
+            operation_dispatcher &post_apply_handlers() {
+                return _post_apply_handlers;
+            }
+
+            /// Returns true if any subscriber needs notifications of the virtual operation
+            bool is_virtual_operation_needed(int64_t tag) const;
+
+            apply_profiler &profiler() {
+                return _profiler;
+            }
+
+            const apply_profiler &profiler() const {
+                return _profiler;
+            }
+
+            lock_scheduler &locks() {
+                return _lock_scheduler;
+            }
+
+            const lock_scheduler &locks() const {
+                return _lock_scheduler;
+            }
+
+            /**
+             *  Hides chainbase::database::with_read_lock to let @ref lock_scheduler
+             *  delay new readers while a writer is pending and measure the lock
+             */
+            template<typename Lambda>
+            auto with_read_lock(Lambda &&callback, uint64_t wait_micro = 1000000) -> decltype((*(Lambda *)nullptr)()) {
+                if (lock_scheduler::in_read_lock() || lock_scheduler::in_write_lock()) {
+                    return chainbase::database::with_read_lock([&]() {
+                        lock_scheduler::nested_lock_scope scope(false);
+                        return callback();
+                    }, wait_micro);
+                }
+
+                _lock_scheduler.wait_for_writers();
+
+                auto requested = fc::time_point::now();
+                return chainbase::database::with_read_lock([&]() {
+                    lock_scheduler::lock_scope scope(_lock_scheduler, false, requested);
+                    return callback();
+                }, wait_micro);
+            }
+
+            template<typename Lambda>
+            auto with_write_lock(Lambda &&callback, uint64_t wait_micro = 1000000) -> decltype((*(Lambda *)nullptr)()) {
+                if (lock_scheduler::in_write_lock()) {
+                    return chainbase::database::with_write_lock([&]() {
+                        lock_scheduler::nested_lock_scope scope(true);
+                        return callback();
+                    }, wait_micro);
+                }
+
+                lock_scheduler::write_intent intent(_lock_scheduler);
+
+                auto requested = fc::time_point::now();
+                return chainbase::database::with_write_lock([&]() {
+                    lock_scheduler::lock_scope scope(_lock_scheduler, true, requested);
+                    return callback();
+                }, wait_micro);
+            }
+
+            /**
+             *  Runs a long scan in several read locks. The scan should check
+             *  should_yield_read_lock() between items, remember where it stopped
+             *  and return false, it is called again under a new lock once the
+             *  pending writer has applied its changes. The scan returns true when
+             *  it is finished. Nested in another lock the scan is never preempted.
+             */
+            template<typename Lambda>
+            void with_preemptible_read_lock(Lambda &&scan) {
+                while (!with_read_lock([&]() { return scan(); })) {
+                    _lock_scheduler.record_read_yield();
+                }
+            }
+
+            bool should_yield_read_lock() const {
+                return _lock_scheduler.should_yield_read_lock();
+            }
+
             /**
              *  This signal is emitted after all operations and virtual operation for a
              *  block have been applied but before the get_applied_operations() are cleared.
@@ -289,12 +464,46 @@ namespace steemit {
              *  Emitted After a block has been applied and committed.  The callback
              *  should not yield and should execute quickly.
              */
-            //fc::signal<void(const vector< graphene::db2::generic_id >&)> changed_objects;
+            fc::signal<void(const std::vector<changed_object> &)> changed_objects;
 
-            /** this signal is emitted any time an object is removed and contains a
-             * pointer to the last value of every object that was removed.
+            /**
+             *  Changed objects are collected only after this call, it should be made
+             *  by subscribers of @ref changed_objects. Collecting stops by itself
+             *  once the signal has no subscribers left. Ids recorded by a transaction
+             *  or block which failed or was undone are discarded, not notified.
+             */
+            void track_changed_objects() {
+                _track_changed_objects = true;
+            }
+
+            /**
+             *  create, modify and remove hide the chainbase ones to collect ids
+             *  of changed objects for @ref changed_objects
              */
-            //fc::signal<void(const vector<const object*>&)>  removed_objects;
+            template<typename ObjectType, typename Constructor>
+            const ObjectType &create(Constructor &&con) {
+                const auto &result = chainbase::database::create<ObjectType>(std::forward<Constructor>(con));
+                if (_track_changed_objects) {
+                    record_changed_object(result);
+                }
+                return result;
+            }
+
+            template<typename ObjectType, typename Modifier>
+            void modify(const ObjectType &obj, Modifier &&m) {
+                chainbase::database::modify(obj, std::forward<Modifier>(m));
+                if (_track_changed_objects) {
+                    record_changed_object(obj);
+                }
+            }
+
+            template<typename ObjectType>
+            void remove(const ObjectType &obj) {
+                if (_track_changed_objects) {
+                    record_changed_object(obj);
+                }
+                chainbase::database::remove(obj);
+            }
 
             //////////////////// db_witness_schedule.cpp ////////////////////
 
@@ -520,6 +729,19 @@ namespace steemit {
             //void pop_undo() { object_database::pop_undo(); }
             void notify_changed_objects();
 
+            template<typename ObjectType>
+            void record_changed_object(const ObjectType &obj) {
+                changed_object item;
+                item.type = ObjectType::type_id;
+                item.id = obj.id._id;
+                _changed_objects.push_back(item);
+            }
+
+            /// Drops ids collected by changes which were undone, should be called under the write lock
+            void discard_changed_objects() {
+                _changed_objects.clear();
+            }
+
         private:
             optional<chainbase::database::session> _pending_tx_session;
 
@@ -529,7 +751,8 @@ namespace steemit {
 
             void _apply_block(const signed_block &next_block);
 
-            void _apply_transaction(const signed_transaction &trx);
+            /// @p signature_keys are the recovered keys of the signatures, recovered here if null
+            void _apply_transaction(const signed_transaction &trx, const flat_set<public_key_type> *signature_keys = nullptr);
 
             void apply_operation(const operation &op);
 
@@ -569,6 +792,20 @@ namespace steemit {
 
             ///@}
 
+            /**
+             *  Singleton objects are never removed after genesis and chainbase
+             *  modifies and undoes them in place, so the pointers stay valid
+             *  until the shared memory file is closed.
+             */
+            void cache_singletons();
+
+            void reset_singletons_cache();
+
+            const dynamic_global_property_object *_dgp_cache = nullptr;
+            const feed_history_object *_feed_history_cache = nullptr;
+            const witness_schedule_object *_witness_schedule_cache = nullptr;
+            const hardfork_property_object *_hardfork_property_cache = nullptr;
+
             std::unique_ptr<database_impl> _my;
 
             vector<signed_transaction> _pending_tx;
@@ -602,7 +839,21 @@ namespace steemit {
 
             flat_map<std::string, std::shared_ptr<custom_operation_interpreter>> _custom_operation_interpreters;
             std::string _json_schema;
+
+            apply_profiler _profiler;
+
+            lock_scheduler _lock_scheduler;
+
+            operation_dispatcher _pre_apply_handlers{_profiler};
+            operation_dispatcher _post_apply_handlers{_profiler};
+
+            std::shared_ptr<virtual_operation_interest> _virtual_operation_interest = std::make_shared<virtual_operation_interest>();
+
+            std::atomic<bool> _track_changed_objects{false};
+            std::vector<changed_object> _changed_objects;
         };
 
     }
-}
\ No newline at end of file
+}
+
+FC_REFLECT(steemit::chain::changed_object, (type)(id))
\ No newline at end of file
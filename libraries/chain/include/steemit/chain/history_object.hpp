@@ -75,10 +75,14 @@ namespace steemit {
 
             account_name_type account;
             uint32_t sequence = 0;
+            uint16_t op_type = 0; ///< tag of the operation, so it can be filtered without unpacking
+            time_point_sec timestamp;
             operation_id_type op;
         };
 
         struct by_account;
+        struct by_account_operation;
+        struct by_account_time;
         typedef multi_index_container <
         account_history_object,
         indexed_by<
@@ -91,6 +95,24 @@ namespace steemit {
         member<account_history_object, uint32_t, &account_history_object::sequence>
         >,
         composite_key_compare <std::less<account_name_type>, std::greater<uint32_t>>
+        >,
+        ordered_unique <tag<by_account_operation>,
+        composite_key<account_history_object,
+                member <
+                account_history_object, account_name_type, &account_history_object::account>,
+        member<account_history_object, uint16_t, &account_history_object::op_type>,
+        member<account_history_object, uint32_t, &account_history_object::sequence>
+        >,
+        composite_key_compare <std::less<account_name_type>, std::less<uint16_t>, std::greater<uint32_t>>
+        >,
+        ordered_unique <tag<by_account_time>,
+        composite_key<account_history_object,
+                member <
+                account_history_object, account_name_type, &account_history_object::account>,
+        member<account_history_object, time_point_sec, &account_history_object::timestamp>,
+        member<account_history_object, uint32_t, &account_history_object::sequence>
+        >,
+        composite_key_compare <std::less<account_name_type>, std::greater<time_point_sec>, std::greater<uint32_t>>
         >
         >,
         allocator <account_history_object>
@@ -102,5 +124,5 @@ namespace steemit {
 FC_REFLECT(steemit::chain::operation_object, (id)(trx_id)(block)(trx_in_block)(op_in_trx)(virtual_op)(timestamp)(serialized_op))
 CHAINBASE_SET_INDEX_TYPE(steemit::chain::operation_object, steemit::chain::operation_index)
 
-FC_REFLECT(steemit::chain::account_history_object, (id)(account)(sequence)(op))
+FC_REFLECT(steemit::chain::account_history_object, (id)(account)(sequence)(op_type)(timestamp)(op))
 CHAINBASE_SET_INDEX_TYPE(steemit::chain::account_history_object, steemit::chain::account_history_index)
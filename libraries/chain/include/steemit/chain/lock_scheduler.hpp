@@ -0,0 +1,154 @@
+#pragma once
+
+#include <fc/time.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/thread/future.hpp>
+#include <fc/thread/mutex.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace steemit {
+    namespace chain {
+
+        /**
+         *  Distribution of lock wait or hold times, buckets[i] counts durations
+         *  below 2^i microseconds, the last bucket counts all longer ones
+         */
+        struct lock_histogram {
+            uint64_t count = 0;
+            int64_t total_us = 0;
+            int64_t max_us = 0;
+            std::vector<uint64_t> buckets;
+
+            void add(const fc::microseconds &time);
+        };
+
+        /**
+         *  Snapshot of the lock statistics returned by API
+         */
+        struct lock_statistics {
+            fc::time_point since;
+            bool writer_priority = false;
+            int64_t read_quantum_us = 0;
+            uint64_t delayed_readers = 0; ///< readers waited for pending writers before taking the lock
+            uint64_t read_yields = 0;     ///< long scans released the lock to let writers in
+            lock_histogram read_wait;
+            lock_histogram read_hold;
+            lock_histogram write_wait;
+            lock_histogram write_hold;
+        };
+
+        /**
+         *  @class lock_scheduler
+         *  @brief Orders readers and writers of the database and collects lock timings
+         *
+         *  Every writer announces itself before it starts waiting for the chainbase
+         *  lock. With writer priority enabled new readers do not take the lock while
+         *  a writer is pending, and long scans made with
+         *  database::with_preemptible_read_lock release it once they held it for
+         *  the read quantum, so block application does not wait for API calls.
+         *
+         *  Only the outermost lock of a task is scheduled and measured, nested
+         *  locks are passed to chainbase as is. Lock depth is kept per fc task,
+         *  because fibers of one thread interleave while they hold the lock.
+         */
+        class lock_scheduler {
+        public:
+            lock_scheduler();
+
+            void set_writer_priority(bool value) {
+                _writer_priority = value;
+            }
+
+            bool writer_priority() const {
+                return _writer_priority;
+            }
+
+            void set_read_quantum(const fc::microseconds &value) {
+                _read_quantum_us = value.count();
+            }
+
+            bool has_pending_writers() const {
+                return _writers.load() > 0;
+            }
+
+            /// Returns true if the current task holds the read lock
+            static bool in_read_lock();
+
+            /// Returns true if the current task holds the write lock
+            static bool in_write_lock();
+
+            /// Waits until pending writers got the lock, does nothing without writer priority
+            void wait_for_writers();
+
+            /// Returns true if the outermost read lock of the current task should be released for a pending writer
+            bool should_yield_read_lock() const;
+
+            void record_read_yield();
+
+            lock_statistics get_statistics() const;
+
+            void reset();
+
+            /// Announces a writer for the lifetime of the object
+            class write_intent {
+            public:
+                explicit write_intent(lock_scheduler &scheduler);
+
+                ~write_intent();
+
+            private:
+                lock_scheduler &_scheduler;
+            };
+
+            /**
+             *  Marks the current task as a holder of the lock for the lifetime
+             *  of the object, records wait time on creation and hold time on
+             *  destruction
+             */
+            class lock_scope {
+            public:
+                lock_scope(lock_scheduler &scheduler, bool write, const fc::time_point &requested);
+
+                ~lock_scope();
+
+            private:
+                lock_scheduler &_scheduler;
+                bool _write;
+                fc::time_point _acquired;
+            };
+
+            /// Counts a nested lock of the current task, which is neither scheduled nor measured
+            class nested_lock_scope {
+            public:
+                explicit nested_lock_scope(bool write);
+
+                ~nested_lock_scope();
+
+            private:
+                bool _write;
+            };
+
+        private:
+            void record(lock_histogram &histogram, const fc::microseconds &time);
+
+            std::atomic<uint32_t> _writers;
+            std::atomic<bool> _writer_priority;
+            std::atomic<int64_t> _read_quantum_us;
+
+            /// Set when the last pending writer is gone, readers delayed by wait_for_writers wait on it
+            fc::promise<void>::ptr _writers_done;
+            fc::mutex _writers_mutex;
+
+            mutable fc::mutex _mutex;
+            lock_statistics _statistics;
+        };
+
+    }
+}
+
+FC_REFLECT(steemit::chain::lock_histogram, (count)(total_us)(max_us)(buckets))
+FC_REFLECT(steemit::chain::lock_statistics,
+        (since)(writer_priority)(read_quantum_us)(delayed_readers)(read_yields)
+                (read_wait)(read_hold)(write_wait)(write_hold))
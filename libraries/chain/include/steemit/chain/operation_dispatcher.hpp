@@ -0,0 +1,63 @@
+#pragma once
+
+#include <steemit/chain/apply_profiler.hpp>
+#include <steemit/chain/operation_notification.hpp>
+
+#include <functional>
+#include <vector>
+
+namespace steemit {
+    namespace chain {
+
+        /**
+         *  @class operation_dispatcher
+         *  @brief Calls handlers subscribed to the exact operation type
+         *
+         *  Handlers are kept in a table indexed by operation tag, so an
+         *  operation is passed only to the handlers which declared interest in
+         *  it instead of every subscriber visiting and discarding it.
+         */
+        class operation_dispatcher {
+        public:
+            typedef std::function<void(const operation_notification &)> handler_type;
+
+            explicit operation_dispatcher(apply_profiler &profiler)
+                    : _profiler(profiler), _handlers(operation::count()) {
+            }
+
+            void subscribe(int64_t tag, uint32_t subscriber_id, handler_type handler) {
+                _handlers[tag].push_back(entry{subscriber_id, std::move(handler)});
+            }
+
+            bool has_handlers(int64_t tag) const {
+                return !_handlers[tag].empty();
+            }
+
+            void operator()(const operation_notification &note) const {
+                const auto &handlers = _handlers[note.op.which()];
+                if (!_profiler.enabled()) {
+                    for (const auto &item : handlers) {
+                        item.handler(note);
+                    }
+                    return;
+                }
+
+                for (const auto &item : handlers) {
+                    auto start = fc::time_point::now();
+                    item.handler(note);
+                    _profiler.record_subscriber(item.subscriber_id, fc::time_point::now() - start);
+                }
+            }
+
+        private:
+            struct entry {
+                uint32_t subscriber_id;
+                handler_type handler;
+            };
+
+            apply_profiler &_profiler;
+            std::vector<std::vector<entry>> _handlers;
+        };
+
+    }
+}
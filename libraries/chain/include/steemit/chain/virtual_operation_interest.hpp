@@ -0,0 +1,107 @@
+#pragma once
+
+#include <steemit/protocol/operations.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace steemit {
+    namespace chain {
+
+        using protocol::operation;
+
+        /**
+         *  @class virtual_operation_interest
+         *  @brief Tracks which virtual operations are needed by subscribers of
+         *  database::pre_apply_operation and database::post_apply_operation
+         *
+         *  Subscribers connected with a list of needed virtual operations are
+         *  counted per operation tag. Subscribers connected without a list are
+         *  assumed to need every virtual operation, they are detected by
+         *  comparing the amount of connected slots with the amount of
+         *  filtered ones.
+         */
+        class virtual_operation_interest {
+        public:
+            virtual_operation_interest()
+                    : _subscribers(operation::count()) {
+            }
+
+            void add(const flat_set<int64_t> &tags) {
+                ++_filtered_slots;
+                for (auto tag : tags) {
+                    ++_subscribers[tag];
+                }
+            }
+
+            void remove(const flat_set<int64_t> &tags) {
+                --_filtered_slots;
+                for (auto tag : tags) {
+                    --_subscribers[tag];
+                }
+            }
+
+            /**
+             *  @param tag of the virtual operation
+             *  @param slots total amount of slots connected to the operation signals
+             */
+            bool is_needed(int64_t tag, size_t slots) const {
+                if (slots == 0) {
+                    return false;
+                }
+
+                if (slots > _filtered_slots) {
+                    return true;
+                }
+
+                return _subscribers[tag] != 0;
+            }
+
+        private:
+            std::vector<uint32_t> _subscribers;
+            size_t _filtered_slots = 0;
+        };
+
+        /**
+         *  Registers interest of one slot, the interest is released when the
+         *  slot is disconnected and destroyed by the signal
+         */
+        class virtual_operation_subscription {
+        public:
+            virtual_operation_subscription(std::shared_ptr<virtual_operation_interest> interest, const flat_set<int64_t> &tags)
+                    : _interest(std::move(interest)), _tags(tags) {
+                _interest->add(_tags);
+            }
+
+            ~virtual_operation_subscription() {
+                _interest->remove(_tags);
+            }
+
+        private:
+            std::shared_ptr<virtual_operation_interest> _interest;
+            flat_set<int64_t> _tags;
+        };
+
+        template<typename Slot>
+        struct filtered_operation_slot {
+            std::shared_ptr<virtual_operation_subscription> subscription;
+            Slot slot;
+
+            template<typename... Args>
+            void operator()(Args &&... args) const {
+                slot(std::forward<Args>(args)...);
+            }
+        };
+
+        /**
+         *  Builds a list of virtual operation tags for database::connect_profiled,
+         *  an empty list means the subscriber does not need virtual operations at all
+         */
+        template<typename... Ops>
+        flat_set<int64_t> virtual_operations() {
+            const int64_t tags[] = {operation::tag<Ops>::value..., 0};
+            return flat_set<int64_t>(tags, tags + sizeof...(Ops));
+        }
+
+    }
+}
@@ -0,0 +1,187 @@
+#include <steemit/chain/lock_scheduler.hpp>
+
+#include <fc/thread/thread.hpp>
+#include <fc/thread/thread_specific.hpp>
+
+namespace steemit {
+    namespace chain {
+
+        namespace {
+
+            const size_t histogram_buckets = 24;
+
+            /// Readers never wait for writers longer than this, so a stuck writer can not block API forever
+            const fc::microseconds max_writer_wait = fc::seconds(1);
+
+            /// Locks held by a task, fibers sharing a thread have their own depth
+            struct lock_depth {
+                uint32_t read = 0;
+                uint32_t write = 0;
+                fc::time_point read_acquired;
+            };
+
+            fc::task_specific_ptr<lock_depth> current_lock_depth;
+
+            lock_depth &current_depth() {
+                auto *result = current_lock_depth.get();
+                if (result == nullptr) {
+                    result = new lock_depth();
+                    current_lock_depth.reset(result);
+                }
+                return *result;
+            }
+
+        }
+
+        void lock_histogram::add(const fc::microseconds &time) {
+            auto us = std::max<int64_t>(time.count(), 0);
+            ++count;
+            total_us += us;
+            if (us > max_us) {
+                max_us = us;
+            }
+
+            if (buckets.size() != histogram_buckets) {
+                buckets.resize(histogram_buckets);
+            }
+
+            size_t bucket = 0;
+            while (bucket + 1 < histogram_buckets && (int64_t(1) << bucket) <= us) {
+                ++bucket;
+            }
+            ++buckets[bucket];
+        }
+
+        lock_scheduler::lock_scheduler()
+                : _writers(0), _writer_priority(false),
+                  _read_quantum_us(fc::milliseconds(20).count()) {
+            reset();
+        }
+
+        bool lock_scheduler::in_read_lock() {
+            return current_depth().read > 0;
+        }
+
+        bool lock_scheduler::in_write_lock() {
+            return current_depth().write > 0;
+        }
+
+        void lock_scheduler::wait_for_writers() {
+            if (!_writer_priority || !has_pending_writers()) {
+                return;
+            }
+
+            fc::promise<void>::ptr writers_done;
+            {
+                fc::scoped_lock<fc::mutex> lock(_writers_mutex);
+                writers_done = _writers_done;
+            }
+            if (!writers_done) {
+                return;
+            }
+
+            {
+                fc::scoped_lock<fc::mutex> lock(_mutex);
+                ++_statistics.delayed_readers;
+            }
+
+            try {
+                writers_done->wait(max_writer_wait);
+            } catch (const fc::timeout_exception &) {
+            }
+        }
+
+        bool lock_scheduler::should_yield_read_lock() const {
+            // Nested locks can not be released, the outer scope still holds the lock
+            const auto &depth = current_depth();
+            if (depth.read != 1 || depth.write != 0 || !has_pending_writers()) {
+                return false;
+            }
+            return fc::time_point::now() - depth.read_acquired >= fc::microseconds(_read_quantum_us.load());
+        }
+
+        void lock_scheduler::record_read_yield() {
+            fc::scoped_lock<fc::mutex> lock(_mutex);
+            ++_statistics.read_yields;
+        }
+
+        lock_statistics lock_scheduler::get_statistics() const {
+            fc::scoped_lock<fc::mutex> lock(_mutex);
+            lock_statistics result = _statistics;
+            result.writer_priority = _writer_priority;
+            result.read_quantum_us = _read_quantum_us;
+            return result;
+        }
+
+        void lock_scheduler::reset() {
+            fc::scoped_lock<fc::mutex> lock(_mutex);
+            _statistics = lock_statistics();
+            _statistics.since = fc::time_point::now();
+        }
+
+        void lock_scheduler::record(lock_histogram &histogram, const fc::microseconds &time) {
+            fc::scoped_lock<fc::mutex> lock(_mutex);
+            histogram.add(time);
+        }
+
+        lock_scheduler::write_intent::write_intent(lock_scheduler &scheduler)
+                : _scheduler(scheduler) {
+            fc::scoped_lock<fc::mutex> lock(_scheduler._writers_mutex);
+            if (_scheduler._writers++ == 0) {
+                _scheduler._writers_done = fc::promise<void>::ptr(new fc::promise<void>("steemit::chain::lock_scheduler::writers_done"));
+            }
+        }
+
+        lock_scheduler::write_intent::~write_intent() {
+            fc::promise<void>::ptr writers_done;
+            {
+                fc::scoped_lock<fc::mutex> lock(_scheduler._writers_mutex);
+                if (--_scheduler._writers == 0) {
+                    writers_done = _scheduler._writers_done;
+                    _scheduler._writers_done.reset();
+                }
+            }
+            if (writers_done) {
+                writers_done->set_value();
+            }
+        }
+
+        lock_scheduler::lock_scope::lock_scope(lock_scheduler &scheduler, bool write, const fc::time_point &requested)
+                : _scheduler(scheduler), _write(write),
+                  _acquired(fc::time_point::now()) {
+            auto &depth = current_depth();
+            if (_write) {
+                ++depth.write;
+                _scheduler.record(_scheduler._statistics.write_wait, _acquired - requested);
+            } else {
+                ++depth.read;
+                depth.read_acquired = _acquired;
+                _scheduler.record(_scheduler._statistics.read_wait, _acquired - requested);
+            }
+        }
+
+        lock_scheduler::nested_lock_scope::nested_lock_scope(bool write)
+                : _write(write) {
+            auto &depth = current_depth();
+            ++(_write ? depth.write : depth.read);
+        }
+
+        lock_scheduler::nested_lock_scope::~nested_lock_scope() {
+            auto &depth = current_depth();
+            --(_write ? depth.write : depth.read);
+        }
+
+        lock_scheduler::lock_scope::~lock_scope() {
+            auto held = fc::time_point::now() - _acquired;
+            auto &depth = current_depth();
+            if (_write) {
+                --depth.write;
+                _scheduler.record(_scheduler._statistics.write_hold, held);
+            } else {
+                --depth.read;
+                _scheduler.record(_scheduler._statistics.read_hold, held);
+            }
+        }
+
+    }
+}
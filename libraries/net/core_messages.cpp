@@ -46,6 +46,63 @@ namespace graphene {
         const core_message_type_enum check_firewall_reply_message::type = core_message_type_enum::check_firewall_reply_message_type;
         const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
         const core_message_type_enum get_current_connections_reply_message::type = core_message_type_enum::get_current_connections_reply_message_type;
+        const core_message_type_enum compact_block_message::type = core_message_type_enum::compact_block_message_type;
+        const core_message_type_enum get_block_transactions_message::type = core_message_type_enum::get_block_transactions_message_type;
+        const core_message_type_enum block_transactions_message::type = core_message_type_enum::block_transactions_message_type;
+        const core_message_type_enum get_block_range_message::type = core_message_type_enum::get_block_range_message_type;
+        const core_message_type_enum block_range_message::type = core_message_type_enum::block_range_message_type;
+
+        compact_block_message::compact_block_message(const block_message &full_block, const item_hash_t &block_message_hash)
+                :
+                block_message_hash(block_message_hash),
+                block_id(full_block.block_id),
+                header(full_block.block) {
+            short_transaction_ids.reserve(full_block.block.transactions.size());
+            for (const signed_transaction &trx : full_block.block.transactions) {
+                short_transaction_ids.push_back(short_transaction_id(trx.id()));
+            }
+        }
+
+        uint64_t compact_block_message::short_transaction_id(const transaction_id_type &id) {
+            return (uint64_t(id._hash[0]) << 32) | id._hash[1];
+        }
+
+        block_message compact_block_message::to_block_message(std::vector<signed_transaction> transactions) const {
+            FC_ASSERT(transactions.size() == short_transaction_ids.size(),
+                    "Expected ${n} transactions, got ${count}",
+                    ("n", short_transaction_ids.size())("count", transactions.size()));
+
+            signed_block block;
+            static_cast<steemit::protocol::signed_block_header &>(block) = header;
+            block.transactions = std::move(transactions);
+
+            block_message result;
+            result.block = std::move(block);
+            result.block_id = block_id;
+            return result;
+        }
+
+        void unpack_core_message(message &received_message) {
+            switch (received_message.msg_type) {
+                case core_message_type_enum::trx_message_type:
+                    received_message.unpack<trx_message>();
+                    break;
+                case core_message_type_enum::block_message_type:
+                    received_message.unpack<block_message>();
+                    break;
+                case core_message_type_enum::compact_block_message_type:
+                    received_message.unpack<compact_block_message>();
+                    break;
+                case core_message_type_enum::block_transactions_message_type:
+                    received_message.unpack<block_transactions_message>();
+                    break;
+                case core_message_type_enum::block_range_message_type:
+                    received_message.unpack<block_range_message>();
+                    break;
+                default:
+                    break;
+            }
+        }
 
     }
 } // graphene::net
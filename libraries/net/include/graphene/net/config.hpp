@@ -57,6 +57,32 @@
 
 #define GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES        (1024 * 1024)
 
+/**
+ * Byte budgets of the classes of a peer's send queue.  A peer which lets
+ * blocks, block fetches or replies to its requests exceed their budget
+ * doesn't keep up with the chain or floods us with requests and is
+ * disconnected.  In the inventory and transaction classes the oldest
+ * messages are dropped instead, requested transactions are answered with
+ * item_not_available so the peer fetches them elsewhere.
+ */
+#define GRAPHENE_NET_MAXIMUM_QUEUED_BLOCK_BYTES              GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES
+#define GRAPHENE_NET_MAXIMUM_QUEUED_BLOCK_FETCH_BYTES        GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES
+#define GRAPHENE_NET_MAXIMUM_QUEUED_REQUEST_REPLY_BYTES      (256 * 1024)
+#define GRAPHENE_NET_MAXIMUM_QUEUED_INVENTORY_BYTES          (256 * 1024)
+#define GRAPHENE_NET_MAXIMUM_QUEUED_TRANSACTION_BYTES        (512 * 1024)
+
+/**
+ * A transaction waiting in the send queue longer than this is dropped, the
+ * peer has already given up on the request (see active_ignored_request_timeout)
+ */
+#define GRAPHENE_NET_MAXIMUM_QUEUED_TRANSACTION_AGE_MS       1000
+
+/**
+ * Messages decoded by a connection's I/O thread and not yet handled by the
+ * node thread.  When the queue is full the I/O thread stops reading the socket.
+ */
+#define GRAPHENE_NET_IO_RECEIVED_MESSAGE_QUEUE_SIZE          32
+
 /**
  * When we receive a message from the network, we advertise it to
  * our peers and save a copy in a cache were we will find it if
@@ -79,8 +105,63 @@
 
 #define GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES           2
 
+/**
+ * Inventory known to a peer is remembered in a rolling Bloom filter of two
+ * generations, each meant to cover half of GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES.
+ * Generations start at the minimal size and grow with the real inventory
+ * rate up to the size needed at the maximal transaction rate.  A false
+ * positive only means the peer isn't told about an item by us and will learn
+ * about it from its other peers.
+ */
+#define GRAPHENE_NET_KNOWN_INVENTORY_MIN_GENERATION_SIZE     1000
+#define GRAPHENE_NET_KNOWN_INVENTORY_GENERATION_SIZE         (GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES * GRAPHENE_NET_MAX_TRX_PER_SECOND * 60 / 2)
+#define GRAPHENE_NET_KNOWN_INVENTORY_GENERATION_TIME         fc::seconds(GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES * 60 / 2)
+#define GRAPHENE_NET_KNOWN_INVENTORY_FALSE_POSITIVE_RATE     0.0001
+
+/**
+ * New inventory is advertised once no more of it arrived for the quiet
+ * period, and at the latest after the flush interval, so peers get a few
+ * large inventory messages instead of one per item under load.  Blocks are
+ * advertised without waiting, as is inventory reaching
+ * GRAPHENE_NET_MAX_INVENTORY_ITEMS_PER_MESSAGE, the size of one message.
+ */
+#define GRAPHENE_NET_INVENTORY_QUIET_PERIOD_MS               10
+#define GRAPHENE_NET_INVENTORY_FLUSH_INTERVAL_MS             100
+#define GRAPHENE_NET_MAX_INVENTORY_ITEMS_PER_MESSAGE         1000
+
 #define GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING      200
 
+/**
+ * During sync every peer is asked for a range of blocks it is expected to
+ * deliver in this many seconds at its measured speed, but not less than
+ * GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING (the size used for peers
+ * not measured yet) and not more than the maximum above.  A peer is given
+ * its next range when half of the previous one has arrived.
+ */
+#define GRAPHENE_NET_SYNC_RANGE_DURATION_SEC                 5
+#define GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING      20
+
+/**
+ * If the block the chain needs next was requested this many seconds ago
+ * and still hasn't arrived, it is requested from another peer having it.
+ */
+#define GRAPHENE_NET_SYNC_STALLED_REQUEST_TIMEOUT_SEC        10
+
+/**
+ * Peers announcing "block_ranges" in the hello are asked for runs of
+ * consecutive sync blocks with a single get_block_range_message, ranges are
+ * sized as above but up to GRAPHENE_NET_MAX_BLOCKS_PER_BLOCK_RANGE.  The
+ * peer streams them from its block log in frames of about
+ * GRAPHENE_NET_BLOCK_RANGE_FRAME_BYTES and queues the next frame only while
+ * its fetch queue to us holds less than GRAPHENE_NET_BLOCK_RANGE_MAX_QUEUED_BYTES,
+ * so the stream runs at the speed the connection drains.  At most
+ * GRAPHENE_NET_MAX_BLOCK_RANGE_REQUESTS ranges are outstanding per peer.
+ */
+#define GRAPHENE_NET_MAX_BLOCKS_PER_BLOCK_RANGE              2000
+#define GRAPHENE_NET_BLOCK_RANGE_FRAME_BYTES                 (256 * 1024)
+#define GRAPHENE_NET_BLOCK_RANGE_MAX_QUEUED_BYTES            (GRAPHENE_NET_MAXIMUM_QUEUED_BLOCK_FETCH_BYTES / 2)
+#define GRAPHENE_NET_MAX_BLOCK_RANGE_REQUESTS                2
+
 /**
  * During normal operation, how many items will be fetched from each
  * peer at a time.  This will only come into play when the network
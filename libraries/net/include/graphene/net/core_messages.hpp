@@ -88,6 +88,11 @@ namespace graphene {
             check_firewall_reply_message_type = 5015,
             get_current_connections_request_message_type = 5016,
             get_current_connections_reply_message_type = 5017,
+            compact_block_message_type = 5018,
+            get_block_transactions_message_type = 5019,
+            block_transactions_message_type = 5020,
+            get_block_range_message_type = 5021,
+            block_range_message_type = 5022,
             core_message_type_last = 5099
         };
 
@@ -418,6 +423,117 @@ namespace graphene {
             std::vector<current_connection_data> current_connections;
         };
 
+        /**
+         * Block sent in place of a block_message to peers supporting compact blocks.
+         * It carries only the header and the short ids of the transactions, the
+         * receiver takes the transactions from its message cache or pending
+         * state and asks for the missing ones with get_block_transactions_message.
+         */
+        struct compact_block_message {
+            static const core_message_type_enum type;
+
+            compact_block_message() {
+            }
+
+            compact_block_message(const block_message &full_block, const item_hash_t &block_message_hash);
+
+            item_hash_t block_message_hash; ///< id of the full block_message, the item the peer has requested
+            block_id_type block_id;
+            steemit::protocol::signed_block_header header;
+            std::vector<uint64_t> short_transaction_ids;
+
+            /// First 64 bits of the transaction id
+            static uint64_t short_transaction_id(const transaction_id_type &id);
+
+            /// Builds the full block from the transactions ordered the same way as short_transaction_ids
+            block_message to_block_message(std::vector<signed_transaction> transactions) const;
+        };
+
+        struct get_block_transactions_message {
+            static const core_message_type_enum type;
+
+            item_hash_t block_message_hash;
+            std::vector<uint32_t> transaction_indexes; ///< strictly increasing positions in compact_block_message::short_transaction_ids
+
+            get_block_transactions_message() {
+            }
+
+            get_block_transactions_message(const item_hash_t &block_message_hash,
+                    const std::vector<uint32_t> &transaction_indexes)
+                    :
+                    block_message_hash(block_message_hash),
+                    transaction_indexes(transaction_indexes) {
+            }
+        };
+
+        /// Reply to get_block_transactions_message, empty if the block is not available anymore
+        struct block_transactions_message {
+            static const core_message_type_enum type;
+
+            item_hash_t block_message_hash;
+            std::vector<signed_transaction> transactions;
+
+            block_transactions_message() {
+            }
+
+            block_transactions_message(const item_hash_t &block_message_hash)
+                    :
+                    block_message_hash(block_message_hash) {
+            }
+        };
+
+        /**
+         * Asks a peer supporting block ranges for block_count consecutive blocks
+         * starting with first_block_id, answered by block_range_message frames.
+         */
+        struct get_block_range_message {
+            static const core_message_type_enum type;
+
+            block_id_type first_block_id;
+            uint32_t block_count;
+
+            get_block_range_message()
+                    : block_count(0) {
+            }
+
+            get_block_range_message(const block_id_type &first_block_id, uint32_t block_count)
+                    :
+                    first_block_id(first_block_id),
+                    block_count(block_count) {
+            }
+        };
+
+        /**
+         * One frame of the reply to get_block_range_message.  Blocks follow one
+         * another in the chain and are packed as in the block log of the sender.
+         * The last frame of a range may hold fewer blocks than were requested,
+         * the sender's block log has only irreversible blocks.
+         */
+        struct block_range_message {
+            static const core_message_type_enum type;
+
+            block_id_type first_block_id; ///< of the range this frame belongs to
+            std::vector<std::vector<char>> packed_blocks;
+            bool last_frame;
+
+            block_range_message()
+                    : last_frame(false) {
+            }
+
+            block_range_message(const block_id_type &first_block_id, bool last_frame = false)
+                    :
+                    first_block_id(first_block_id),
+                    last_frame(last_frame) {
+            }
+        };
+
+        /**
+         * Unpacks the contents of core messages that carry blocks or transactions
+         * into message::unpacked, so the connection I/O thread does it instead of
+         * the node thread.  Other messages are left as they are.
+         */
+        void unpack_core_message(message &received_message);
+
 
     }
 } // graphene::net
@@ -443,6 +559,11 @@ FC_REFLECT_ENUM(graphene::net::core_message_type_enum,
                 (check_firewall_reply_message_type)
                 (get_current_connections_request_message_type)
                 (get_current_connections_reply_message_type)
+                (compact_block_message_type)
+                (get_block_transactions_message_type)
+                (block_transactions_message_type)
+                (get_block_range_message_type)
+                (block_range_message_type)
                 (core_message_type_last))
 
 FC_REFLECT(graphene::net::trx_message, (trx))
@@ -526,6 +647,19 @@ FC_REFLECT(graphene::net::get_current_connections_reply_message, (upload_rate_on
         (upload_rate_one_hour)
         (download_rate_one_hour)
         (current_connections))
+FC_REFLECT(graphene::net::compact_block_message, (block_message_hash)
+        (block_id)
+        (header)
+        (short_transaction_ids))
+FC_REFLECT(graphene::net::get_block_transactions_message, (block_message_hash)
+        (transaction_indexes))
+FC_REFLECT(graphene::net::block_transactions_message, (block_message_hash)
+        (transactions))
+FC_REFLECT(graphene::net::get_block_range_message, (first_block_id)
+        (block_count))
+FC_REFLECT(graphene::net::block_range_message, (first_block_id)
+        (packed_blocks)
+        (last_frame))
 
 #include <unordered_map>
 #include <fc/crypto/city.hpp>
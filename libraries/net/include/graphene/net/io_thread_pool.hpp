@@ -0,0 +1,42 @@
+#pragma once
+
+#include <fc/thread/thread.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace graphene {
+    namespace net {
+
+        /**
+         *  @class io_thread_pool
+         *  @brief Threads doing socket I/O of the peer connections
+         *
+         *  Every connection is bound to one thread of the pool when it is
+         *  created, the thread reads the stream, decrypts and frames messages
+         *  and encrypts outgoing ones. Protocol logic stays on the node thread.
+         *  An empty pool keeps all I/O on the node thread.
+         */
+        class io_thread_pool {
+        public:
+            io_thread_pool();
+
+            ~io_thread_pool();
+
+            /// Starts threads up to @ref count, running threads are never stopped while connections use them
+            void set_thread_count(uint32_t count);
+
+            uint32_t size() const {
+                return static_cast<uint32_t>(_threads.size());
+            }
+
+            /// Returns threads in turn, nullptr for an empty pool
+            fc::thread *next_thread();
+
+        private:
+            std::vector<std::shared_ptr<fc::thread>> _threads;
+            uint32_t _next_thread;
+        };
+
+    }
+} // graphene::net
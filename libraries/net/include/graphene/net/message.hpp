@@ -28,8 +28,11 @@
 #include <fc/network/ip.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/crypto/ripemd160.hpp>
+#include <fc/optional.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <memory>
+
 namespace graphene {
     namespace net {
 
@@ -53,17 +56,28 @@ namespace graphene {
         struct message : public message_header {
             std::vector<char> data;
 
+            /// hash of data calculated by the connection I/O thread for received messages, not sent over the wire
+            fc::optional<message_hash_type> precomputed_id;
+
+            /// contents unpacked by the connection I/O thread for received messages, see as_shared()
+            std::shared_ptr<const void> unpacked;
+
             message() {
             }
 
             message(message &&m)
-                    : message_header(m), data(std::move(m.data)) {
+                    : message_header(m), data(std::move(m.data)), precomputed_id(std::move(m.precomputed_id)),
+                      unpacked(std::move(m.unpacked)) {
             }
 
             message(const message &m)
-                    : message_header(m), data(m.data) {
+                    : message_header(m), data(m.data), precomputed_id(m.precomputed_id), unpacked(m.unpacked) {
             }
 
+            message &operator=(const message &m) = default;
+
+            message &operator=(message &&m) = default;
+
             /**
              *  Assumes that T::type specifies the message type
              */
@@ -75,6 +89,9 @@ namespace graphene {
             }
 
             fc::uint160_t id() const {
+                if (precomputed_id) {
+                    return *precomputed_id;
+                }
                 return fc::ripemd160::hash(data.data(), (uint32_t)data.size());
             }
 
@@ -103,6 +120,21 @@ namespace graphene {
                                 ("msg_type", msg_type)
                 );
             }
+
+            /// Unpacks data as T once, as_shared<T>() returns it afterwards without unpacking again
+            template<typename T>
+            void unpack() {
+                unpacked = std::make_shared<const T>(as<T>());
+            }
+
+            /// Returns the contents unpacked by unpack() or unpacks them now
+            template<typename T>
+            std::shared_ptr<const T> as_shared() const {
+                if (unpacked && msg_type == T::type) {
+                    return std::static_pointer_cast<const T>(unpacked);
+                }
+                return std::make_shared<const T>(as<T>());
+            }
         };
 
 
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
 #include <graphene/net/message.hpp>
 
 namespace graphene {
@@ -41,10 +42,16 @@ namespace graphene {
             virtual void on_connection_closed(message_oriented_connection *originating_connection) = 0;
         };
 
-        /** uses a secure socket to create a connection that reads and writes a stream of `fc::net::message` objects */
+        /**
+         * uses a secure socket to create a connection that reads and writes a stream of `fc::net::message` objects
+         *
+         * If io_thread is given, reading, writing and encryption are done on it and received messages
+         * are passed to the delegate on the thread which has created the connection.
+         */
         class message_oriented_connection {
         public:
-            message_oriented_connection(message_oriented_connection_delegate *delegate = nullptr);
+            message_oriented_connection(message_oriented_connection_delegate *delegate = nullptr,
+                    fc::thread *io_thread = nullptr);
 
             ~message_oriented_connection();
 
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <fc/variant.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace graphene {
+    namespace net {
+
+        enum metric_type {
+            counter_metric,
+            gauge_metric,
+            histogram_metric
+        };
+
+        /// name and value pairs distinguishing series of one metric, e.g. {{"type", "block_message_type"}}
+        typedef std::vector<std::pair<std::string, std::string>> metric_labels;
+
+        /**
+         *  @class metrics_registry
+         *  @brief Counters, gauges and histograms describing the p2p node
+         *
+         *  Every metric has to be described before it's updated.  The registry is
+         *  exported in the Prometheus text format for scraping by monitoring and as
+         *  a variant for the API.  It isn't thread safe, the node updates and reads
+         *  it on the p2p thread only.
+         */
+        class metrics_registry {
+        public:
+            /// @param buckets upper bounds of histogram buckets, ascending
+            void describe(const std::string &name, metric_type type, const std::string &help,
+                    const std::vector<double> &buckets = std::vector<double>());
+
+            void increment(const std::string &name, const metric_labels &labels = metric_labels(), double value = 1);
+
+            void set(const std::string &name, const metric_labels &labels, double value);
+
+            void set(const std::string &name, double value) {
+                set(name, metric_labels(), value);
+            }
+
+            void observe(const std::string &name, const metric_labels &labels, double value);
+
+            /// Removes all series of a metric, used for gauges of peers which come and go
+            void clear(const std::string &name);
+
+            std::string to_text() const;
+
+            fc::variant to_variant() const;
+
+        private:
+            struct histogram_series {
+                std::vector<uint64_t> bucket_counts; /// not cumulative, the last one is +Inf
+                double sum = 0;
+                uint64_t count = 0;
+            };
+
+            struct metric_family {
+                metric_type type;
+                std::string help;
+                std::vector<double> buckets;
+                std::map<metric_labels, double> values;
+                std::map<metric_labels, histogram_series> histograms;
+            };
+
+            metric_family &get_family(const std::string &name, metric_type type);
+
+            std::map<std::string, metric_family> _families;
+        };
+
+    }
+} // end namespace graphene::net
+
+FC_REFLECT_ENUM(graphene::net::metric_type, (counter_metric)(gauge_metric)(histogram_metric))
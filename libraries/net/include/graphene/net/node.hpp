@@ -113,6 +113,20 @@ namespace graphene {
              */
             virtual message get_item(const item_id &id) = 0;
 
+            /**
+             *  Returns transactions waiting in the pending state, used to rebuild
+             *  compact blocks when a transaction has already left the message cache.
+             */
+            virtual std::vector<signed_transaction> get_pending_transactions() = 0;
+
+            /**
+             *  Returns irreversible blocks starting with first_block_num packed as they
+             *  are stored in the block log, streamed to peers catching up with
+             *  block_range_message. Returns at most limit blocks and stops before
+             *  exceeding max_bytes, but returns at least one block if it has it.
+             */
+            virtual std::vector<std::vector<char>> get_packed_blocks(uint32_t first_block_num, uint32_t limit, uint32_t max_bytes) = 0;
+
             /**
              * Returns a synopsis of the blockchain used for syncing.
              * This consists of a list of selected item hashes from our current preferred
@@ -293,6 +307,12 @@ namespace graphene {
 
             fc::variant_object network_get_usage_stats() const;
 
+            /// Message rates, peer latencies, queue depths, sync backlog and blockchain call durations
+            fc::variant get_metrics() const;
+
+            /// @ref get_metrics in the Prometheus text exposition format
+            std::string get_metrics_text() const;
+
             std::vector<potential_peer_record> get_potential_peers() const;
 
             void disable_peer_advertising();
@@ -26,6 +26,7 @@
 #include <graphene/net/node.hpp>
 #include <graphene/net/peer_database.hpp>
 #include <graphene/net/message_oriented_connection.hpp>
+#include <graphene/net/rolling_bloom_filter.hpp>
 #include <graphene/net/stcp_socket.hpp>
 #include <graphene/net/config.hpp>
 
@@ -40,6 +41,9 @@
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 
+#include <array>
+#include <deque>
+#include <map>
 #include <queue>
 #include <boost/container/deque.hpp>
 #include <fc/thread/future.hpp>
@@ -69,7 +73,15 @@ namespace graphene {
 
             virtual void on_connection_closed(peer_connection *originating_peer) = 0;
 
+            virtual void on_message_sent(peer_connection *destination_peer, const message &sent_message) = 0;
+
+            /// Called for every message dropped from the send queue of @p destination_peer without being sent
+            virtual void on_message_dropped(peer_connection *destination_peer, const item_id &dropped_item) = 0;
+
             virtual message get_message_for_item(const item_id &item) = 0;
+
+            /// Thread for the socket I/O of a new connection, nullptr to do it on the node thread
+            virtual fc::thread *get_io_thread() = 0;
         };
 
         class peer_connection;
@@ -91,6 +103,19 @@ namespace graphene {
                 connection_accepted, // we have sent them a connection_accepted
                 connection_rejected // we have sent them a connection_rejected
             };
+            /**
+             * Classes of the send queue, a message is sent only when the queues of
+             * all classes before its own are empty, so relayed transactions can't
+             * delay a block
+             */
+            enum class message_priority {
+                block, // blocks, compact block relay and connection control messages
+                block_fetch, // sync and fetch requests and replies
+                request_reply, // addresses, time and firewall checks, connection lists, the other side waits for them
+                inventory,
+                transaction,
+                count
+            };
             enum class connection_negotiation_status {
                 disconnected,
                 connecting,
@@ -129,6 +154,11 @@ namespace graphene {
                  */
                 virtual size_t get_size_in_queue() = 0;
 
+                virtual message_priority get_priority() = 0;
+
+                /// the item requested by the peer, used to tell it a dropped item isn't available
+                virtual item_id get_item_id() = 0;
+
                 virtual ~queued_message() {
                 }
             };
@@ -149,6 +179,10 @@ namespace graphene {
                 message get_message(peer_connection_delegate *node) override;
 
                 size_t get_size_in_queue() override;
+
+                message_priority get_priority() override;
+
+                item_id get_item_id() override;
             };
 
             /* when you queue up a 'virtual_queued_message', we just queue up the hash of the
@@ -165,11 +199,21 @@ namespace graphene {
                 message get_message(peer_connection_delegate *node) override;
 
                 size_t get_size_in_queue() override;
+
+                message_priority get_priority() override;
+
+                item_id get_item_id() override;
             };
 
 
-            size_t _total_queued_messages_size;
-            std::queue<std::unique_ptr<queued_message>, std::list<std::unique_ptr<queued_message>>> _queued_messages;
+            struct send_queue {
+                size_t size_in_bytes = 0; /// including the message being sent
+                size_t max_size_in_bytes = 0;
+                std::deque<std::unique_ptr<queued_message>> messages;
+            };
+
+            std::array<send_queue, size_t(message_priority::count)> _send_queues;
+            uint64_t _number_of_dropped_messages;
             fc::future<void> _send_queued_messages_done;
         public:
             fc::time_point connection_initiation_time;
@@ -215,6 +259,8 @@ namespace graphene {
             fc::optional<std::string> platform;
             fc::optional<uint32_t> bitness;
             fc::optional<steemit::protocol::chain_id_type> chain_id;
+            bool supports_compact_blocks; /// peer has announced it understands compact_block_message in the hello
+            bool supports_block_ranges; /// peer has announced it serves get_block_range_message in the hello
 
             // for inbound connections, these fields record what the peer sent us in
             // its hello message.  For outbound, they record what we sent the peer
@@ -236,9 +282,16 @@ namespace graphene {
             fc::optional<boost::tuple<std::vector<item_hash_t>, fc::time_point>> item_ids_requested_from_peer; /// we check this to detect a timed-out request and in busy()
             fc::time_point last_sync_item_received_time; /// the time we received the last sync item or the time we sent the last batch of sync item requests to this peer
             std::set<item_hash_t> sync_items_requested_from_peer; /// ids of blocks we've requested from this peer during sync.  fetch from another peer if this peer disconnects
+            std::set<item_hash_t> sync_items_reassigned_from_peer; /// sync requests given to another peer because this one stalled, dropped if it sends them late
+            fc::microseconds average_sync_block_interval; /// moving average of the time between sync blocks received from this peer, zero until measured
             item_hash_t last_block_delegate_has_seen; /// the hash of the last block  this peer has told us about that the peer knows
             fc::time_point_sec last_block_time_delegate_has_seen;
             bool inhibit_fetching_sync_blocks;
+            std::deque<std::vector<item_hash_t>> block_ranges_requested_from_peer; /// blocks of the get_block_range_messages sent to this peer, answered in this order
+            uint32_t block_range_limit; /// first block the peer's block log didn't have, later blocks are fetched one by one
+            std::deque<get_block_range_message> block_ranges_requested_by_peer; /// ranges waiting to be streamed to this peer, the front one is being sent
+            fc::future<void> block_range_stream_done;
+            fc::promise<void>::ptr block_range_frame_sent; /// the stream waits on it for room in the send queue
             /// @}
 
             /// non-synchronization state data
@@ -262,9 +315,17 @@ namespace graphene {
                             boost::multi_index::ordered_non_unique<boost::multi_index::tag<timestamp_index>,
                                     boost::multi_index::member<timestamped_item_id, fc::time_point_sec, &timestamped_item_id::timestamp>>>> timestamped_items_set_type;
             timestamped_items_set_type inventory_peer_advertised_to_us;
-            timestamped_items_set_type inventory_advertised_to_peer;
+            rolling_bloom_filter known_inventory; /// items we've advertised to this peer or it has advertised to us, we don't advertise them to it
 
             item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
+
+            /// compact block whose missing transactions were requested from this peer with get_block_transactions_message
+            struct compact_block_reconstruction {
+                compact_block_message compact_block;
+                std::vector<fc::optional<signed_transaction>> transactions; /// unset for the requested ones
+                fc::time_point requested_time; /// dropped by terminate_inactive_connections_loop once the request times out
+            };
+            std::map<item_hash_t, compact_block_reconstruction> compact_blocks_being_reconstructed; /// by block message hash
             /// @}
 
             // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -306,6 +367,21 @@ namespace graphene {
 
             void send_item(const item_id &item_to_send);
 
+            /// Class of the send queue messages of the type are sent in
+            static message_priority get_priority_of_type(uint32_t msg_type);
+
+            /// Bytes waiting in the send queue of the class
+            size_t get_queued_messages_size(message_priority priority) const {
+                return _send_queues[size_t(priority)].size_in_bytes;
+            }
+
+            size_t get_total_queued_messages_size() const;
+
+            /// Messages dropped from the full or stale transaction and inventory queues
+            uint64_t get_number_of_dropped_messages() const {
+                return _number_of_dropped_messages;
+            }
+
             void close_connection();
 
             void destroy_connection();
@@ -330,6 +406,12 @@ namespace graphene {
 
             bool is_transaction_fetching_inhibited() const;
 
+            /// Updates the measured sync speed and the progress time used to detect stalled peers
+            void record_sync_item_received(uint32_t item_count = 1);
+
+            /// Measured speed of delivering sync blocks, zero for a peer which hasn't sent any yet
+            double get_sync_blocks_per_second() const;
+
             fc::sha512 get_shared_secret() const;
 
             void clear_old_inventory();
@@ -345,6 +427,12 @@ namespace graphene {
         private:
             void send_queued_messages_task();
 
+            /// Drops the message, a requested transaction is answered with item_not_available
+            void drop_queued_message(std::unique_ptr<queued_message> &&message_to_drop);
+
+            /// Applies the drop policy of a class over its budget, returns false if the connection was closed
+            bool enforce_send_queue_budget(message_priority priority);
+
             void accept_connection_task();
 
             void connect_to_task(const fc::ip::endpoint &remote_endpoint);
@@ -51,11 +51,17 @@ namespace graphene {
             fc::time_point_sec last_connection_attempt_time;
             uint32_t number_of_successful_connection_attempts;
             uint32_t number_of_failed_connection_attempts;
+            uint32_t number_of_connection_errors; /// times we've disconnected from the peer because of its error
+            uint32_t average_latency_ms; /// round trip delay measured in our last connections, zero if unknown
+            uint32_t sync_block_interval_us; /// time between sync blocks the peer sent us, zero if unknown
             fc::optional<fc::exception> last_error;
 
             potential_peer_record() :
                     number_of_successful_connection_attempts(0),
-                    number_of_failed_connection_attempts(0) {
+                    number_of_failed_connection_attempts(0),
+                    number_of_connection_errors(0),
+                    average_latency_ms(0),
+                    sync_block_interval_us(0) {
             }
 
             potential_peer_record(fc::ip::endpoint endpoint,
@@ -66,8 +72,22 @@ namespace graphene {
                     last_seen_time(last_seen_time),
                     last_connection_disposition(last_connection_disposition),
                     number_of_successful_connection_attempts(0),
-                    number_of_failed_connection_attempts(0) {
+                    number_of_failed_connection_attempts(0),
+                    number_of_connection_errors(0),
+                    average_latency_ms(0),
+                    sync_block_interval_us(0) {
             }
+
+            /// Folds quality measured during a connection into the stored averages
+            void record_connection_quality(const fc::microseconds &round_trip_delay, const fc::microseconds &sync_block_interval);
+
+            /**
+             *  Quality of the peer, higher is better. Peers we've connected to
+             *  without errors, with low latency and fast block delivery are
+             *  tried first. Doesn't depend on the time of the last attempt, the
+             *  retry delay is applied separately.
+             */
+            int64_t score() const;
         };
 
         namespace detail {
@@ -101,6 +121,15 @@ namespace graphene {
         }
 
 
+        /**
+         *  @class peer_database
+         *  @brief Known peers, ordered by @ref potential_peer_record::score
+         *
+         *  Stored as a binary log of changed and erased records. Every update
+         *  appends one record, so nothing is rewritten on close, and the log
+         *  is compacted once it's much larger than the set of live records.
+         *  A JSON database of older versions is imported on the first open.
+         */
         class peer_database {
         public:
             peer_database();
@@ -137,4 +166,4 @@ namespace graphene {
 } // end namespace graphene::net
 
 FC_REFLECT_ENUM(graphene::net::potential_peer_last_connection_disposition, (never_attempted_to_connect)(last_connection_failed)(last_connection_rejected)(last_connection_handshaking_failed)(last_connection_succeeded))
-FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error))
+FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(number_of_connection_errors)(average_latency_ms)(sync_block_interval_us)(last_error))
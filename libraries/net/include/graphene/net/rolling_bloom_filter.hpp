@@ -0,0 +1,94 @@
+#pragma once
+
+#include <graphene/net/core_messages.hpp>
+
+#include <fc/time.hpp>
+
+#include <vector>
+
+namespace graphene {
+    namespace net {
+
+        /**
+         *  @class rolling_bloom_filter
+         *  @brief Bounded set of recently seen items
+         *
+         *  Items are stored in two generations. When the current generation is
+         *  full the previous one is dropped, so the filter always remembers at
+         *  least the items of the last generation. contains() doesn't miss a
+         *  remembered item, but may report an item that wasn't inserted with the
+         *  given false positive rate.
+         *
+         *  A filter created with a generation time starts with the minimal
+         *  generation size and adapts it to the real insert rate: a generation
+         *  filled faster than the generation time makes the next one twice as
+         *  large, up to the maximal size, and one filled much slower makes it
+         *  half as large. Idle peers thus cost a few kilobytes instead of the
+         *  memory needed for the maximal transaction rate.
+         */
+        class rolling_bloom_filter {
+        public:
+            /// Filter of a fixed generation size
+            rolling_bloom_filter(uint32_t generation_size, double false_positive_rate);
+
+            rolling_bloom_filter(uint32_t min_generation_size, uint32_t max_generation_size,
+                    double false_positive_rate, const fc::microseconds &generation_time);
+
+            void insert(const item_id &item);
+
+            bool contains(const item_id &item) const;
+
+            void clear();
+
+            /// Items in the current generation
+            uint32_t size() const {
+                return _current.count;
+            }
+
+            /// Items the current generation holds before it is rotated
+            uint32_t generation_size() const {
+                return _current.capacity;
+            }
+
+            /// Bytes allocated by both generations
+            size_t memory_usage() const {
+                return (_current.bits.size() + _previous.bits.size()) * sizeof(uint64_t);
+            }
+
+        private:
+            struct hashes {
+                uint64_t first;
+                uint64_t second;
+            };
+
+            struct generation {
+                uint32_t capacity = 0;
+                uint32_t count = 0;
+                uint32_t hash_count = 0;
+                uint64_t bit_count = 0;
+                std::vector<uint64_t> bits;
+
+                void reset(uint32_t new_capacity, double false_positive_rate);
+
+                bool contains(const hashes &item_hashes) const;
+
+                void insert(const hashes &item_hashes);
+            };
+
+            hashes hash_item(const item_id &item) const;
+
+            /// Generation size for the next generation, based on how fast the current one was filled
+            uint32_t next_generation_size() const;
+
+            uint32_t _min_generation_size;
+            uint32_t _max_generation_size;
+            double _false_positive_rate;
+            fc::microseconds _generation_time; ///< zero for a fixed generation size
+            fc::time_point _generation_started;
+            uint64_t _tweak; ///< random per filter, so crafted ids can't collide in every node's filters
+            generation _current;
+            generation _previous;
+        };
+
+    }
+} // end namespace graphene::net
@@ -0,0 +1,46 @@
+#include <graphene/net/io_thread_pool.hpp>
+
+#include <fc/log/logger.hpp>
+
+#include <string>
+
+namespace graphene {
+    namespace net {
+
+        io_thread_pool::io_thread_pool()
+                : _next_thread(0) {
+        }
+
+        io_thread_pool::~io_thread_pool() {
+            for (auto &thread : _threads) {
+                thread->quit();
+            }
+        }
+
+        void io_thread_pool::set_thread_count(uint32_t count) {
+            if (count < _threads.size()) {
+                wlog("Can't stop p2p I/O threads in use, keeping ${n} of them", ("n", _threads.size()));
+                return;
+            }
+
+            while (_threads.size() < count) {
+                _threads.push_back(std::make_shared<fc::thread>("p2p io " + std::to_string(_threads.size())));
+            }
+
+            if (count) {
+                ilog("Running p2p I/O on ${n} threads", ("n", count));
+            }
+        }
+
+        fc::thread *io_thread_pool::next_thread() {
+            if (_threads.empty()) {
+                return nullptr;
+            }
+
+            fc::thread *result = _threads[_next_thread % _threads.size()].get();
+            ++_next_thread;
+            return result;
+        }
+
+    }
+} // graphene::net
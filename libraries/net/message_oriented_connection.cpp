@@ -27,9 +27,15 @@
 #include <fc/io/enum_type.hpp>
 
 #include <graphene/net/message_oriented_connection.hpp>
+#include <graphene/net/core_messages.hpp>
 #include <graphene/net/stcp_socket.hpp>
 #include <graphene/net/config.hpp>
 
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include <atomic>
+#include <mutex>
+
 #ifdef DEFAULT_LOGGER
 # undef DEFAULT_LOGGER
 #endif
@@ -44,21 +50,80 @@
 namespace graphene {
     namespace net {
         namespace detail {
+            /**
+             * Wakes up a task sleeping on another thread.  The sleeping task publishes
+             * a promise before it checks its condition, the other side takes and
+             * fulfils it, so a notification can't get lost between the check and
+             * the wait.
+             */
+            struct cross_thread_signal {
+                std::mutex mutex;
+                fc::promise<void>::ptr waiter;
+
+                void notify() {
+                    fc::promise<void>::ptr to_notify;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        to_notify.swap(waiter);
+                    }
+                    if (to_notify) {
+                        to_notify->set_value();
+                    }
+                }
+
+                /// Sleeps until notify() unless ready() holds once the promise is published
+                template<typename Predicate>
+                void wait(const char *name, Predicate ready) {
+                    fc::promise<void>::ptr promise(new fc::promise<void>(name));
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        waiter = promise;
+                    }
+                    if (!ready()) {
+                        promise->wait();
+                    }
+                }
+            };
+
+            /**
+             * Messages read by the I/O thread and waiting for the delegate thread.
+             * The I/O thread is the only producer and the dispatch loop the only
+             * consumer, so a wait-free single producer queue is enough.
+             */
+            struct received_message_queue {
+                received_message_queue()
+                        : messages(GRAPHENE_NET_IO_RECEIVED_MESSAGE_QUEUE_SIZE) {
+                }
+
+                boost::lockfree::spsc_queue<message> messages;
+                std::atomic<bool> closed{false}; ///< read loop has finished, nothing will be pushed anymore
+
+                cross_thread_signal pushed; ///< the dispatch loop sleeps on it while the queue is empty
+                cross_thread_signal popped; ///< the I/O thread sleeps on it while the queue is full
+            };
+
             class message_oriented_connection_impl {
             private:
                 message_oriented_connection *_self;
                 message_oriented_connection_delegate *_delegate;
                 stcp_socket _sock;
                 fc::future<void> _read_loop_done;
-                uint64_t _bytes_received;
-                uint64_t _bytes_sent;
+                std::atomic<uint64_t> _bytes_received;
+                std::atomic<uint64_t> _bytes_sent;
 
                 fc::time_point _connected_time;
-                fc::time_point _last_message_received_time;
-                fc::time_point _last_message_sent_time;
+                std::atomic<int64_t> _last_message_received_time; // microseconds since epoch
+                std::atomic<int64_t> _last_message_sent_time;
 
                 bool _send_message_in_progress;
 
+                /// thread doing socket reads, writes and crypto, nullptr to do it on the delegate thread
+                fc::thread *_io_thread;
+                fc::thread *_delegate_thread;
+                received_message_queue _received_messages;
+                fc::future<void> _dispatch_loop_done;
+                fc::future<void> _send_done;
+
 #ifndef NDEBUG
                 fc::thread *_thread;
 #endif
@@ -67,6 +132,21 @@ namespace graphene {
 
                 void start_read_loop();
 
+                void deliver_message(message &received_message);
+
+                void dispatch_loop();
+
+                /// Runs @p f on the thread owning the socket and waits for it, the socket isn't thread safe
+                template<typename Functor>
+                auto on_io_thread(Functor &&f, const char *desc) -> decltype(f()) {
+                    if (_io_thread && !_io_thread->is_current()) {
+                        return _io_thread->async(std::forward<Functor>(f), desc).wait();
+                    }
+                    return f();
+                }
+
+                void close_socket();
+
             public:
                 fc::tcp_socket &get_socket();
 
@@ -77,7 +157,8 @@ namespace graphene {
                 void bind(const fc::ip::endpoint &local_endpoint);
 
                 message_oriented_connection_impl(message_oriented_connection *self,
-                        message_oriented_connection_delegate *delegate = nullptr);
+                        message_oriented_connection_delegate *delegate = nullptr,
+                        fc::thread *io_thread = nullptr);
 
                 ~message_oriented_connection_impl();
 
@@ -103,12 +184,17 @@ namespace graphene {
             };
 
             message_oriented_connection_impl::message_oriented_connection_impl(message_oriented_connection *self,
-                    message_oriented_connection_delegate *delegate)
+                    message_oriented_connection_delegate *delegate,
+                    fc::thread *io_thread)
                     : _self(self),
                       _delegate(delegate),
                       _bytes_received(0),
                       _bytes_sent(0),
-                      _send_message_in_progress(false)
+                      _last_message_received_time(0),
+                      _last_message_sent_time(0),
+                      _send_message_in_progress(false),
+                      _io_thread(io_thread),
+                      _delegate_thread(&fc::thread::current())
 #ifndef NDEBUG
                     , _thread(&fc::thread::current())
 #endif
@@ -128,15 +214,25 @@ namespace graphene {
             void message_oriented_connection_impl::accept() {
                 VERIFY_CORRECT_THREAD();
                 _sock.accept();
-                assert(!_read_loop_done.valid()); // check to be sure we never launch two read loops
-                _read_loop_done = fc::async([=]() { read_loop(); }, "message read_loop");
+                start_read_loop();
             }
 
             void message_oriented_connection_impl::connect_to(const fc::ip::endpoint &remote_endpoint) {
                 VERIFY_CORRECT_THREAD();
                 _sock.connect_to(remote_endpoint);
+                start_read_loop();
+            }
+
+            void message_oriented_connection_impl::start_read_loop() {
+                VERIFY_CORRECT_THREAD();
                 assert(!_read_loop_done.valid()); // check to be sure we never launch two read loops
-                _read_loop_done = fc::async([=]() { read_loop(); }, "message read_loop");
+                _connected_time = fc::time_point::now();
+                if (_io_thread) {
+                    _dispatch_loop_done = fc::async([=]() { dispatch_loop(); }, "message dispatch_loop");
+                    _read_loop_done = _io_thread->async([=]() { read_loop(); }, "message read_loop");
+                } else {
+                    _read_loop_done = fc::async([=]() { read_loop(); }, "message read_loop");
+                }
             }
 
             void message_oriented_connection_impl::bind(const fc::ip::endpoint &local_endpoint) {
@@ -146,14 +242,11 @@ namespace graphene {
 
 
             void message_oriented_connection_impl::read_loop() {
-                VERIFY_CORRECT_THREAD();
                 const int BUFFER_SIZE = 16;
                 const int LEFTOVER = BUFFER_SIZE - sizeof(message_header);
                 static_assert(BUFFER_SIZE >=
                               sizeof(message_header), "insufficient buffer");
 
-                _connected_time = fc::time_point::now();
-
                 fc::oexception exception_to_rethrow;
                 bool call_on_connection_closed = false;
 
@@ -181,11 +274,11 @@ namespace graphene {
                         }
                         m.data.resize(m.size); // truncate off the padding bytes
 
-                        _last_message_received_time = fc::time_point::now();
+                        _last_message_received_time = fc::time_point::now().time_since_epoch().count();
 
                         try {
                             // message handling errors are warnings...
-                            _delegate->on_message(_self, m);
+                            deliver_message(m);
                         }
                             /// Dedicated catches needed to distinguish from general fc::exception
                         catch (const fc::canceled_exception &e) {
@@ -225,7 +318,11 @@ namespace graphene {
                     exception_to_rethrow = fc::unhandled_exception(FC_LOG_MESSAGE(warn, "disconnected: ${e}", ("e", fc::except_str())));
                 }
 
-                if (call_on_connection_closed) {
+                if (_io_thread) {
+                    // the dispatch loop reports the closed connection after the queued messages
+                    _received_messages.closed = true;
+                    _received_messages.pushed.notify();
+                } else if (call_on_connection_closed) {
                     _delegate->on_connection_closed(_self);
                 }
 
@@ -234,6 +331,66 @@ namespace graphene {
                 }
             }
 
+            void message_oriented_connection_impl::deliver_message(message &received_message) {
+                if (!_io_thread) {
+                    VERIFY_CORRECT_THREAD();
+                    _delegate->on_message(_self, received_message);
+                    return;
+                }
+
+                // the read loop reuses the message, don't hand out the previous one's contents
+                received_message.precomputed_id.reset();
+                received_message.unpacked.reset();
+                received_message.precomputed_id = received_message.id();
+                try {
+                    unpack_core_message(received_message);
+                } catch (const fc::exception &) {
+                    // the node thread unpacks it again and handles the error like for any bad message
+                    received_message.unpacked.reset();
+                }
+
+                // the delegate thread is behind, stop reading the socket until it catches up
+                while (!_received_messages.messages.push(received_message)) {
+                    _received_messages.popped.wait("message_oriented_connection::deliver_message", [this]() {
+                        return _received_messages.messages.write_available() > 0;
+                    });
+                }
+                _received_messages.pushed.notify();
+            }
+
+            void message_oriented_connection_impl::dispatch_loop() {
+                VERIFY_CORRECT_THREAD();
+                message received_message;
+                while (true) {
+                    bool closed = _received_messages.closed;
+                    while (_received_messages.messages.pop(received_message)) {
+                        _received_messages.popped.notify();
+                        try {
+                            _delegate->on_message(_self, received_message);
+                        }
+                        catch (const fc::canceled_exception &) {
+                            throw;
+                        }
+                        catch (const fc::exception &e) {
+                            // same as an exception in the read loop: drop the connection
+                            wlog("message transmission failed ${er}", ("er", e.to_detail_string()));
+                            close_socket();
+                            _delegate->on_connection_closed(_self);
+                            return;
+                        }
+                    }
+
+                    if (closed) {
+                        _delegate->on_connection_closed(_self);
+                        return;
+                    }
+
+                    _received_messages.pushed.wait("message_oriented_connection::dispatch_loop", [this]() {
+                        return _received_messages.messages.read_available() > 0 || _received_messages.closed;
+                    });
+                }
+            }
+
             void message_oriented_connection_impl::send_message(const message &message_to_send) {
                 VERIFY_CORRECT_THREAD();
 #if 0 // this gets too verbose
@@ -271,28 +428,50 @@ namespace graphene {
                     //pad the message we send to a multiple of 16 bytes
                     size_t size_with_padding =
                             16 * ((size_of_message_and_header + 15) / 16);
-                    std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
+                    std::shared_ptr<char> padded_message(new char[size_with_padding], std::default_delete<char[]>());
                     memcpy(padded_message.get(), (char *)&message_to_send, sizeof(message_header));
                     memcpy(padded_message.get() +
                            sizeof(message_header), message_to_send.data.data(), message_to_send.size);
-                    _sock.write(padded_message.get(), size_with_padding);
-                    _sock.flush();
-                    _bytes_sent += size_with_padding;
-                    _last_message_sent_time = fc::time_point::now();
+
+                    auto write_message = [this, padded_message, size_with_padding]() {
+                        _sock.write(padded_message.get(), size_with_padding);
+                        _sock.flush();
+                        _bytes_sent += size_with_padding;
+                        _last_message_sent_time = fc::time_point::now().time_since_epoch().count();
+                    };
+
+                    if (_io_thread) {
+                        // encryption and the write itself run on the I/O thread, this task just waits
+                        _send_done = _io_thread->async(write_message, "message send");
+                        _send_done.wait();
+                    } else {
+                        write_message();
+                    }
                 } FC_RETHROW_EXCEPTIONS(warn, "unable to send message");
             }
 
+            void message_oriented_connection_impl::close_socket() {
+                on_io_thread([this]() { _sock.close(); }, "message_oriented_connection::close_socket");
+            }
+
             void message_oriented_connection_impl::close_connection() {
                 VERIFY_CORRECT_THREAD();
-                _sock.close();
+                close_socket();
             }
 
             void message_oriented_connection_impl::destroy_connection() {
                 VERIFY_CORRECT_THREAD();
 
                 fc::optional<fc::ip::endpoint> remote_endpoint;
-                if (_sock.get_socket().is_open()) {
-                    remote_endpoint = _sock.get_socket().remote_endpoint();
+                try {
+                    remote_endpoint = on_io_thread([this]() -> fc::optional<fc::ip::endpoint> {
+                        if (_sock.get_socket().is_open()) {
+                            return _sock.get_socket().remote_endpoint();
+                        }
+                        return fc::optional<fc::ip::endpoint>();
+                    }, "message_oriented_connection::remote_endpoint");
+                } catch (const fc::exception &) {
+                    // only used for logging
                 }
                 ilog("in destroy_connection() for ${endpoint}", ("endpoint", remote_endpoint));
 
@@ -310,6 +489,25 @@ namespace graphene {
                 catch (...) {
                     wlog("Exception thrown while canceling message_oriented_connection's read_loop, ignoring");
                 }
+
+                if (!_io_thread) {
+                    return;
+                }
+
+                try {
+                    if (_send_done.valid()) {
+                        _send_done.cancel_and_wait(__FUNCTION__);
+                    }
+                    if (_dispatch_loop_done.valid()) {
+                        _dispatch_loop_done.cancel_and_wait(__FUNCTION__);
+                    }
+                }
+                catch (const fc::exception &e) {
+                    wlog("Exception thrown while canceling message_oriented_connection's dispatch_loop, ignoring: ${e}", ("e", e));
+                }
+                catch (...) {
+                    wlog("Exception thrown while canceling message_oriented_connection's dispatch_loop, ignoring");
+                }
             }
 
             uint64_t message_oriented_connection_impl::get_total_bytes_sent() const {
@@ -324,12 +522,12 @@ namespace graphene {
 
             fc::time_point message_oriented_connection_impl::get_last_message_sent_time() const {
                 VERIFY_CORRECT_THREAD();
-                return _last_message_sent_time;
+                return fc::time_point(fc::microseconds(_last_message_sent_time));
             }
 
             fc::time_point message_oriented_connection_impl::get_last_message_received_time() const {
                 VERIFY_CORRECT_THREAD();
-                return _last_message_received_time;
+                return fc::time_point(fc::microseconds(_last_message_received_time));
             }
 
             fc::sha512 message_oriented_connection_impl::get_shared_secret() const {
@@ -340,9 +538,10 @@ namespace graphene {
         } // end namespace graphene::net::detail
 
 
-        message_oriented_connection::message_oriented_connection(message_oriented_connection_delegate *delegate)
+        message_oriented_connection::message_oriented_connection(message_oriented_connection_delegate *delegate,
+                fc::thread *io_thread)
                 :
-                my(new detail::message_oriented_connection_impl(this, delegate)) {
+                my(new detail::message_oriented_connection_impl(this, delegate, io_thread)) {
         }
 
         message_oriented_connection::~message_oriented_connection() {
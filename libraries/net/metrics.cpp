@@ -0,0 +1,201 @@
+#include <graphene/net/metrics.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace graphene {
+    namespace net {
+
+        namespace {
+            const char *type_name(metric_type type) {
+                switch (type) {
+                    case counter_metric:
+                        return "counter";
+                    case gauge_metric:
+                        return "gauge";
+                    default:
+                        return "histogram";
+                }
+            }
+
+            void write_value(std::ostream &out, double value) {
+                if (value == std::numeric_limits<double>::infinity()) {
+                    out << "+Inf";
+                } else {
+                    out << std::setprecision(std::numeric_limits<double>::digits10) << value;
+                }
+            }
+
+            void write_labels(std::ostream &out, const metric_labels &labels,
+                    const std::string &extra_name = std::string(), const std::string &extra_value = std::string()) {
+                if (labels.empty() && extra_name.empty()) {
+                    return;
+                }
+
+                auto write_label = [&](const std::string &name, const std::string &value) {
+                    out << name << "=\"";
+                    for (char c : value) {
+                        if (c == '\\' || c == '"') {
+                            out << '\\' << c;
+                        } else if (c == '\n') {
+                            out << "\\n";
+                        } else {
+                            out << c;
+                        }
+                    }
+                    out << '"';
+                };
+
+                out << '{';
+                bool first = true;
+                for (const auto &label : labels) {
+                    if (!first) {
+                        out << ',';
+                    }
+                    write_label(label.first, label.second);
+                    first = false;
+                }
+                if (!extra_name.empty()) {
+                    if (!first) {
+                        out << ',';
+                    }
+                    write_label(extra_name, extra_value);
+                }
+                out << '}';
+            }
+
+            fc::variant labels_to_variant(const metric_labels &labels) {
+                fc::mutable_variant_object result;
+                for (const auto &label : labels) {
+                    result[label.first] = label.second;
+                }
+                return result;
+            }
+        }
+
+        void metrics_registry::describe(const std::string &name, metric_type type, const std::string &help,
+                const std::vector<double> &buckets) {
+            FC_ASSERT(type == histogram_metric || buckets.empty(), "Only histograms have buckets");
+            FC_ASSERT(std::is_sorted(buckets.begin(), buckets.end()), "Histogram buckets must be ascending");
+
+            metric_family &family = _families[name];
+            family.type = type;
+            family.help = help;
+            family.buckets = buckets;
+        }
+
+        metrics_registry::metric_family &metrics_registry::get_family(const std::string &name, metric_type type) {
+            auto itr = _families.find(name);
+            FC_ASSERT(itr != _families.end(), "Metric ${name} wasn't described", ("name", name));
+            FC_ASSERT(itr->second.type == type, "Metric ${name} is a ${type}", ("name", name)("type", type_name(itr->second.type)));
+            return itr->second;
+        }
+
+        void metrics_registry::increment(const std::string &name, const metric_labels &labels, double value) {
+            get_family(name, counter_metric).values[labels] += value;
+        }
+
+        void metrics_registry::set(const std::string &name, const metric_labels &labels, double value) {
+            get_family(name, gauge_metric).values[labels] = value;
+        }
+
+        void metrics_registry::observe(const std::string &name, const metric_labels &labels, double value) {
+            metric_family &family = get_family(name, histogram_metric);
+            histogram_series &series = family.histograms[labels];
+            if (series.bucket_counts.empty()) {
+                series.bucket_counts.resize(family.buckets.size() + 1);
+            }
+
+            auto bucket = std::lower_bound(family.buckets.begin(), family.buckets.end(), value) - family.buckets.begin();
+            ++series.bucket_counts[bucket];
+            series.sum += value;
+            ++series.count;
+        }
+
+        void metrics_registry::clear(const std::string &name) {
+            auto itr = _families.find(name);
+            if (itr != _families.end()) {
+                itr->second.values.clear();
+                itr->second.histograms.clear();
+            }
+        }
+
+        std::string metrics_registry::to_text() const {
+            std::ostringstream out;
+            for (const auto &item : _families) {
+                const std::string &name = item.first;
+                const metric_family &family = item.second;
+
+                out << "# HELP " << name << ' ' << family.help << '\n';
+                out << "# TYPE " << name << ' ' << type_name(family.type) << '\n';
+
+                for (const auto &series : family.values) {
+                    out << name;
+                    write_labels(out, series.first);
+                    out << ' ';
+                    write_value(out, series.second);
+                    out << '\n';
+                }
+
+                for (const auto &series : family.histograms) {
+                    uint64_t cumulative_count = 0;
+                    for (size_t i = 0; i < series.second.bucket_counts.size(); ++i) {
+                        cumulative_count += series.second.bucket_counts[i];
+
+                        std::ostringstream bound;
+                        write_value(bound, i < family.buckets.size() ? family.buckets[i] : std::numeric_limits<double>::infinity());
+
+                        out << name << "_bucket";
+                        write_labels(out, series.first, "le", bound.str());
+                        out << ' ' << cumulative_count << '\n';
+                    }
+                    out << name << "_sum";
+                    write_labels(out, series.first);
+                    out << ' ';
+                    write_value(out, series.second.sum);
+                    out << '\n';
+                    out << name << "_count";
+                    write_labels(out, series.first);
+                    out << ' ' << series.second.count << '\n';
+                }
+            }
+            return out.str();
+        }
+
+        fc::variant metrics_registry::to_variant() const {
+            fc::mutable_variant_object result;
+            for (const auto &item : _families) {
+                const metric_family &family = item.second;
+
+                std::vector<fc::variant> series_list;
+                for (const auto &series : family.values) {
+                    fc::mutable_variant_object series_object;
+                    series_object["labels"] = labels_to_variant(series.first);
+                    series_object["value"] = series.second;
+                    series_list.emplace_back(series_object);
+                }
+                for (const auto &series : family.histograms) {
+                    fc::mutable_variant_object series_object;
+                    series_object["labels"] = labels_to_variant(series.first);
+                    series_object["count"] = series.second.count;
+                    series_object["sum"] = series.second.sum;
+                    series_object["buckets"] = family.buckets;
+                    series_object["bucket_counts"] = series.second.bucket_counts;
+                    series_list.emplace_back(series_object);
+                }
+
+                fc::mutable_variant_object family_object;
+                family_object["type"] = type_name(family.type);
+                family_object["help"] = family.help;
+                family_object["series"] = series_list;
+                result[item.first] = family_object;
+            }
+            return result;
+        }
+
+    }
+} // end namespace graphene::net
@@ -21,9 +21,14 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include <deque>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
 #include <unordered_set>
 #include <list>
 #include <forward_list>
@@ -64,6 +69,9 @@
 #include <graphene/net/node.hpp>
 #include <graphene/net/peer_connection.hpp>
 #include <graphene/net/exceptions.hpp>
+#include <graphene/net/io_thread_pool.hpp>
+#include <graphene/net/rolling_bloom_filter.hpp>
+#include <graphene/net/metrics.hpp>
 
 #include <fc/git_revision.hpp>
 
@@ -119,6 +127,8 @@ namespace graphene {
                 };
                 struct block_clock_index {
                 };
+                struct short_transaction_id_index {
+                };
 
                 struct message_info {
                     message_hash_type message_hash;
@@ -128,6 +138,7 @@ namespace graphene {
                     // for network performance stats
                     message_propagation_data propagation_data;
                     fc::uint160_t message_contents_hash; // hash of whatever the message contains (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
+                    uint64_t short_transaction_id; // compact block id of the transaction, 0 for other messages
 
                     message_info(const message_hash_type &message_hash,
                             const message &message_body,
@@ -138,7 +149,9 @@ namespace graphene {
                             message_body(message_body),
                             block_clock_when_received(block_clock_when_received),
                             propagation_data(propagation_data),
-                            message_contents_hash(message_contents_hash) {
+                            message_contents_hash(message_contents_hash),
+                            short_transaction_id(message_body.msg_type == trx_message_type ?
+                                                 compact_block_message::short_transaction_id(message_contents_hash) : 0) {
                     }
                 };
 
@@ -149,7 +162,9 @@ namespace graphene {
                                         bmi::ordered_non_unique<bmi::tag<message_contents_hash_index>,
                                                 bmi::member<message_info, fc::uint160_t, &message_info::message_contents_hash>>,
                                         bmi::ordered_non_unique<bmi::tag<block_clock_index>,
-                                                bmi::member<message_info, uint32_t, &message_info::block_clock_when_received>>>
+                                                bmi::member<message_info, uint32_t, &message_info::block_clock_when_received>>,
+                                        bmi::ordered_non_unique<bmi::tag<short_transaction_id_index>,
+                                                bmi::member<message_info, uint64_t, &message_info::short_transaction_id>>>
                         > message_cache_container;
 
                 message_cache_container _message_cache;
@@ -168,8 +183,16 @@ namespace graphene {
 
                 message get_message(const message_hash_type &hash_of_message_to_lookup);
 
+                bool has_message(const message_hash_type &hash_of_message_to_lookup) const {
+                    return _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup) !=
+                           _message_cache.get<message_hash_index>().end();
+                }
+
                 message_propagation_data get_message_propagation_data(const fc::uint160_t &hash_of_message_contents_to_lookup) const;
 
+                /// Looks up a cached transaction by the id used in compact blocks
+                fc::optional<signed_transaction> get_transaction(uint64_t short_transaction_id) const;
+
                 size_t size() const {
                     return _message_cache.size();
                 }
@@ -216,6 +239,16 @@ namespace graphene {
                 FC_THROW_EXCEPTION(fc::key_not_found_exception, "Requested message not in cache");
             }
 
+            fc::optional<signed_transaction> blockchain_tied_message_cache::get_transaction(uint64_t short_transaction_id) const {
+                auto range = _message_cache.get<short_transaction_id_index>().equal_range(short_transaction_id);
+                for (auto iter = range.first; iter != range.second; ++iter) {
+                    if (iter->message_body.msg_type == trx_message_type) {
+                        return iter->message_body.as<trx_message>().trx;
+                    }
+                }
+                return fc::optional<signed_transaction>();
+            }
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
             // This specifies configuration info for the local node.  It's stored as JSON
@@ -282,6 +315,7 @@ namespace graphene {
             private:
                 node_delegate *_node_delegate;
                 fc::thread *_thread;
+                metrics_registry *_metrics;
 
                 typedef boost::accumulators::accumulator_set<int64_t, boost::accumulators::stats<boost::accumulators::tag::min,
                         boost::accumulators::tag::rolling_mean,
@@ -294,6 +328,8 @@ namespace graphene {
                                    (handle_transaction) \
                                    (get_block_ids) \
                                    (get_item) \
+                                   (get_pending_transactions) \
+                                   (get_packed_blocks) \
                                    (get_blockchain_synopsis) \
                                    (sync_status) \
                                    (connection_count_changed) \
@@ -317,6 +353,7 @@ namespace graphene {
                     fc::time_point _begin_execution_time;
                     fc::time_point _execution_completed_time;
                     const char *_method_name;
+                    metrics_registry *_metrics;
                     call_stats_accumulator *_execution_accumulator;
                     call_stats_accumulator *_delay_before_accumulator;
                     call_stats_accumulator *_delay_after_accumulator;
@@ -336,11 +373,13 @@ namespace graphene {
                     };
 
                     call_statistics_collector(const char *method_name,
+                            metrics_registry *metrics,
                             call_stats_accumulator *execution_accumulator,
                             call_stats_accumulator *delay_before_accumulator,
                             call_stats_accumulator *delay_after_accumulator) :
                             _call_requested_time(fc::time_point::now()),
                             _method_name(method_name),
+                            _metrics(metrics),
                             _execution_accumulator(execution_accumulator),
                             _delay_before_accumulator(delay_before_accumulator),
                             _delay_after_accumulator(delay_after_accumulator) {
@@ -361,6 +400,9 @@ namespace graphene {
                         (*_execution_accumulator)(actual_execution_time.count());
                         (*_delay_before_accumulator)(delay_before.count());
                         (*_delay_after_accumulator)(delay_after.count());
+                        if (_metrics) {
+                            _metrics->observe("p2p_delegate_call_seconds", {{"method", _method_name}}, total_duration.count() / 1000000.0);
+                        }
                         if (total_duration > fc::milliseconds(500)) {
                             ilog("Call to method node_delegate::${method} took ${total_duration}us, longer than our target maximum of 500ms",
                                     ("method", _method_name)
@@ -383,7 +425,7 @@ namespace graphene {
                 };
 
             public:
-                statistics_gathering_node_delegate_wrapper(node_delegate *delegate, fc::thread *thread_for_delegate_calls);
+                statistics_gathering_node_delegate_wrapper(node_delegate *delegate, fc::thread *thread_for_delegate_calls, metrics_registry *metrics);
 
                 fc::variant_object get_call_statistics();
 
@@ -401,6 +443,10 @@ namespace graphene {
 
                 message get_item(const item_id &id) override;
 
+                std::vector<signed_transaction> get_pending_transactions() override;
+
+                std::vector<std::vector<char>> get_packed_blocks(uint32_t first_block_num, uint32_t limit, uint32_t max_bytes) override;
+
                 std::vector<item_hash_t> get_blockchain_synopsis(const item_hash_t &reference_point,
                         uint32_t number_of_blocks_after_reference_point) override;
 
@@ -428,10 +474,12 @@ namespace graphene {
 #ifdef P2P_IN_DEDICATED_THREAD
                 std::shared_ptr<fc::thread> _thread;
 #endif // P2P_IN_DEDICATED_THREAD
+                /// socket I/O of the connections, declared early to outlive them
+                io_thread_pool _io_threads;
                 std::unique_ptr<statistics_gathering_node_delegate_wrapper> _delegate;
 
 #define NODE_CONFIGURATION_FILENAME      "node_config.json"
-#define POTENTIAL_PEER_DATABASE_FILENAME "peers.json"
+#define POTENTIAL_PEER_DATABASE_FILENAME "peers.dat"
                 fc::path _node_configuration_directory;
                 node_configuration _node_configuration;
 
@@ -496,6 +544,7 @@ namespace graphene {
                 fc::promise<void>::ptr _retrigger_advertise_inventory_loop_promise;
                 fc::future<void> _advertise_inventory_loop_done;
                 std::unordered_set<item_id> _new_inventory; /// list of items we have received but not yet advertised to our peers
+                rolling_bloom_filter _recently_advertised_inventory; /// items we've advertised, so we have them and don't need to fetch them
                 // @}
 
                 fc::future<void> _terminate_inactive_connections_loop_done;
@@ -569,6 +618,9 @@ namespace graphene {
 
                 fc::future<void> _dump_node_status_task_done;
 
+                metrics_registry _metrics;
+                std::map<uint32_t, std::string> _message_type_names; /// labels of message metrics by type
+
                 /* We have two alternate paths through the schedule_peer_for_deletion code -- one that
        * uses a mutex to prevent one fiber from adding items to the queue while another is deleting
        * items from it, and one that doesn't.  The one that doesn't is simpler and more efficient
@@ -613,6 +665,10 @@ namespace graphene {
 
                 void request_sync_items_from_peer(const peer_connection_ptr &peer, const std::vector<item_hash_t> &items_to_request);
 
+                uint32_t get_sync_range_size(const peer_connection_ptr &peer) const;
+
+                void reassign_stalled_sync_items(std::map<peer_connection_ptr, std::vector<item_hash_t>> &sync_item_requests_to_send);
+
                 void fetch_sync_items_loop();
 
                 void trigger_fetch_sync_items_loop();
@@ -664,6 +720,12 @@ namespace graphene {
                 void on_message(peer_connection *originating_peer,
                         const message &received_message) override;
 
+                void on_message_sent(peer_connection *destination_peer,
+                        const message &sent_message) override;
+
+                void on_message_dropped(peer_connection *destination_peer,
+                        const item_id &dropped_item) override;
+
                 void on_hello_message(peer_connection *originating_peer,
                         const hello_message &hello_message_received);
 
@@ -717,6 +779,31 @@ namespace graphene {
                 void on_get_current_connections_reply_message(peer_connection *originating_peer,
                         const get_current_connections_reply_message &get_current_connections_reply_message_received);
 
+                void send_compact_blocks(peer_connection *originating_peer, const std::vector<item_hash_t> &block_message_hashes);
+
+                void on_compact_block_message(peer_connection *originating_peer,
+                        const compact_block_message &compact_block_message_received);
+
+                void on_get_block_transactions_message(peer_connection *originating_peer,
+                        const get_block_transactions_message &get_block_transactions_message_received);
+
+                void on_block_transactions_message(peer_connection *originating_peer,
+                        const block_transactions_message &block_transactions_message_received);
+
+                void on_get_block_range_message(peer_connection *originating_peer,
+                        const get_block_range_message &get_block_range_message_received);
+
+                void on_block_range_message(peer_connection *originating_peer,
+                        const block_range_message &block_range_message_received);
+
+                /// Streams the requested ranges, holds the connection only while it's working on it so a closed one can go
+                void send_block_ranges_to_peer(std::weak_ptr<peer_connection> weak_peer);
+
+                void cancel_block_range_stream(peer_connection *peer);
+
+                void finish_compact_block(peer_connection *originating_peer,
+                        peer_connection::compact_block_reconstruction &&reconstruction);
+
                 void on_connection_closed(peer_connection *originating_peer) override;
 
                 void send_sync_block_to_node_delegate(const graphene::net::block_message &block_message_to_send);
@@ -725,7 +812,9 @@ namespace graphene {
 
                 void trigger_process_backlog_of_sync_blocks();
 
-                void process_block_during_sync(peer_connection *originating_peer, const graphene::net::block_message &block_message, const message_hash_type &message_hash);
+                void process_block_during_sync(peer_connection *originating_peer, const graphene::net::block_message &block_message);
+
+                bool process_sync_block_from_peer(peer_connection *originating_peer, const graphene::net::block_message &block_message);
 
                 void process_block_during_normal_operation(peer_connection *originating_peer, const graphene::net::block_message &block_message, const message_hash_type &message_hash);
 
@@ -761,6 +850,19 @@ namespace graphene {
 
                 void dump_node_status();
 
+                void describe_metrics();
+
+                const std::string &get_message_type_name(uint32_t msg_type);
+
+                static const char *get_send_queue_class_name(peer_connection::message_priority priority);
+
+                /// Refreshes the gauges describing connections, send queues and sync from the current state
+                void collect_metrics();
+
+                fc::variant get_metrics();
+
+                std::string get_metrics_text();
+
                 void delayed_peer_deletion_task();
 
                 void schedule_peer_for_deletion(const peer_connection_ptr &peer_to_delete);
@@ -829,6 +931,8 @@ namespace graphene {
 
                 message get_message_for_item(const item_id &item) override;
 
+                fc::thread *get_io_thread() override;
+
                 fc::variant_object network_get_info() const;
 
                 fc::variant_object network_get_usage_stats() const;
@@ -879,6 +983,10 @@ namespace graphene {
                     _suspend_fetching_sync_blocks(false),
                     _items_to_fetch_updated(false),
                     _items_to_fetch_sequence_counter(0),
+                    _recently_advertised_inventory(GRAPHENE_NET_KNOWN_INVENTORY_MIN_GENERATION_SIZE,
+                            GRAPHENE_NET_KNOWN_INVENTORY_GENERATION_SIZE,
+                            GRAPHENE_NET_KNOWN_INVENTORY_FALSE_POSITIVE_RATE,
+                            GRAPHENE_NET_KNOWN_INVENTORY_GENERATION_TIME),
                     _recent_block_interval_in_seconds(STEEMIT_BLOCK_INTERVAL),
                     _user_agent_string(user_agent),
                     _desired_number_of_connections(GRAPHENE_NET_DEFAULT_DESIRED_CONNECTIONS),
@@ -904,6 +1012,7 @@ namespace graphene {
                     _maximum_blocks_per_peer_during_syncing(GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING) {
                 _rate_limiter.set_actual_rate_time_constant(fc::seconds(2));
                 fc::rand_pseudo_bytes(&_node_id.data[0], (int)_node_id.size());
+                describe_metrics();
             }
 
             node_impl::~node_impl() {
@@ -981,10 +1090,11 @@ namespace graphene {
                             bool initiated_connection_this_pass = false;
                             _potential_peer_database_updated = false;
 
+                            // the database is ordered by score, so the best peers are tried first.  Pick the
+                            // candidates before connecting, connection attempts update their records
+                            std::vector<fc::ip::endpoint> endpoints_to_connect;
                             for (peer_database::iterator iter = _potential_peer_db.begin();
-                                 iter != _potential_peer_db.end() &&
-                                 is_wanting_new_connections();
-                                 ++iter) {
+                                 iter != _potential_peer_db.end(); ++iter) {
                                 fc::microseconds delay_until_retry = fc::seconds(
                                         (iter->number_of_failed_connection_attempts +
                                          1) * _peer_connection_retry_timeout);
@@ -999,7 +1109,16 @@ namespace graphene {
                                      (fc::time_point::now() -
                                       iter->last_connection_attempt_time) >
                                      delay_until_retry)) {
-                                    connect_to_endpoint(iter->endpoint);
+                                    endpoints_to_connect.push_back(iter->endpoint);
+                                }
+                            }
+
+                            for (const fc::ip::endpoint &endpoint : endpoints_to_connect) {
+                                if (!is_wanting_new_connections()) {
+                                    break;
+                                }
+                                if (!is_connection_to_endpoint_in_progress(endpoint)) {
+                                    connect_to_endpoint(endpoint);
                                     initiated_connection_this_pass = true;
                                 }
                             }
@@ -1084,12 +1203,115 @@ namespace graphene {
                 VERIFY_CORRECT_THREAD();
                 dlog("requesting ${item_count} item(s) ${items_to_request} from peer ${endpoint}",
                         ("item_count", items_to_request.size())("items_to_request", items_to_request)("endpoint", peer->get_remote_endpoint()));
-                for (const item_hash_t &item_to_request : items_to_request) {
-                    _active_sync_requests.insert(active_sync_requests_map::value_type(item_to_request, fc::time_point::now()));
+                // a peer still delivering its previous range keeps measuring from its last block
+                if (peer->sync_items_requested_from_peer.empty()) {
                     peer->last_sync_item_received_time = fc::time_point::now();
+                }
+
+                // runs of consecutive blocks are streamed by peers supporting block ranges, the rest is fetched one by one
+                std::vector<item_hash_t> items_to_fetch;
+                std::vector<item_hash_t> block_range;
+                auto send_block_range = [&]() {
+                    if (block_range.empty()) {
+                        return;
+                    }
+                    if (peer->block_ranges_requested_from_peer.size() < GRAPHENE_NET_MAX_BLOCK_RANGE_REQUESTS) {
+                        peer->send_message(get_block_range_message(block_range.front(), (uint32_t)block_range.size()));
+                        peer->block_ranges_requested_from_peer.push_back(std::move(block_range));
+                    } else {
+                        items_to_fetch.insert(items_to_fetch.end(), block_range.begin(), block_range.end());
+                    }
+                    block_range.clear();
+                };
+
+                for (const item_hash_t &item_to_request : items_to_request) {
+                    _active_sync_requests[item_to_request] = fc::time_point::now();
                     peer->sync_items_requested_from_peer.insert(item_to_request);
+
+                    uint32_t block_number = _delegate->get_block_number(item_to_request);
+                    if (!peer->supports_block_ranges || block_number >= peer->block_range_limit) {
+                        items_to_fetch.push_back(item_to_request);
+                        continue;
+                    }
+                    if (!block_range.empty() &&
+                        block_number != _delegate->get_block_number(block_range.back()) + 1) {
+                        send_block_range();
+                    }
+                    block_range.push_back(item_to_request);
+                }
+                send_block_range();
+
+                if (!items_to_fetch.empty()) {
+                    peer->send_message(fetch_items_message(graphene::net::block_message_type, items_to_fetch));
+                }
+            }
+
+            uint32_t node_impl::get_sync_range_size(const peer_connection_ptr &peer) const {
+                VERIFY_CORRECT_THREAD();
+                uint32_t min_range_size = std::min<uint32_t>(GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING,
+                        _maximum_blocks_per_peer_during_syncing);
+                // a streamed range costs one request, not a round trip per block
+                uint32_t max_range_size = peer->supports_block_ranges &&
+                                          peer->block_range_limit == std::numeric_limits<uint32_t>::max() ?
+                                          GRAPHENE_NET_MAX_BLOCKS_PER_BLOCK_RANGE :
+                                          _maximum_blocks_per_peer_during_syncing;
+                double expected_blocks = peer->get_sync_blocks_per_second() * GRAPHENE_NET_SYNC_RANGE_DURATION_SEC;
+                if (expected_blocks <= min_range_size) {
+                    return min_range_size;
+                }
+                return static_cast<uint32_t>(std::min<double>(expected_blocks, max_range_size));
+            }
+
+            void node_impl::reassign_stalled_sync_items(std::map<peer_connection_ptr, std::vector<item_hash_t>> &sync_item_requests_to_send) {
+                VERIFY_CORRECT_THREAD();
+                ASSERT_TASK_NOT_PREEMPTED();
+                fc::time_point stalled_threshold = fc::time_point::now() -
+                                                   fc::seconds(GRAPHENE_NET_SYNC_STALLED_REQUEST_TIMEOUT_SEC);
+
+                // the blocks the chain needs next are at the front of the peers' lists
+                std::set<item_hash_t> next_items;
+                for (const peer_connection_ptr &peer : _active_connections) {
+                    if (peer->we_need_sync_items_from_peer && !peer->ids_of_items_to_get.empty()) {
+                        next_items.insert(peer->ids_of_items_to_get.front());
+                    }
+                }
+
+                for (const item_hash_t &item : next_items) {
+                    auto request_iter = _active_sync_requests.find(item);
+                    if (request_iter == _active_sync_requests.end() ||
+                        request_iter->second >= stalled_threshold) {
+                        continue;
+                    }
+
+                    peer_connection_ptr stalled_peer;
+                    peer_connection_ptr best_peer;
+                    for (const peer_connection_ptr &peer : _active_connections) {
+                        if (peer->sync_items_requested_from_peer.count(item)) {
+                            stalled_peer = peer;
+                        } else if (peer->we_need_sync_items_from_peer &&
+                                   !peer->inhibit_fetching_sync_blocks &&
+                                   std::find(peer->ids_of_items_to_get.begin(), peer->ids_of_items_to_get.end(), item) !=
+                                   peer->ids_of_items_to_get.end() &&
+                                   (!best_peer ||
+                                    peer->get_sync_blocks_per_second() > best_peer->get_sync_blocks_per_second())) {
+                            best_peer = peer;
+                        }
+                    }
+
+                    if (!stalled_peer || !best_peer) {
+                        continue;
+                    }
+
+                    fc_wlog(fc::logger::get("sync"),
+                            "peer ${stalled} hasn't sent the next sync block ${item} in ${timeout} seconds, requesting it from ${peer}",
+                            ("stalled", stalled_peer->get_remote_endpoint())("item", item)
+                                    ("timeout", GRAPHENE_NET_SYNC_STALLED_REQUEST_TIMEOUT_SEC)
+                                    ("peer", best_peer->get_remote_endpoint()));
+                    stalled_peer->sync_items_requested_from_peer.erase(item);
+                    stalled_peer->sync_items_reassigned_from_peer.insert(item);
+                    _active_sync_requests.erase(request_iter);
+                    sync_item_requests_to_send[best_peer].push_back(item);
                 }
-                peer->send_message(fetch_items_message(graphene::net::block_message_type, items_to_request));
             }
 
             void node_impl::fetch_sync_items_loop() {
@@ -1103,38 +1325,70 @@ namespace graphene {
 
                         {
                             ASSERT_TASK_NOT_PREEMPTED();
+                            reassign_stalled_sync_items(sync_item_requests_to_send);
+
                             std::set<item_hash_t> sync_items_to_request;
+                            for (const auto &reassigned : sync_item_requests_to_send) {
+                                sync_items_to_request.insert(reassigned.second.begin(), reassigned.second.end());
+                            }
 
-                            // for each idle peer that we're syncing with
+                            // the reorder buffer is bounded: blocks requested and blocks received but
+                            // not pushed yet together never exceed the prefetch limit
+                            size_t blocks_in_pipeline = _active_sync_requests.size() +
+                                                        _received_sync_items.size() +
+                                                        _new_received_sync_items.size();
+                            size_t request_budget = blocks_in_pipeline < _maximum_number_of_sync_blocks_to_prefetch ?
+                                                    _maximum_number_of_sync_blocks_to_prefetch - blocks_in_pipeline : 0;
+
+                            // fastest peers first, so the blocks the chain needs soonest come from them.
+                            // Peers not measured yet go last
+                            std::vector<peer_connection_ptr> sync_peers;
                             for (const peer_connection_ptr &peer : _active_connections) {
-                                if (peer->we_need_sync_items_from_peer &&
-                                    sync_item_requests_to_send.find(peer) ==
-                                    sync_item_requests_to_send.end() &&
-                                    // if we've already scheduled a request for this peer, don't consider scheduling another
-                                    peer->idle()) {
-                                    if (!peer->inhibit_fetching_sync_blocks) {
-                                        // loop through the items it has that we don't yet have on our blockchain
-                                        for (unsigned i = 0; i <
-                                                             peer->ids_of_items_to_get.size(); ++i) {
-                                            item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
-                                            // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
-                                            if (!have_already_received_sync_item(item_to_potentially_request) &&
-                                                // already got it, but for some reson it's still in our list of items to fetch
-                                                sync_items_to_request.find(item_to_potentially_request) ==
-                                                sync_items_to_request.end() &&
-                                                // we have already decided to request it from another peer during this iteration
-                                                _active_sync_requests.find(item_to_potentially_request) ==
-                                                _active_sync_requests.end()) // we've requested it in a previous iteration and we're still waiting for it to arrive
-                                            {
-                                                // then schedule a request from this peer
-                                                sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
-                                                sync_items_to_request.insert(item_to_potentially_request);
-                                                if (sync_item_requests_to_send[peer].size() >=
-                                                    _maximum_blocks_per_peer_during_syncing) {
-                                                        break;
-                                                }
-                                            }
-                                        }
+                                if (peer->we_need_sync_items_from_peer && !peer->inhibit_fetching_sync_blocks) {
+                                    sync_peers.push_back(peer);
+                                }
+                            }
+                            std::stable_sort(sync_peers.begin(), sync_peers.end(),
+                                    [](const peer_connection_ptr &a, const peer_connection_ptr &b) {
+                                        return a->get_sync_blocks_per_second() > b->get_sync_blocks_per_second();
+                                    });
+
+                            for (const peer_connection_ptr &peer : sync_peers) {
+                                if (!request_budget) {
+                                    break;
+                                }
+
+                                // a peer gets its next range once half of the previous one has arrived,
+                                // so it never waits for our request between ranges
+                                uint32_t range_size = get_sync_range_size(peer);
+                                if (!peer->items_requested_from_peer.empty() ||
+                                    peer->item_ids_requested_from_peer ||
+                                    peer->sync_items_requested_from_peer.size() > range_size / 2) {
+                                    continue;
+                                }
+
+                                std::vector<item_hash_t> &requests = sync_item_requests_to_send[peer];
+                                // loop through the items it has that we don't yet have on our blockchain
+                                for (unsigned i = 0; i < peer->ids_of_items_to_get.size() &&
+                                                     requests.size() < range_size &&
+                                                     request_budget; ++i) {
+                                    item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
+                                    // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
+                                    if (!have_already_received_sync_item(item_to_potentially_request) &&
+                                        // already got it, but for some reson it's still in our list of items to fetch
+                                        sync_items_to_request.find(item_to_potentially_request) ==
+                                        sync_items_to_request.end() &&
+                                        // we have already decided to request it from another peer during this iteration
+                                        _active_sync_requests.find(item_to_potentially_request) ==
+                                        _active_sync_requests.end() &&
+                                        // we've requested it in a previous iteration and we're still waiting for it to arrive
+                                        !peer->sync_items_reassigned_from_peer.count(item_to_potentially_request))
+                                        // this peer has stalled on it already
+                                    {
+                                        // then schedule a request from this peer
+                                        requests.push_back(item_to_potentially_request);
+                                        sync_items_to_request.insert(item_to_potentially_request);
+                                        --request_budget;
                                     }
                                 }
                             }
@@ -1142,7 +1396,9 @@ namespace graphene {
 
                         // make all the requests we scheduled in the loop above
                         for (auto sync_item_request : sync_item_requests_to_send) {
-                            request_sync_items_from_peer(sync_item_request.first, sync_item_request.second);
+                            if (!sync_item_request.second.empty()) {
+                                request_sync_items_from_peer(sync_item_request.first, sync_item_request.second);
+                            }
                         }
                         sync_item_requests_to_send.clear();
                     } else
@@ -1151,7 +1407,17 @@ namespace graphene {
                     if (!_sync_items_to_fetch_updated) {
                         dlog("no sync items to fetch right now, going to sleep");
                         _retrigger_fetch_sync_items_loop_promise = fc::promise<void>::ptr(new fc::promise<void>("graphene::net::retrigger_fetch_sync_items_loop"));
-                        _retrigger_fetch_sync_items_loop_promise->wait();
+                        try {
+                            // wake up periodically while requests are outstanding to catch stalled peers
+                            if (_active_sync_requests.empty()) {
+                                _retrigger_fetch_sync_items_loop_promise->wait();
+                            } else {
+                                _retrigger_fetch_sync_items_loop_promise->wait(fc::seconds(GRAPHENE_NET_SYNC_STALLED_REQUEST_TIMEOUT_SEC / 2));
+                            }
+                        }
+                        catch (fc::timeout_exception &) {
+                            dlog("checking sync requests for stalled peers");
+                        }
                         _retrigger_fetch_sync_items_loop_promise.reset();
                     }
                 } // while( !canceled )
@@ -1290,7 +1556,15 @@ namespace graphene {
                                     }
                             }
 
-                            peer_and_items.peer->send_message(fetch_items_message(items_by_type.first,
+                            // peers supporting compact blocks send them in place of the full ones,
+                            // the request is still tracked as a block_message_type item
+                            uint32_t item_type_to_request = items_by_type.first;
+                            if (item_type_to_request == core_message_type_enum::block_message_type &&
+                                peer_and_items.peer->supports_compact_blocks) {
+                                item_type_to_request = core_message_type_enum::compact_block_message_type;
+                            }
+
+                            peer_and_items.peer->send_message(fetch_items_message(item_type_to_request,
                                     items_by_type.second));
                         }
                     }
@@ -1328,6 +1602,31 @@ namespace graphene {
             void node_impl::advertise_inventory_loop() {
                 VERIFY_CORRECT_THREAD();
                 while (!_advertise_inventory_loop_done.canceled()) {
+                    // let transactions accumulate while they keep coming to send them in fewer, larger messages,
+                    // every new item wakes us up through trigger_advertise_inventory_loop()
+                    const fc::time_point flush_deadline = fc::time_point::now() +
+                                                          fc::milliseconds(GRAPHENE_NET_INVENTORY_FLUSH_INTERVAL_MS);
+                    while (_new_inventory.size() < GRAPHENE_NET_MAX_INVENTORY_ITEMS_PER_MESSAGE &&
+                           std::none_of(_new_inventory.begin(), _new_inventory.end(), [](const item_id &item) {
+                               return item.item_type == graphene::net::block_message_type;
+                           })) {
+                        fc::time_point now = fc::time_point::now();
+                        if (now >= flush_deadline) {
+                            break;
+                        }
+
+                        _retrigger_advertise_inventory_loop_promise = fc::promise<void>::ptr(new fc::promise<void>("graphene::net::retrigger_advertise_inventory_loop"));
+                        try {
+                            _retrigger_advertise_inventory_loop_promise->wait_until(std::min(flush_deadline,
+                                    now + fc::milliseconds(GRAPHENE_NET_INVENTORY_QUIET_PERIOD_MS)));
+                        } catch (const fc::timeout_exception &) {
+                            // nothing new for the quiet period, the inventory is complete for now
+                            _retrigger_advertise_inventory_loop_promise.reset();
+                            break;
+                        }
+                        _retrigger_advertise_inventory_loop_promise.reset();
+                    }
+
                     dlog("beginning an iteration of advertise inventory");
                     // swap inventory into local variable, clearing the node's copy
                     std::unordered_set<item_id> inventory_to_advertise;
@@ -1338,6 +1637,10 @@ namespace graphene {
                     // we're computing the messages)
                     std::list<std::pair<peer_connection_ptr, item_ids_inventory_message>> inventory_messages_to_send;
 
+                    for (const item_id &item_to_advertise : inventory_to_advertise) {
+                        _recently_advertised_inventory.insert(item_to_advertise);
+                    }
+
                     for (const peer_connection_ptr &peer : _active_connections) {
                         // only advertise to peers who are in sync with us
                         //wdump((peer->peer_needs_sync_items_from_us));
@@ -1349,17 +1652,9 @@ namespace graphene {
                             unsigned total_items_to_send_to_this_peer = 0;
                             //wdump((inventory_to_advertise));
                             for (const item_id &item_to_advertise : inventory_to_advertise) {
-                                //if (peer->inventory_advertised_to_peer.find(item_to_advertise) != peer->inventory_advertised_to_peer.end() )
-                                //   wdump((*peer->inventory_advertised_to_peer.find(item_to_advertise)));
-                                //if (peer->inventory_peer_advertised_to_us.find(item_to_advertise) != peer->inventory_peer_advertised_to_us.end() )
-                                //   wdump((*peer->inventory_peer_advertised_to_us.find(item_to_advertise)));
-
-                                if (peer->inventory_advertised_to_peer.find(item_to_advertise) ==
-                                    peer->inventory_advertised_to_peer.end() &&
-                                    peer->inventory_peer_advertised_to_us.find(item_to_advertise) ==
-                                    peer->inventory_peer_advertised_to_us.end()) {
+                                if (!peer->known_inventory.contains(item_to_advertise)) {
                                     items_to_advertise_by_type[item_to_advertise.item_type].push_back(item_to_advertise.item_hash);
-                                    peer->inventory_advertised_to_peer.insert(peer_connection::timestamped_item_id(item_to_advertise, fc::time_point::now()));
+                                    peer->known_inventory.insert(item_to_advertise);
                                     ++total_items_to_send_to_this_peer;
                                     if (item_to_advertise.item_type ==
                                         trx_message_type)
@@ -1371,8 +1666,15 @@ namespace graphene {
                                     ("count", total_items_to_send_to_this_peer)
                                             ("types", items_to_advertise_by_type.size())
                                             ("endpoint", peer->get_remote_endpoint()));
-                            for (auto items_group : items_to_advertise_by_type) {
-                                inventory_messages_to_send.push_back(std::make_pair(peer, item_ids_inventory_message(items_group.first, items_group.second)));
+                            for (const auto &items_group : items_to_advertise_by_type) {
+                                for (size_t first = 0; first < items_group.second.size();
+                                     first += GRAPHENE_NET_MAX_INVENTORY_ITEMS_PER_MESSAGE) {
+                                    auto begin = items_group.second.begin() + first;
+                                    auto end = items_group.second.begin() +
+                                               std::min<size_t>(items_group.second.size(), first + GRAPHENE_NET_MAX_INVENTORY_ITEMS_PER_MESSAGE);
+                                    inventory_messages_to_send.push_back(std::make_pair(peer,
+                                            item_ids_inventory_message(items_group.first, std::vector<item_hash_t>(begin, end))));
+                                }
                             }
                         }
                         peer->clear_old_inventory();
@@ -1394,7 +1696,7 @@ namespace graphene {
 
             void node_impl::trigger_advertise_inventory_loop() {
                 VERIFY_CORRECT_THREAD();
-                if (_retrigger_advertise_inventory_loop_promise) {
+                if (_retrigger_advertise_inventory_loop_promise && !_retrigger_advertise_inventory_loop_promise->ready()) {
                     _retrigger_advertise_inventory_loop_promise->set_value();
                 }
             }
@@ -1506,6 +1808,17 @@ namespace graphene {
                                                 ("synopsis", active_peer->item_ids_requested_from_peer->get<0>()));
                                 disconnect_due_to_request_timeout = true;
                             }
+                            // compact blocks whose request has timed out or has been answered by the full block
+                            for (auto iter = active_peer->compact_blocks_being_reconstructed.begin();
+                                 iter != active_peer->compact_blocks_being_reconstructed.end();) {
+                                if (iter->second.requested_time < active_ignored_request_threshold ||
+                                    active_peer->items_requested_from_peer.find(item_id(block_message_type, iter->first)) ==
+                                    active_peer->items_requested_from_peer.end()) {
+                                    iter = active_peer->compact_blocks_being_reconstructed.erase(iter);
+                                } else {
+                                    ++iter;
+                                }
+                            }
                             if (!disconnect_due_to_request_timeout) {
                                 for (const peer_connection::item_to_time_map_type::value_type &item_and_time : active_peer->items_requested_from_peer) {
                                     if (item_and_time.second <
@@ -1890,6 +2203,9 @@ namespace graphene {
                         ("type", graphene::net::core_message_type_enum(received_message.msg_type))("hash", message_hash)
                                 ("size", received_message.size)
                                 ("endpoint", originating_peer->get_remote_endpoint()));
+                const metric_labels type_labels{{"type", get_message_type_name(received_message.msg_type)}};
+                _metrics.increment("p2p_messages_received_total", type_labels);
+                _metrics.increment("p2p_bytes_received_total", type_labels, sizeof(message_header) + received_message.size);
                 switch (received_message.msg_type) {
                     case core_message_type_enum::hello_message_type:
                         on_hello_message(originating_peer, received_message.as<hello_message>());
@@ -1945,6 +2261,21 @@ namespace graphene {
                     case core_message_type_enum::get_current_connections_reply_message_type:
                         on_get_current_connections_reply_message(originating_peer, received_message.as<get_current_connections_reply_message>());
                         break;
+                    case core_message_type_enum::compact_block_message_type:
+                        on_compact_block_message(originating_peer, *received_message.as_shared<compact_block_message>());
+                        break;
+                    case core_message_type_enum::get_block_transactions_message_type:
+                        on_get_block_transactions_message(originating_peer, received_message.as<get_block_transactions_message>());
+                        break;
+                    case core_message_type_enum::block_transactions_message_type:
+                        on_block_transactions_message(originating_peer, *received_message.as_shared<block_transactions_message>());
+                        break;
+                    case core_message_type_enum::get_block_range_message_type:
+                        on_get_block_range_message(originating_peer, received_message.as<get_block_range_message>());
+                        break;
+                    case core_message_type_enum::block_range_message_type:
+                        on_block_range_message(originating_peer, *received_message.as_shared<block_range_message>());
+                        break;
 
                     default:
                         // ignore any message in between core_message_type_first and _last that we don't handle above
@@ -1992,6 +2323,8 @@ namespace graphene {
                 }
 
                 user_data["chain_id"] = STEEMIT_CHAIN_ID;
+                user_data["compact_blocks"] = true;
+                user_data["block_ranges"] = true;
 
                 return user_data;
             }
@@ -2026,6 +2359,12 @@ namespace graphene {
                 if (user_data.contains("chain_id")) {
                     originating_peer->chain_id = user_data["chain_id"].as<steemit::protocol::chain_id_type>();
                 }
+                if (user_data.contains("compact_blocks")) {
+                    originating_peer->supports_compact_blocks = user_data["compact_blocks"].as_bool();
+                }
+                if (user_data.contains("block_ranges")) {
+                    originating_peer->supports_block_ranges = user_data["block_ranges"].as_bool();
+                }
             }
 
             void node_impl::on_hello_message(peer_connection *originating_peer, const hello_message &hello_message_received) {
@@ -2829,6 +3168,11 @@ namespace graphene {
                 return item_not_available_message(item);
             }
 
+            fc::thread *node_impl::get_io_thread() {
+                VERIFY_CORRECT_THREAD();
+                return _io_threads.next_thread();
+            }
+
             void node_impl::on_fetch_items_message(peer_connection *originating_peer, const fetch_items_message &fetch_items_message_received) {
                 VERIFY_CORRECT_THREAD();
                 dlog("received items request for ids ${ids} of type ${type} from peer ${endpoint}",
@@ -2836,6 +3180,11 @@ namespace graphene {
                                 ("type", fetch_items_message_received.item_type)
                                 ("endpoint", originating_peer->get_remote_endpoint()));
 
+                if (fetch_items_message_received.item_type == compact_block_message_type) {
+                    send_compact_blocks(originating_peer, fetch_items_message_received.items_to_fetch);
+                    return;
+                }
+
                 fc::optional<message> last_block_message_sent;
 
                 std::list<message> reply_messages;
@@ -2893,6 +3242,375 @@ namespace graphene {
                 }
             }
 
+            void node_impl::send_compact_blocks(peer_connection *originating_peer, const std::vector<item_hash_t> &block_message_hashes) {
+                VERIFY_CORRECT_THREAD();
+                for (const item_hash_t &block_message_hash : block_message_hashes) {
+                    item_id block_item(block_message_type, block_message_hash);
+                    message requested_message = get_message_for_item(block_item);
+                    if (requested_message.msg_type != block_message_type) {
+                        originating_peer->send_message(requested_message);
+                        continue;
+                    }
+
+                    graphene::net::block_message full_block = requested_message.as<graphene::net::block_message>();
+                    originating_peer->last_block_delegate_has_seen = full_block.block_id;
+                    originating_peer->last_block_time_delegate_has_seen = full_block.block.timestamp;
+
+                    compact_block_message compact_block(full_block, block_message_hash);
+                    dlog("sending compact block ${id} with ${count} transactions to peer ${endpoint}",
+                            ("id", compact_block.block_id)
+                                    ("count", compact_block.short_transaction_ids.size())
+                                    ("endpoint", originating_peer->get_remote_endpoint()));
+                    originating_peer->send_message(compact_block);
+                }
+            }
+
+            void node_impl::on_compact_block_message(peer_connection *originating_peer,
+                    const compact_block_message &compact_block_message_received) {
+                VERIFY_CORRECT_THREAD();
+                const item_hash_t &block_message_hash = compact_block_message_received.block_message_hash;
+                if (originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_message_hash)) ==
+                    originating_peer->items_requested_from_peer.end()) {
+                    wlog("received a compact block ${id} I didn't ask for from peer ${endpoint}, ignoring it",
+                            ("id", compact_block_message_received.block_id)
+                                    ("endpoint", originating_peer->get_remote_endpoint()));
+                    return;
+                }
+
+                peer_connection::compact_block_reconstruction reconstruction;
+                reconstruction.compact_block = compact_block_message_received;
+                reconstruction.requested_time = fc::time_point::now();
+                reconstruction.transactions.resize(compact_block_message_received.short_transaction_ids.size());
+
+                // almost all transactions are in the message cache, the pending state of the
+                // client is only asked for the ones received more than a few blocks ago
+                fc::optional<std::unordered_map<uint64_t, signed_transaction>> pending_transactions;
+                std::vector<uint32_t> missing_transaction_indexes;
+                for (uint32_t i = 0; i < reconstruction.transactions.size(); ++i) {
+                    uint64_t short_id = compact_block_message_received.short_transaction_ids[i];
+                    reconstruction.transactions[i] = _message_cache.get_transaction(short_id);
+                    if (reconstruction.transactions[i]) {
+                        continue;
+                    }
+
+                    if (!pending_transactions) {
+                        pending_transactions = std::unordered_map<uint64_t, signed_transaction>();
+                        for (signed_transaction &trx : _delegate->get_pending_transactions()) {
+                            pending_transactions->emplace(compact_block_message::short_transaction_id(trx.id()), std::move(trx));
+                        }
+                    }
+
+                    auto pending_iter = pending_transactions->find(short_id);
+                    if (pending_iter != pending_transactions->end()) {
+                        reconstruction.transactions[i] = pending_iter->second;
+                    } else {
+                        missing_transaction_indexes.push_back(i);
+                    }
+                }
+
+                if (missing_transaction_indexes.empty()) {
+                    finish_compact_block(originating_peer, std::move(reconstruction));
+                    return;
+                }
+
+                dlog("requesting ${missing} of ${count} transactions of compact block ${id} from peer ${endpoint}",
+                        ("missing", missing_transaction_indexes.size())
+                                ("count", reconstruction.transactions.size())
+                                ("id", compact_block_message_received.block_id)
+                                ("endpoint", originating_peer->get_remote_endpoint()));
+                originating_peer->compact_blocks_being_reconstructed[block_message_hash] = std::move(reconstruction);
+                originating_peer->send_message(get_block_transactions_message(block_message_hash, missing_transaction_indexes));
+            }
+
+            void node_impl::on_get_block_transactions_message(peer_connection *originating_peer,
+                    const get_block_transactions_message &get_block_transactions_message_received) {
+                VERIFY_CORRECT_THREAD();
+                block_transactions_message reply(get_block_transactions_message_received.block_message_hash);
+
+                message requested_message = get_message_for_item(item_id(block_message_type, get_block_transactions_message_received.block_message_hash));
+                if (requested_message.msg_type == block_message_type) {
+                    graphene::net::block_message full_block = requested_message.as<graphene::net::block_message>();
+                    const auto &transactions = full_block.block.transactions;
+                    const auto &indexes = get_block_transactions_message_received.transaction_indexes;
+
+                    // a well-behaved peer asks only for the transactions it misses, each of them once and
+                    // in order, anything else only makes us serialize the block over and over
+                    bool valid_request = indexes.size() <= transactions.size();
+                    for (size_t i = 0; valid_request && i < indexes.size(); ++i) {
+                        valid_request = indexes[i] < transactions.size() && (i == 0 || indexes[i - 1] < indexes[i]);
+                    }
+                    if (!valid_request) {
+                        wlog("peer ${endpoint} requested invalid transaction indexes of block ${id}, disconnecting",
+                                ("endpoint", originating_peer->get_remote_endpoint())("id", full_block.block_id));
+                        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You requested duplicate or out of range transaction indexes of block ${id}",
+                                ("id", full_block.block_id)));
+                        disconnect_from_peer(originating_peer, "You requested invalid transaction indexes of a compact block", true, detailed_error);
+                        return;
+                    }
+
+                    reply.transactions.reserve(indexes.size());
+                    for (uint32_t index : indexes) {
+                        reply.transactions.push_back(transactions[index]);
+                    }
+                }
+
+                originating_peer->send_message(reply);
+            }
+
+            void node_impl::on_block_transactions_message(peer_connection *originating_peer,
+                    const block_transactions_message &block_transactions_message_received) {
+                VERIFY_CORRECT_THREAD();
+                const item_hash_t &block_message_hash = block_transactions_message_received.block_message_hash;
+                auto reconstruction_iter = originating_peer->compact_blocks_being_reconstructed.find(block_message_hash);
+                if (reconstruction_iter == originating_peer->compact_blocks_being_reconstructed.end()) {
+                    wlog("received transactions of a compact block I didn't ask for from peer ${endpoint}, ignoring them",
+                            ("endpoint", originating_peer->get_remote_endpoint()));
+                    return;
+                }
+
+                peer_connection::compact_block_reconstruction reconstruction = std::move(reconstruction_iter->second);
+                originating_peer->compact_blocks_being_reconstructed.erase(reconstruction_iter);
+
+                const auto &received_transactions = block_transactions_message_received.transactions;
+                size_t next_received = 0;
+                for (auto &trx : reconstruction.transactions) {
+                    if (!trx && next_received < received_transactions.size()) {
+                        trx = received_transactions[next_received++];
+                    }
+                }
+
+                bool complete = next_received == received_transactions.size() &&
+                                std::all_of(reconstruction.transactions.begin(), reconstruction.transactions.end(),
+                                        [](const fc::optional<signed_transaction> &trx) { return trx.valid(); });
+                if (!complete) {
+                    wlog("peer ${endpoint} didn't send the transactions of compact block ${id}, fetching the full block",
+                            ("endpoint", originating_peer->get_remote_endpoint())
+                                    ("id", reconstruction.compact_block.block_id));
+                    originating_peer->send_message(fetch_items_message(block_message_type, std::vector<item_hash_t>{block_message_hash}));
+                    return;
+                }
+
+                finish_compact_block(originating_peer, std::move(reconstruction));
+            }
+
+            void node_impl::finish_compact_block(peer_connection *originating_peer,
+                    peer_connection::compact_block_reconstruction &&reconstruction) {
+                VERIFY_CORRECT_THREAD();
+                const item_hash_t block_message_hash = reconstruction.compact_block.block_message_hash;
+                if (originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_message_hash)) ==
+                    originating_peer->items_requested_from_peer.end()) {
+                    // the request has timed out while we were waiting for the client
+                    dlog("compact block ${id} is not expected from peer ${endpoint} anymore",
+                            ("id", reconstruction.compact_block.block_id)
+                                    ("endpoint", originating_peer->get_remote_endpoint()));
+                    return;
+                }
+
+                std::vector<signed_transaction> transactions;
+                transactions.reserve(reconstruction.transactions.size());
+                for (auto &trx : reconstruction.transactions) {
+                    transactions.push_back(std::move(*trx));
+                }
+
+                // the rebuilt message must be exactly the one the peer has advertised, otherwise
+                // a short id collision or a wrong header gave us another block
+                message full_block_message(reconstruction.compact_block.to_block_message(std::move(transactions)));
+                if (full_block_message.id() != block_message_hash) {
+                    wlog("compact block ${id} from peer ${endpoint} doesn't match the advertised block, fetching the full block",
+                            ("id", reconstruction.compact_block.block_id)
+                                    ("endpoint", originating_peer->get_remote_endpoint()));
+                    originating_peer->send_message(fetch_items_message(block_message_type, std::vector<item_hash_t>{block_message_hash}));
+                    return;
+                }
+
+                process_block_message(originating_peer, full_block_message, block_message_hash);
+            }
+
+            void node_impl::on_get_block_range_message(peer_connection *originating_peer,
+                    const get_block_range_message &get_block_range_message_received) {
+                VERIFY_CORRECT_THREAD();
+                if (originating_peer->block_ranges_requested_by_peer.size() >= GRAPHENE_NET_MAX_BLOCK_RANGE_REQUESTS) {
+                    // an empty range makes the peer fetch these blocks one by one
+                    wlog("peer ${endpoint} has requested more than ${max} block ranges at once, sending an empty range",
+                            ("endpoint", originating_peer->get_remote_endpoint())("max", GRAPHENE_NET_MAX_BLOCK_RANGE_REQUESTS));
+                    originating_peer->send_message(block_range_message(get_block_range_message_received.first_block_id, true));
+                    return;
+                }
+
+                originating_peer->block_ranges_requested_by_peer.push_back(get_block_range_message_received);
+                if (!originating_peer->block_range_stream_done.valid() ||
+                    originating_peer->block_range_stream_done.ready()) {
+                    std::weak_ptr<peer_connection> weak_peer = originating_peer->shared_from_this();
+                    originating_peer->block_range_stream_done = fc::async([this, weak_peer]() { send_block_ranges_to_peer(weak_peer); }, "send_block_ranges_to_peer");
+                }
+            }
+
+            void node_impl::send_block_ranges_to_peer(std::weak_ptr<peer_connection> weak_peer) {
+                VERIFY_CORRECT_THREAD();
+                peer_connection_ptr peer = weak_peer.lock();
+                auto is_closing = [&]() {
+                    return !peer ||
+                           peer->negotiation_status == peer_connection::connection_negotiation_status::closing ||
+                           peer->negotiation_status == peer_connection::connection_negotiation_status::closed;
+                };
+                while (!is_closing() && !peer->block_ranges_requested_by_peer.empty()) {
+                    const get_block_range_message request = peer->block_ranges_requested_by_peer.front();
+                    const uint32_t first_block_number = _delegate->get_block_number(request.first_block_id);
+                    uint32_t next_block_number = first_block_number;
+                    uint32_t blocks_left = std::min<uint32_t>(request.block_count, GRAPHENE_NET_MAX_BLOCKS_PER_BLOCK_RANGE);
+                    try {
+                        while (blocks_left) {
+                            block_range_message frame(request.first_block_id);
+                            frame.packed_blocks = _delegate->get_packed_blocks(next_block_number, blocks_left, GRAPHENE_NET_BLOCK_RANGE_FRAME_BYTES);
+                            if (frame.packed_blocks.empty()) {
+                                break;
+                            }
+                            // the block log holds only our chain, a range starting on another fork ends right away
+                            if (next_block_number == first_block_number &&
+                                fc::raw::unpack<steemit::protocol::signed_block_header>(frame.packed_blocks.front()).id() !=
+                                request.first_block_id) {
+                                break;
+                            }
+
+                            size_t frame_size = 0;
+                            for (const std::vector<char> &packed_block : frame.packed_blocks) {
+                                frame_size += packed_block.size();
+                            }
+                            if (frame_size > GRAPHENE_NET_BLOCK_RANGE_MAX_QUEUED_BYTES) {
+                                // a single block too large for the fetch queue, sent on request as usual
+                                break;
+                            }
+
+                            // the next frame is queued once the connection has drained the previous ones
+                            while (peer->get_queued_messages_size(peer_connection::message_priority::block_fetch) + frame_size >
+                                   GRAPHENE_NET_BLOCK_RANGE_MAX_QUEUED_BYTES) {
+                                // a failed send closes the connection and leaves the queue as it is
+                                if (is_closing()) {
+                                    return;
+                                }
+
+                                fc::promise<void>::ptr frame_sent(new fc::promise<void>("graphene::net::block_range_frame_sent"));
+                                peer->block_range_frame_sent = frame_sent;
+                                peer.reset();
+                                try {
+                                    frame_sent->wait(fc::seconds(1));
+                                }
+                                catch (const fc::timeout_exception &) {
+                                    // other fetch replies may be in the way, check again
+                                }
+                                peer = weak_peer.lock();
+                                if (!peer) {
+                                    return;
+                                }
+                                peer->block_range_frame_sent.reset();
+                            }
+
+                            uint32_t block_count = (uint32_t)frame.packed_blocks.size();
+                            blocks_left -= block_count;
+                            next_block_number += block_count;
+                            frame.last_frame = blocks_left == 0;
+                            peer->send_message(frame);
+                            _metrics.increment("p2p_block_range_blocks_total", {{"direction", "sent"}}, block_count);
+                        }
+                    }
+                    catch (const fc::canceled_exception &) {
+                        throw;
+                    }
+                    catch (const fc::exception &e) {
+                        wlog("stopped streaming blocks from ${block_id} to peer ${endpoint}: ${e}",
+                                ("block_id", request.first_block_id)
+                                        ("endpoint", peer->get_remote_endpoint())("e", e));
+                    }
+
+                    try {
+                        if (blocks_left) {
+                            // our block log ends before the range does, the peer fetches the rest one by one
+                            peer->send_message(block_range_message(request.first_block_id, true));
+                        }
+                    }
+                    catch (const fc::exception &) {
+                        // the connection is being closed
+                        peer->block_ranges_requested_by_peer.clear();
+                        return;
+                    }
+                    peer->block_ranges_requested_by_peer.pop_front();
+                }
+            }
+
+            void node_impl::cancel_block_range_stream(peer_connection *peer) {
+                VERIFY_CORRECT_THREAD();
+                peer->block_ranges_requested_by_peer.clear();
+                if (!peer->block_range_stream_done.valid() || peer->block_range_stream_done.ready()) {
+                    return;
+                }
+                try {
+                    peer->block_range_stream_done.cancel_and_wait(__FUNCTION__);
+                }
+                catch (const fc::exception &e) {
+                    wlog("Exception thrown while canceling the block range stream, ignoring: ${e}", ("e", e));
+                }
+                catch (...) {
+                    wlog("Exception thrown while canceling the block range stream, ignoring");
+                }
+            }
+
+            void node_impl::on_block_range_message(peer_connection *originating_peer,
+                    const block_range_message &block_range_message_received) {
+                VERIFY_CORRECT_THREAD();
+                if (originating_peer->block_ranges_requested_from_peer.empty() ||
+                    originating_peer->block_ranges_requested_from_peer.front().front() !=
+                    block_range_message_received.first_block_id) {
+                    wlog("received a block range from ${block_id} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+                            ("block_id", block_range_message_received.first_block_id)
+                                    ("endpoint", originating_peer->get_remote_endpoint()));
+                    disconnect_from_peer(originating_peer, "You sent me a block range that I didn't ask for");
+                    return;
+                }
+
+                for (const std::vector<char> &packed_block : block_range_message_received.packed_blocks) {
+                    graphene::net::block_message block_message_to_process;
+                    try {
+                        block_message_to_process = graphene::net::block_message(fc::raw::unpack<signed_block>(packed_block));
+                    }
+                    catch (const fc::exception &e) {
+                        disconnect_from_peer(originating_peer, "You sent me a block range with a malformed block", true, e);
+                        return;
+                    }
+
+                    if (!process_sync_block_from_peer(originating_peer, block_message_to_process)) {
+                        wlog("received a block ${block_id} I didn't ask for in a block range from peer ${endpoint}, disconnecting from peer",
+                                ("endpoint", originating_peer->get_remote_endpoint())
+                                        ("block_id", block_message_to_process.block_id));
+                        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me a block that I didn't ask for, block_id: ${block_id}",
+                                ("block_id", block_message_to_process.block_id)));
+                        disconnect_from_peer(originating_peer, "You sent me a block that I didn't ask for", true, detailed_error);
+                        return;
+                    }
+                }
+                if (!block_range_message_received.packed_blocks.empty()) {
+                    uint32_t block_count = (uint32_t)block_range_message_received.packed_blocks.size();
+                    originating_peer->record_sync_item_received(block_count);
+                    _metrics.increment("p2p_block_range_blocks_total", {{"direction", "received"}}, block_count);
+                }
+
+                if (!block_range_message_received.last_frame) {
+                    return;
+                }
+
+                // blocks the peer's block log didn't have are fetched one by one from now on
+                std::vector<item_hash_t> requested_blocks = std::move(originating_peer->block_ranges_requested_from_peer.front());
+                originating_peer->block_ranges_requested_from_peer.pop_front();
+                for (const item_hash_t &block_id : requested_blocks) {
+                    originating_peer->sync_items_reassigned_from_peer.erase(block_id);
+                    if (originating_peer->sync_items_requested_from_peer.erase(block_id)) {
+                        _active_sync_requests.erase(block_id);
+                        originating_peer->block_range_limit = std::min(originating_peer->block_range_limit,
+                                _delegate->get_block_number(block_id));
+                    }
+                }
+                trigger_fetch_sync_items_loop();
+            }
+
             void node_impl::on_item_not_available_message(peer_connection *originating_peer, const item_not_available_message &item_not_available_message_received) {
                 VERIFY_CORRECT_THREAD();
                 const item_id &requested_item = item_not_available_message_received.requested_item;
@@ -2951,17 +3669,21 @@ namespace graphene {
                             continue;
                     }
 
-                    bool we_advertised_this_item_to_a_peer = false;
+                    // the peer knows this item, no need to tell it about the item later
+                    originating_peer->known_inventory.insert(advertised_item_id);
+
+                    // the filter only rules items out quickly, a false positive must not make us miss
+                    // a block or a transaction, so hits are confirmed in the message cache
+                    bool we_advertised_this_item_to_a_peer = _recently_advertised_inventory.contains(advertised_item_id) &&
+                                                             _message_cache.has_message(item_hash);
                     bool we_requested_this_item_from_a_peer = false;
-                    for (const peer_connection_ptr peer : _active_connections) {
-                        if (peer->inventory_advertised_to_peer.find(advertised_item_id) !=
-                            peer->inventory_advertised_to_peer.end()) {
-                            we_advertised_this_item_to_a_peer = true;
-                            break;
-                        }
-                        if (peer->items_requested_from_peer.find(advertised_item_id) !=
-                            peer->items_requested_from_peer.end()) {
+                    if (!we_advertised_this_item_to_a_peer) {
+                        for (const peer_connection_ptr &peer : _active_connections) {
+                            if (peer->items_requested_from_peer.find(advertised_item_id) !=
+                                peer->items_requested_from_peer.end()) {
                                 we_requested_this_item_from_a_peer = true;
+                                break;
+                            }
                         }
                     }
 
@@ -3039,6 +3761,7 @@ namespace graphene {
                 VERIFY_CORRECT_THREAD();
                 peer_connection_ptr originating_peer_ptr = originating_peer->shared_from_this();
                 _rate_limiter.remove_tcp_socket(&originating_peer->get_socket());
+                cancel_block_range_stream(originating_peer);
 
                 // if we closed the connection (due to timeout or handshake failure), we should have recorded an
                 // error message to store in the peer database when we closed the connection
@@ -3064,6 +3787,8 @@ namespace graphene {
                         fc::optional<potential_peer_record> updated_peer_record = _potential_peer_db.lookup_entry_for_endpoint(*inbound_endpoint);
                         if (updated_peer_record) {
                             updated_peer_record->last_seen_time = fc::time_point::now();
+                            updated_peer_record->record_connection_quality(originating_peer_ptr->round_trip_delay,
+                                    originating_peer_ptr->average_sync_block_interval);
                             _potential_peer_db.update_entry(*updated_peer_record);
                         }
                     }
@@ -3412,10 +4137,16 @@ namespace graphene {
             }
 
             void node_impl::process_block_during_sync(peer_connection *originating_peer,
-                    const graphene::net::block_message &block_message_to_process, const message_hash_type &message_hash) {
+                    const graphene::net::block_message &block_message_to_process) {
                 VERIFY_CORRECT_THREAD();
                 dlog("received a sync block from peer ${endpoint}", ("endpoint", originating_peer->get_remote_endpoint()));
 
+                if (have_already_received_sync_item(block_message_to_process.block_id)) {
+                    dlog("sync block ${block_id} is already waiting in the backlog, ignoring the duplicate",
+                            ("block_id", block_message_to_process.block_id));
+                    return;
+                }
+
                 // add it to the front of _received_sync_items, then process _received_sync_items to try to
                 // pass as many messages as possible to the client.
                 _new_received_sync_items.push_front(block_message_to_process);
@@ -3453,6 +4184,10 @@ namespace graphene {
                         _delegate->handle_block(block_message_to_process, false, contained_transaction_message_ids);
                         _message_ids_currently_being_processed.erase(message_hash);
                         message_validated_time = fc::time_point::now();
+                        _metrics.observe("p2p_block_receive_delay_seconds", metric_labels(),
+                                (message_receive_time - fc::time_point(block_message_to_process.block.timestamp)).count() / 1000000.0);
+                        _metrics.observe("p2p_block_validation_seconds", metric_labels(),
+                                (message_validated_time - message_receive_time).count() / 1000000.0);
                         ilog("Successfully pushed block ${num} (id:${id})",
                                 ("num", block_message_to_process.block.block_num())
                                         ("id", block_message_to_process.block_id));
@@ -3504,6 +4239,8 @@ namespace graphene {
                             peer->last_block_time_delegate_has_seen = block_time;
                         }
                         peer->clear_old_inventory();
+                        // the block is ours now, transactions still requested for it are not needed
+                        peer->compact_blocks_being_reconstructed.erase(message_hash);
                     }
                     message_propagation_data propagation_data{
                             message_receive_time, message_validated_time,
@@ -3577,6 +4314,49 @@ namespace graphene {
                 }
             }
 
+            bool node_impl::process_sync_block_from_peer(peer_connection *originating_peer,
+                    const graphene::net::block_message &block_message_to_process) {
+                VERIFY_CORRECT_THREAD();
+                auto sync_item_iter = originating_peer->sync_items_requested_from_peer.find(block_message_to_process.block_id);
+                if (sync_item_iter !=
+                    originating_peer->sync_items_requested_from_peer.end()) {
+                    originating_peer->sync_items_requested_from_peer.erase(sync_item_iter);
+                    _active_sync_requests.erase(block_message_to_process.block_id);
+                    process_block_during_sync(originating_peer, block_message_to_process);
+                    if (originating_peer->sync_items_requested_from_peer.size() <=
+                        get_sync_range_size(originating_peer->shared_from_this()) / 2) {
+                        // half of the range is here, time to schedule the next one
+                        trigger_fetch_sync_items_loop();
+                    }
+                    if (originating_peer->idle()) {
+                        // we have finished fetching a batch of items, so we either need to grab another batch of items
+                        // or we need to get another list of item ids.
+                        if (originating_peer->number_of_unfetched_item_ids >
+                            0 &&
+                            originating_peer->ids_of_items_to_get.size() <
+                            GRAPHENE_NET_MIN_BLOCK_IDS_TO_PREFETCH) {
+                                fetch_next_batch_of_item_ids_from_peer(originating_peer);
+                        } else {
+                                trigger_fetch_sync_items_loop();
+                        }
+                    }
+                    return true;
+                }
+
+                // a late answer to a request we've already passed to a faster peer
+                auto reassigned_item_iter = originating_peer->sync_items_reassigned_from_peer.find(block_message_to_process.block_id);
+                if (reassigned_item_iter !=
+                    originating_peer->sync_items_reassigned_from_peer.end()) {
+                    originating_peer->sync_items_reassigned_from_peer.erase(reassigned_item_iter);
+                    dlog("received reassigned sync block ${block_id} from peer ${endpoint}, ignoring it",
+                            ("block_id", block_message_to_process.block_id)
+                                    ("endpoint", originating_peer->get_remote_endpoint()));
+                    trigger_fetch_sync_items_loop();
+                    return true;
+                }
+                return false;
+            }
+
             void node_impl::process_block_message(peer_connection *originating_peer,
                     const message &message_to_process,
                     const message_hash_type &message_hash) {
@@ -3585,7 +4365,10 @@ namespace graphene {
                 // (it's possible that we request an item during normal operation and then get kicked into sync
                 // mode before we receive and process the item.  In that case, we should process the item as a normal
                 // item to avoid confusing the sync code)
-                graphene::net::block_message block_message_to_process(message_to_process.as<graphene::net::block_message>());
+                // usually unpacked by the connection I/O thread already
+                auto block_message_ptr = message_to_process.as_shared<graphene::net::block_message>();
+                const graphene::net::block_message &block_message_to_process = *block_message_ptr;
+                originating_peer->compact_blocks_being_reconstructed.erase(message_hash);
                 auto item_iter = originating_peer->items_requested_from_peer.find(item_id(graphene::net::block_message_type, message_hash));
                 if (item_iter !=
                     originating_peer->items_requested_from_peer.end()) {
@@ -3595,29 +4378,10 @@ namespace graphene {
                         trigger_fetch_items_loop();
                     }
                     return;
-                } else {
-                    // not during normal operation.  see if we requested it during sync
-                    auto sync_item_iter = originating_peer->sync_items_requested_from_peer.find(block_message_to_process.block_id);
-                    if (sync_item_iter !=
-                        originating_peer->sync_items_requested_from_peer.end()) {
-                        originating_peer->sync_items_requested_from_peer.erase(sync_item_iter);
-                        originating_peer->last_sync_item_received_time = fc::time_point::now();
-                        _active_sync_requests.erase(block_message_to_process.block_id);
-                        process_block_during_sync(originating_peer, block_message_to_process, message_hash);
-                        if (originating_peer->idle()) {
-                            // we have finished fetching a batch of items, so we either need to grab another batch of items
-                            // or we need to get another list of item ids.
-                            if (originating_peer->number_of_unfetched_item_ids >
-                                0 &&
-                                originating_peer->ids_of_items_to_get.size() <
-                                GRAPHENE_NET_MIN_BLOCK_IDS_TO_PREFETCH) {
-                                    fetch_next_batch_of_item_ids_from_peer(originating_peer);
-                            } else {
-                                    trigger_fetch_sync_items_loop();
-                            }
-                        }
-                        return;
-                    }
+                } else if (process_sync_block_from_peer(originating_peer, block_message_to_process)) {
+                    // not during normal operation, we requested it during sync
+                    originating_peer->record_sync_item_received();
+                    return;
                 }
 
                 // if we get here, we didn't request the message, we must have a misbehaving peer
@@ -3655,6 +4419,7 @@ namespace graphene {
                                                       current_time_reply_message_received.request_sent_time) -
                                                      (current_time_reply_message_received.reply_transmitted_time -
                                                       current_time_reply_message_received.request_received_time);
+                _metrics.observe("p2p_peer_round_trip_seconds", metric_labels(), originating_peer->round_trip_delay.count() / 1000000.0);
             }
 
             void node_impl::forward_firewall_check_to_next_available_peer(firewall_check_state_data *firewall_check_state) {
@@ -3929,7 +4694,8 @@ namespace graphene {
                     fc::time_point message_validated_time;
                     try {
                         if (message_to_process.msg_type == trx_message_type) {
-                            trx_message transaction_message_to_process = message_to_process.as<trx_message>();
+                            auto transaction_message_ptr = message_to_process.as_shared<trx_message>();
+                            const trx_message &transaction_message_to_process = *transaction_message_ptr;
                             dlog("passing message containing transaction ${trx} to client", ("trx", transaction_message_to_process.trx.id()));
                             _delegate->handle_transaction(transaction_message_to_process);
                         } else {
@@ -3961,6 +4727,7 @@ namespace graphene {
                 peer->ids_of_items_to_get.clear();
                 peer->number_of_unfetched_item_ids = 0;
                 peer->we_need_sync_items_from_peer = true;
+                peer->block_range_limit = std::numeric_limits<uint32_t>::max();
                 peer->last_block_delegate_has_seen = item_hash_t();
                 peer->last_block_time_delegate_has_seen = _delegate->get_block_time(item_hash_t());
                 peer->inhibit_fetching_sync_blocks = false;
@@ -4142,6 +4909,7 @@ namespace graphene {
                 boost::push_back(all_peers, _closing_connections);
 
                 for (const peer_connection_ptr &peer : all_peers) {
+                    cancel_block_range_stream(peer.get());
                     try {
                         peer->destroy_connection();
                     }
@@ -4414,7 +5182,7 @@ namespace graphene {
                 VERIFY_CORRECT_THREAD();
                 _delegate.reset();
                 if (del) {
-                    _delegate.reset(new statistics_gathering_node_delegate_wrapper(del, thread_for_delegate_calls));
+                    _delegate.reset(new statistics_gathering_node_delegate_wrapper(del, thread_for_delegate_calls, &_metrics));
                 }
             }
 
@@ -4714,41 +5482,162 @@ namespace graphene {
 
             void node_impl::dump_node_status() {
                 VERIFY_CORRECT_THREAD();
+                // only the summary goes to the log by default, the rest is exported by get_metrics()
                 ilog("----------------- PEER STATUS UPDATE --------------------");
                 ilog(" number of peers: ${active} active, ${handshaking}, ${closing} closing.  attempting to maintain ${desired} - ${maximum} peers",
                         ("active", _active_connections.size())("handshaking", _handshaking_connections.size())("closing", _closing_connections.size())
                                 ("desired", _desired_number_of_connections)("maximum", _maximum_number_of_connections));
                 for (const peer_connection_ptr &peer : _active_connections) {
-                    ilog("       active peer ${endpoint} peer_is_in_sync_with_us:${in_sync_with_us} we_are_in_sync_with_peer:${in_sync_with_them}",
+                    dlog("       active peer ${endpoint} peer_is_in_sync_with_us:${in_sync_with_us} we_are_in_sync_with_peer:${in_sync_with_them}",
                             ("endpoint", peer->get_remote_endpoint())
                                     ("in_sync_with_us", !peer->peer_needs_sync_items_from_us)("in_sync_with_them", !peer->we_need_sync_items_from_peer));
                     if (peer->we_need_sync_items_from_peer)
-                        ilog("              above peer has ${count} sync items we might need", ("count", peer->ids_of_items_to_get.size()));
+                        dlog("              above peer has ${count} sync items we might need", ("count", peer->ids_of_items_to_get.size()));
                     if (peer->inhibit_fetching_sync_blocks)
-                        ilog("              we are not fetching sync blocks from the above peer (inhibit_fetching_sync_blocks == true)");
+                        dlog("              we are not fetching sync blocks from the above peer (inhibit_fetching_sync_blocks == true)");
 
                 }
                 for (const peer_connection_ptr &peer : _handshaking_connections) {
-                    ilog("  handshaking peer ${endpoint} in state ours(${our_state}) theirs(${their_state})",
+                    dlog("  handshaking peer ${endpoint} in state ours(${our_state}) theirs(${their_state})",
                             ("endpoint", peer->get_remote_endpoint())("our_state", peer->our_state)("their_state", peer->their_state));
                 }
 
-                ilog("--------- MEMORY USAGE ------------");
-                ilog("node._active_sync_requests size: ${size}", ("size", _active_sync_requests.size()));
-                ilog("node._received_sync_items size: ${size}", ("size", _received_sync_items.size()));
-                ilog("node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size()));
-                ilog("node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size()));
-                ilog("node._new_inventory size: ${size}", ("size", _new_inventory.size()));
-                ilog("node._message_cache size: ${size}", ("size", _message_cache.size()));
+                dlog("--------- MEMORY USAGE ------------");
+                dlog("node._active_sync_requests size: ${size}", ("size", _active_sync_requests.size()));
+                dlog("node._received_sync_items size: ${size}", ("size", _received_sync_items.size()));
+                dlog("node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size()));
+                dlog("node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size()));
+                dlog("node._new_inventory size: ${size}", ("size", _new_inventory.size()));
+                dlog("node._message_cache size: ${size}", ("size", _message_cache.size()));
                 for (const peer_connection_ptr &peer : _active_connections) {
-                    ilog("  peer ${endpoint}", ("endpoint", peer->get_remote_endpoint()));
-                    ilog("    peer.ids_of_items_to_get size: ${size}", ("size", peer->ids_of_items_to_get.size()));
-                    ilog("    peer.inventory_peer_advertised_to_us size: ${size}", ("size", peer->inventory_peer_advertised_to_us.size()));
-                    ilog("    peer.inventory_advertised_to_peer size: ${size}", ("size", peer->inventory_advertised_to_peer.size()));
-                    ilog("    peer.items_requested_from_peer size: ${size}", ("size", peer->items_requested_from_peer.size()));
-                    ilog("    peer.sync_items_requested_from_peer size: ${size}", ("size", peer->sync_items_requested_from_peer.size()));
+                    dlog("  peer ${endpoint}", ("endpoint", peer->get_remote_endpoint()));
+                    dlog("    peer.ids_of_items_to_get size: ${size}", ("size", peer->ids_of_items_to_get.size()));
+                    dlog("    peer.inventory_peer_advertised_to_us size: ${size}", ("size", peer->inventory_peer_advertised_to_us.size()));
+                    dlog("    peer.known_inventory size: ${size} (${bytes} bytes)",
+                            ("size", peer->known_inventory.size())("bytes", peer->known_inventory.memory_usage()));
+                    dlog("    peer.items_requested_from_peer size: ${size}", ("size", peer->items_requested_from_peer.size()));
+                    dlog("    peer.sync_items_requested_from_peer size: ${size}", ("size", peer->sync_items_requested_from_peer.size()));
+                }
+                dlog("--------- END MEMORY USAGE ------------");
+            }
+
+            void node_impl::describe_metrics() {
+                const std::vector<double> latency_buckets{0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+                const std::vector<double> block_delay_buckets{0.1, 0.25, 0.5, 1, 1.5, 2, 3, 5, 10, 30};
+
+                _metrics.describe("p2p_messages_received_total", counter_metric, "Messages received from peers by type");
+                _metrics.describe("p2p_bytes_received_total", counter_metric, "Bytes of messages received from peers by type");
+                _metrics.describe("p2p_messages_sent_total", counter_metric, "Messages sent to peers by type");
+                _metrics.describe("p2p_bytes_sent_total", counter_metric, "Bytes of messages sent to peers by type");
+                _metrics.describe("p2p_delegate_call_seconds", histogram_metric, "Duration of calls to the blockchain including the wait for its thread", latency_buckets);
+                _metrics.describe("p2p_peer_round_trip_seconds", histogram_metric, "Round trip delays measured by time requests", latency_buckets);
+                _metrics.describe("p2p_block_receive_delay_seconds", histogram_metric, "Delay between the block timestamp and receiving it outside of sync", block_delay_buckets);
+                _metrics.describe("p2p_block_validation_seconds", histogram_metric, "Time from receiving a block outside of sync to its acceptance", latency_buckets);
+                _metrics.describe("p2p_block_range_blocks_total", counter_metric, "Sync blocks streamed in block ranges by direction");
+                _metrics.describe("p2p_connections", gauge_metric, "Connections by state");
+                _metrics.describe("p2p_peer_round_trip_delay_seconds", gauge_metric, "Last measured round trip delay of active peers");
+                _metrics.describe("p2p_peer_send_queue_bytes", gauge_metric, "Bytes waiting in the send queues of active peers");
+                _metrics.describe("p2p_send_queue_bytes", gauge_metric, "Bytes waiting in the send queues of all active peers by priority class");
+                _metrics.describe("p2p_send_queue_dropped_messages_total", counter_metric, "Messages dropped from the send queues of peers by priority class");
+                _metrics.describe("p2p_sync_backlog_blocks", gauge_metric, "Blocks peers have offered during sync which we haven't fetched yet");
+                _metrics.describe("p2p_sync_requests_active", gauge_metric, "Sync blocks requested from peers and not received yet");
+                _metrics.describe("p2p_sync_blocks_pending", gauge_metric, "Sync blocks received and not pushed to the blockchain yet");
+                _metrics.describe("p2p_items_to_fetch", gauge_metric, "Advertised blocks and transactions waiting to be fetched");
+                _metrics.describe("p2p_inventory_to_advertise", gauge_metric, "Items waiting to be advertised to peers");
+                _metrics.describe("p2p_message_cache_size", gauge_metric, "Messages cached for serving peers");
+                _metrics.describe("p2p_network_bytes_per_second", gauge_metric, "Average bandwidth over the last minute by direction");
+            }
+
+            const std::string &node_impl::get_message_type_name(uint32_t msg_type) {
+                auto itr = _message_type_names.find(msg_type);
+                if (itr == _message_type_names.end()) {
+                    std::string name;
+                    try {
+                        name = fc::reflector<core_message_type_enum>::to_string(core_message_type_enum(msg_type));
+                    } catch (...) {
+                        name = fc::to_string(uint64_t(msg_type));
+                    }
+                    itr = _message_type_names.emplace(msg_type, name).first;
                 }
-                ilog("--------- END MEMORY USAGE ------------");
+                return itr->second;
+            }
+
+            void node_impl::on_message_sent(peer_connection *destination_peer, const message &sent_message) {
+                VERIFY_CORRECT_THREAD();
+                const metric_labels type_labels{{"type", get_message_type_name(sent_message.msg_type)}};
+                _metrics.increment("p2p_messages_sent_total", type_labels);
+                _metrics.increment("p2p_bytes_sent_total", type_labels, sizeof(message_header) + sent_message.size);
+
+                if (sent_message.msg_type == core_message_type_enum::block_range_message_type &&
+                    destination_peer->block_range_frame_sent &&
+                    !destination_peer->block_range_frame_sent->ready()) {
+                    destination_peer->block_range_frame_sent->set_value();
+                }
+            }
+
+            void node_impl::on_message_dropped(peer_connection *destination_peer, const item_id &dropped_item) {
+                VERIFY_CORRECT_THREAD();
+                _metrics.increment("p2p_send_queue_dropped_messages_total",
+                        {{"class", get_send_queue_class_name(peer_connection::get_priority_of_type(dropped_item.item_type))}});
+            }
+
+            const char *node_impl::get_send_queue_class_name(peer_connection::message_priority priority) {
+                static const char *send_queue_class_names[] = {"block", "block_fetch", "request_reply", "inventory", "transaction"};
+                static_assert(sizeof(send_queue_class_names) / sizeof(send_queue_class_names[0]) ==
+                              size_t(peer_connection::message_priority::count), "every send queue class needs a name");
+                return send_queue_class_names[size_t(priority)];
+            }
+
+            void node_impl::collect_metrics() {
+                VERIFY_CORRECT_THREAD();
+                _metrics.set("p2p_connections", {{"state", "active"}}, _active_connections.size());
+                _metrics.set("p2p_connections", {{"state", "handshaking"}}, _handshaking_connections.size());
+                _metrics.set("p2p_connections", {{"state", "closing"}}, _closing_connections.size());
+                _metrics.set("p2p_connections", {{"state", "terminating"}}, _terminating_connections.size());
+
+                _metrics.clear("p2p_peer_round_trip_delay_seconds");
+                _metrics.clear("p2p_peer_send_queue_bytes");
+                std::vector<size_t> send_queue_bytes(size_t(peer_connection::message_priority::count));
+                for (const peer_connection_ptr &peer : _active_connections) {
+                    ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
+
+                    fc::optional<fc::ip::endpoint> endpoint = peer->get_remote_endpoint();
+                    const metric_labels peer_labels{{"peer", endpoint ? std::string(*endpoint) : std::string("unknown")}};
+                    _metrics.set("p2p_peer_round_trip_delay_seconds", peer_labels, peer->round_trip_delay.count() / 1000000.0);
+                    _metrics.set("p2p_peer_send_queue_bytes", peer_labels, peer->get_total_queued_messages_size());
+
+                    for (size_t i = 0; i < send_queue_bytes.size(); ++i) {
+                        send_queue_bytes[i] += peer->get_queued_messages_size(peer_connection::message_priority(i));
+                    }
+                }
+                for (size_t i = 0; i < send_queue_bytes.size(); ++i) {
+                    _metrics.set("p2p_send_queue_bytes", {{"class", get_send_queue_class_name(peer_connection::message_priority(i))}}, send_queue_bytes[i]);
+                }
+
+                _metrics.set("p2p_sync_backlog_blocks", calculate_unsynced_block_count_from_all_peers());
+                _metrics.set("p2p_sync_requests_active", _active_sync_requests.size());
+                _metrics.set("p2p_sync_blocks_pending", _received_sync_items.size() + _new_received_sync_items.size());
+                _metrics.set("p2p_items_to_fetch", _items_to_fetch.size());
+                _metrics.set("p2p_inventory_to_advertise", _new_inventory.size());
+                _metrics.set("p2p_message_cache_size", _message_cache.size());
+
+                auto average = [](const boost::circular_buffer<uint32_t> &speeds) {
+                    return speeds.empty() ? 0.0 : double(std::accumulate(speeds.begin(), speeds.end(), uint64_t(0))) / speeds.size();
+                };
+                _metrics.set("p2p_network_bytes_per_second", {{"direction", "read"}}, average(_average_network_read_speed_seconds));
+                _metrics.set("p2p_network_bytes_per_second", {{"direction", "write"}}, average(_average_network_write_speed_seconds));
+            }
+
+            fc::variant node_impl::get_metrics() {
+                VERIFY_CORRECT_THREAD();
+                collect_metrics();
+                return _metrics.to_variant();
+            }
+
+            std::string node_impl::get_metrics_text() {
+                VERIFY_CORRECT_THREAD();
+                collect_metrics();
+                return _metrics.to_text();
             }
 
             void node_impl::disconnect_from_peer(peer_connection *peer_to_disconnect,
@@ -4768,6 +5657,9 @@ namespace graphene {
                         fc::optional<potential_peer_record> updated_peer_record = _potential_peer_db.lookup_entry_for_endpoint(*inbound_endpoint);
                         if (updated_peer_record) {
                             updated_peer_record->last_seen_time = fc::time_point::now();
+                            if (caused_by_error) {
+                                ++updated_peer_record->number_of_connection_errors;
+                            }
                             if (error) {
                                 updated_peer_record->last_error = error;
                             } else {
@@ -4980,6 +5872,9 @@ namespace graphene {
                 if (params.contains("maximum_blocks_per_peer_during_syncing")) {
                     _maximum_blocks_per_peer_during_syncing = params["maximum_blocks_per_peer_during_syncing"].as<uint32_t>();
                 }
+                if (params.contains("io_thread_count")) {
+                    _io_threads.set_thread_count(params["io_thread_count"].as<uint32_t>());
+                }
 
                 _desired_number_of_connections = std::min(_desired_number_of_connections, _maximum_number_of_connections);
 
@@ -5000,6 +5895,7 @@ namespace graphene {
                 result["maximum_number_of_blocks_to_handle_at_one_time"] = _maximum_number_of_blocks_to_handle_at_one_time;
                 result["maximum_number_of_sync_blocks_to_prefetch"] = _maximum_number_of_sync_blocks_to_prefetch;
                 result["maximum_blocks_per_peer_during_syncing"] = _maximum_blocks_per_peer_during_syncing;
+                result["io_thread_count"] = _io_threads.size();
                 return result;
             }
 
@@ -5245,6 +6141,14 @@ namespace graphene {
             INVOKE_IN_IMPL(network_get_usage_stats);
         }
 
+        fc::variant node::get_metrics() const {
+            INVOKE_IN_IMPL(get_metrics);
+        }
+
+        std::string node::get_metrics_text() const {
+            INVOKE_IN_IMPL(get_metrics_text);
+        }
+
         void node::close() {
             INVOKE_IN_IMPL(close);
         }
@@ -5308,10 +6212,11 @@ namespace graphene {
       , BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _delay_after_accumulator))(boost::accumulators::tag::rolling_window::window_size = ROLLING_WINDOW_SIZE)
 
 
-            statistics_gathering_node_delegate_wrapper::statistics_gathering_node_delegate_wrapper(node_delegate *delegate, fc::thread *thread_for_delegate_calls)
+            statistics_gathering_node_delegate_wrapper::statistics_gathering_node_delegate_wrapper(node_delegate *delegate, fc::thread *thread_for_delegate_calls, metrics_registry *metrics)
                     :
                     _node_delegate(delegate),
-                    _thread(thread_for_delegate_calls)
+                    _thread(thread_for_delegate_calls),
+                    _metrics(metrics)
                     BOOST_PP_SEQ_FOR_EACH(INITIALIZE_ACCUMULATOR, unused, NODE_DELEGATE_METHOD_NAMES) {
             }
 
@@ -5354,7 +6259,7 @@ namespace graphene {
                                                                                                                                     #  define INVOKE_AND_COLLECT_STATISTICS(method_name, ...) \
     try \
     { \
-      call_statistics_collector statistics_collector(#method_name, \
+      call_statistics_collector statistics_collector(#method_name, _metrics, \
                                                      &_ ## method_name ## _execution_accumulator, \
                                                      &_ ## method_name ## _delay_before_accumulator, \
                                                      &_ ## method_name ## _delay_after_accumulator); \
@@ -5386,7 +6291,7 @@ namespace graphene {
     }
 #else
 #  define INVOKE_AND_COLLECT_STATISTICS(method_name, ...) \
-    call_statistics_collector statistics_collector(#method_name, \
+    call_statistics_collector statistics_collector(#method_name, _metrics, \
                                                    &_ ## method_name ## _execution_accumulator, \
                                                    &_ ## method_name ## _delay_before_accumulator, \
                                                    &_ ## method_name ## _delay_after_accumulator); \
@@ -5428,6 +6333,14 @@ namespace graphene {
                 INVOKE_AND_COLLECT_STATISTICS(get_item, id);
             }
 
+            std::vector<signed_transaction> statistics_gathering_node_delegate_wrapper::get_pending_transactions() {
+                INVOKE_AND_COLLECT_STATISTICS(get_pending_transactions);
+            }
+
+            std::vector<std::vector<char>> statistics_gathering_node_delegate_wrapper::get_packed_blocks(uint32_t first_block_num, uint32_t limit, uint32_t max_bytes) {
+                INVOKE_AND_COLLECT_STATISTICS(get_packed_blocks, first_block_num, limit, max_bytes);
+            }
+
             std::vector<item_hash_t> statistics_gathering_node_delegate_wrapper::get_blockchain_synopsis(const item_hash_t &reference_point, uint32_t number_of_blocks_after_reference_point) {
                 INVOKE_AND_COLLECT_STATISTICS(get_blockchain_synopsis, reference_point, number_of_blocks_after_reference_point);
             }
@@ -25,6 +25,9 @@
 
 #include <fc/thread/thread.hpp>
 
+#include <algorithm>
+#include <limits>
+
 #ifdef DEFAULT_LOGGER
 # undef DEFAULT_LOGGER
 #endif
@@ -57,6 +60,41 @@ namespace graphene {
             return message_to_send.data.size();
         }
 
+        peer_connection::message_priority peer_connection::get_priority_of_type(uint32_t msg_type) {
+            switch (msg_type) {
+                case block_message_type:
+                case compact_block_message_type:
+                case get_block_transactions_message_type:
+                case block_transactions_message_type:
+                case hello_message_type:
+                case connection_accepted_message_type:
+                case connection_rejected_message_type:
+                case closing_connection_message_type:
+                    return message_priority::block;
+                case fetch_blockchain_item_ids_message_type:
+                case blockchain_item_ids_inventory_message_type:
+                case fetch_items_message_type:
+                case item_not_available_message_type:
+                case get_block_range_message_type:
+                case block_range_message_type:
+                    return message_priority::block_fetch;
+                case item_ids_inventory_message_type:
+                    return message_priority::inventory;
+                case trx_message_type:
+                    return message_priority::transaction;
+                default:
+                    return message_priority::request_reply;
+            }
+        }
+
+        peer_connection::message_priority peer_connection::real_queued_message::get_priority() {
+            return get_priority_of_type(message_to_send.msg_type);
+        }
+
+        item_id peer_connection::real_queued_message::get_item_id() {
+            return item_id(message_to_send.msg_type, message_to_send.id());
+        }
+
         message peer_connection::virtual_queued_message::get_message(peer_connection_delegate *node) {
             return node->get_message_for_item(item_to_send);
         }
@@ -65,10 +103,18 @@ namespace graphene {
             return sizeof(item_id);
         }
 
+        peer_connection::message_priority peer_connection::virtual_queued_message::get_priority() {
+            return get_priority_of_type(item_to_send.item_type);
+        }
+
+        item_id peer_connection::virtual_queued_message::get_item_id() {
+            return item_to_send;
+        }
+
         peer_connection::peer_connection(peer_connection_delegate *delegate) :
                 _node(delegate),
-                _message_connection(this),
-                _total_queued_messages_size(0),
+                _message_connection(this, delegate->get_io_thread()),
+                _number_of_dropped_messages(0),
                 direction(peer_connection_direction::unknown),
                 is_firewalled(firewalled_state::unknown),
                 our_state(our_connection_state::disconnected),
@@ -76,10 +122,17 @@ namespace graphene {
                 their_state(their_connection_state::disconnected),
                 we_have_requested_close(false),
                 negotiation_status(connection_negotiation_status::disconnected),
+                supports_compact_blocks(false),
+                supports_block_ranges(false),
                 number_of_unfetched_item_ids(0),
                 peer_needs_sync_items_from_us(true),
                 we_need_sync_items_from_peer(true),
                 inhibit_fetching_sync_blocks(false),
+                block_range_limit(std::numeric_limits<uint32_t>::max()),
+                known_inventory(GRAPHENE_NET_KNOWN_INVENTORY_MIN_GENERATION_SIZE,
+                        GRAPHENE_NET_KNOWN_INVENTORY_GENERATION_SIZE,
+                        GRAPHENE_NET_KNOWN_INVENTORY_FALSE_POSITIVE_RATE,
+                        GRAPHENE_NET_KNOWN_INVENTORY_GENERATION_TIME),
                 transaction_fetching_inhibited_until(fc::time_point::min()),
                 last_known_fork_block_number(0),
                 firewall_check_state(nullptr)
@@ -88,6 +141,11 @@ namespace graphene {
                 _send_message_queue_tasks_running(0)
 #endif
         {
+            _send_queues[size_t(message_priority::block)].max_size_in_bytes = GRAPHENE_NET_MAXIMUM_QUEUED_BLOCK_BYTES;
+            _send_queues[size_t(message_priority::block_fetch)].max_size_in_bytes = GRAPHENE_NET_MAXIMUM_QUEUED_BLOCK_FETCH_BYTES;
+            _send_queues[size_t(message_priority::request_reply)].max_size_in_bytes = GRAPHENE_NET_MAXIMUM_QUEUED_REQUEST_REPLY_BYTES;
+            _send_queues[size_t(message_priority::inventory)].max_size_in_bytes = GRAPHENE_NET_MAXIMUM_QUEUED_INVENTORY_BYTES;
+            _send_queues[size_t(message_priority::transaction)].max_size_in_bytes = GRAPHENE_NET_MAXIMUM_QUEUED_TRANSACTION_BYTES;
         }
 
         peer_connection_ptr peer_connection::make_shared(peer_connection_delegate *delegate) {
@@ -141,6 +199,16 @@ namespace graphene {
                 wlog("Unexpected exception from peer_connection's send_queued_messages_task");
             }
 
+            try {
+                block_range_stream_done.cancel_and_wait(__FUNCTION__);
+            }
+            catch (const fc::exception &e) {
+                wlog("Unexpected exception from the block range stream of peer_connection : ${e}", ("e", e));
+            }
+            catch (...) {
+                wlog("Unexpected exception from the block range stream of peer_connection");
+            }
+
             try {
                 dlog("canceling accept_or_connect_task");
                 accept_or_connect_task_done.cancel_and_wait(__FUNCTION__);
@@ -269,9 +337,31 @@ namespace graphene {
                     --_send_message_queue_tasks_counter; /* dlog("leaving peer_connection::send_queued_messages_task()"); */ }
             } concurrent_invocation_counter(_send_message_queue_tasks_running);
 #endif
-            while (!_queued_messages.empty()) {
-                _queued_messages.front()->transmission_start_time = fc::time_point::now();
-                message message_to_send = _queued_messages.front()->get_message(_node);
+            const fc::microseconds max_transaction_age = fc::milliseconds(GRAPHENE_NET_MAXIMUM_QUEUED_TRANSACTION_AGE_MS);
+            while (true) {
+                // the first class with messages goes first, transactions the peer has stopped waiting for are skipped
+                send_queue *queue = nullptr;
+                for (auto &q : _send_queues) {
+                    if (!q.messages.empty()) {
+                        queue = &q;
+                        break;
+                    }
+                }
+                if (!queue) {
+                    break;
+                }
+
+                std::unique_ptr<queued_message> current_message = std::move(queue->messages.front());
+                queue->messages.pop_front();
+                if (queue == &_send_queues[size_t(message_priority::transaction)] &&
+                    fc::time_point::now() - current_message->enqueue_time > max_transaction_age) {
+                    queue->size_in_bytes -= current_message->get_size_in_queue();
+                    drop_queued_message(std::move(current_message));
+                    continue;
+                }
+
+                current_message->transmission_start_time = fc::time_point::now();
+                message message_to_send = current_message->get_message(_node);
                 try {
                     //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
                     //     "to send message of type ${type} for peer ${endpoint}",
@@ -300,27 +390,67 @@ namespace graphene {
                 catch (...) {
                     elog("message_oriented_exception::send_message() threw an unhandled exception");
                 }
-                _queued_messages.front()->transmission_finish_time = fc::time_point::now();
-                _total_queued_messages_size -= _queued_messages.front()->get_size_in_queue();
-                _queued_messages.pop();
+                current_message->transmission_finish_time = fc::time_point::now();
+                queue->size_in_bytes -= current_message->get_size_in_queue();
+                _node->on_message_sent(this, message_to_send);
             }
             //dlog("leaving peer_connection::send_queued_messages_task() due to queue exhaustion");
         }
 
+        void peer_connection::drop_queued_message(std::unique_ptr<queued_message> &&message_to_drop) {
+            ++_number_of_dropped_messages;
+            _node->on_message_dropped(this, message_to_drop->get_item_id());
+            if (message_to_drop->get_priority() != message_priority::transaction) {
+                return;
+            }
+
+            // transactions are only sent in reply to fetch_items, the peer waits for an answer
+            std::unique_ptr<queued_message> reply(new real_queued_message(item_not_available_message(message_to_drop->get_item_id())));
+            send_queue &queue = _send_queues[size_t(reply->get_priority())];
+            queue.size_in_bytes += reply->get_size_in_queue();
+            queue.messages.emplace_back(std::move(reply));
+        }
+
+        bool peer_connection::enforce_send_queue_budget(message_priority priority) {
+            send_queue &queue = _send_queues[size_t(priority)];
+            if (queue.size_in_bytes <= queue.max_size_in_bytes) {
+                return true;
+            }
+
+            switch (priority) {
+                case message_priority::inventory:
+                case message_priority::transaction:
+                    // the oldest ones are the most likely to be stale already
+                    while (queue.size_in_bytes > queue.max_size_in_bytes &&
+                           !queue.messages.empty()) {
+                        std::unique_ptr<queued_message> oldest_message = std::move(queue.messages.front());
+                        queue.messages.pop_front();
+                        queue.size_in_bytes -= oldest_message->get_size_in_queue();
+                        drop_queued_message(std::move(oldest_message));
+                    }
+                    return true;
+                default:
+                    // blocks, fetches and replies are never dropped, the peer would wait for them forever
+                    elog("send queue exceeded maximum size of ${max} bytes (current size ${current} bytes)",
+                            ("max", queue.max_size_in_bytes)("current", queue.size_in_bytes));
+                    try {
+                        close_connection();
+                    }
+                    catch (const fc::exception &e) {
+                        elog("Caught error while closing connection: ${exception}", ("exception", e));
+                    }
+                    return false;
+            }
+        }
+
         void peer_connection::send_queueable_message(std::unique_ptr<queued_message> &&message_to_send) {
             VERIFY_CORRECT_THREAD();
-            _total_queued_messages_size += message_to_send->get_size_in_queue();
-            _queued_messages.emplace(std::move(message_to_send));
-            if (_total_queued_messages_size >
-                GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES) {
-                elog("send queue exceeded maximum size of ${max} bytes (current size ${current} bytes)",
-                        ("max", GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES)("current", _total_queued_messages_size));
-                try {
-                    close_connection();
-                }
-                catch (const fc::exception &e) {
-                    elog("Caught error while closing connection: ${exception}", ("exception", e));
-                }
+            const message_priority priority = message_to_send->get_priority();
+            send_queue &queue = _send_queues[size_t(priority)];
+            queue.size_in_bytes += message_to_send->get_size_in_queue();
+            queue.messages.emplace_back(std::move(message_to_send));
+            if (!enforce_send_queue_budget(priority) ||
+                !enforce_send_queue_budget(message_priority::block_fetch)) {
                 return;
             }
 
@@ -337,6 +467,14 @@ namespace graphene {
             //  dlog("peer_connection::send_message() doesn't need to fire up send_queued_message_task, it's already running");
         }
 
+        size_t peer_connection::get_total_queued_messages_size() const {
+            size_t result = 0;
+            for (const auto &queue : _send_queues) {
+                result += queue.size_in_bytes;
+            }
+            return result;
+        }
+
         void peer_connection::send_message(const message &message_to_send, size_t message_send_time_field_offset) {
             VERIFY_CORRECT_THREAD();
             //dlog("peer_connection::send_message() enqueueing message of type ${type} for peer ${endpoint}",
@@ -420,6 +558,28 @@ namespace graphene {
             return transaction_fetching_inhibited_until > fc::time_point::now();
         }
 
+        void peer_connection::record_sync_item_received(uint32_t item_count) {
+            VERIFY_CORRECT_THREAD();
+            fc::time_point now = fc::time_point::now();
+            // items arriving together in a block range frame share the time since the previous one
+            fc::microseconds interval(std::max<int64_t>((now - last_sync_item_received_time).count() /
+                                                        std::max<uint32_t>(item_count, 1), 1));
+            if (average_sync_block_interval.count() == 0) {
+                average_sync_block_interval = interval;
+            } else {
+                average_sync_block_interval = fc::microseconds((average_sync_block_interval.count() * 4 + interval.count()) / 5);
+            }
+            last_sync_item_received_time = now;
+        }
+
+        double peer_connection::get_sync_blocks_per_second() const {
+            VERIFY_CORRECT_THREAD();
+            if (average_sync_block_interval.count() <= 0) {
+                return 0;
+            }
+            return 1000000.0 / average_sync_block_interval.count();
+        }
+
         fc::sha512 peer_connection::get_shared_secret() const {
             VERIFY_CORRECT_THREAD();
             return _message_connection.get_shared_secret();
@@ -430,20 +590,16 @@ namespace graphene {
             fc::time_point_sec oldest_inventory_to_keep(fc::time_point::now() -
                                                         fc::minutes(GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES));
 
-            // expire old items from inventory_advertised_to_peer
-            auto oldest_inventory_to_keep_iter = inventory_advertised_to_peer.get<timestamp_index>().lower_bound(oldest_inventory_to_keep);
-            auto begin_iter = inventory_advertised_to_peer.get<timestamp_index>().begin();
-            unsigned number_of_elements_advertised_to_peer_to_discard = std::distance(begin_iter, oldest_inventory_to_keep_iter);
-            inventory_advertised_to_peer.get<timestamp_index>().erase(begin_iter, oldest_inventory_to_keep_iter);
-
-            // also expire items from inventory_peer_advertised_to_us
-            oldest_inventory_to_keep_iter = inventory_peer_advertised_to_us.get<timestamp_index>().lower_bound(oldest_inventory_to_keep);
-            begin_iter = inventory_peer_advertised_to_us.get<timestamp_index>().begin();
+            // known_inventory ages by itself, only expire items from inventory_peer_advertised_to_us
+            auto oldest_inventory_to_keep_iter = inventory_peer_advertised_to_us.get<timestamp_index>().lower_bound(oldest_inventory_to_keep);
+            auto begin_iter = inventory_peer_advertised_to_us.get<timestamp_index>().begin();
+            if (begin_iter == oldest_inventory_to_keep_iter) {
+                return;
+            }
             unsigned number_of_elements_peer_advertised_to_discard = std::distance(begin_iter, oldest_inventory_to_keep_iter);
             inventory_peer_advertised_to_us.get<timestamp_index>().erase(begin_iter, oldest_inventory_to_keep_iter);
-            dlog("Expiring old inventory for peer ${peer}: removing ${to_peer} items advertised to peer (${remain_to_peer} left), and ${to_us} advertised to us (${remain_to_us} left)",
+            dlog("Expiring old inventory for peer ${peer}: removing ${to_us} items advertised to us (${remain_to_us} left)",
                     ("peer", get_remote_endpoint())
-                            ("to_peer", number_of_elements_advertised_to_peer_to_discard)("remain_to_peer", inventory_advertised_to_peer.size())
                             ("to_us", number_of_elements_peer_advertised_to_discard)("remain_to_us", inventory_peer_advertised_to_us.size()));
         }
 
@@ -29,26 +29,157 @@
 
 #include <fc/io/raw.hpp>
 #include <fc/io/json.hpp>
+#include <fc/filesystem.hpp>
 
 #include <graphene/net/peer_database.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+
+#define MAXIMUM_PEERDB_SIZE 1000
+#define PEERDB_FILE_MAGIC 0x42445047 // "GPDB"
+#define PEERDB_FILE_VERSION 2
+#define PEERDB_MAX_STORED_ERROR_SIZE 256
+#define LEGACY_PEERDB_FILENAME "peers.json"
 
 namespace graphene {
     namespace net {
+
+        void potential_peer_record::record_connection_quality(const fc::microseconds &round_trip_delay,
+                const fc::microseconds &sync_block_interval) {
+            if (round_trip_delay.count() > 0) {
+                uint32_t latency_ms = std::max<uint32_t>(1, round_trip_delay.count() / 1000);
+                average_latency_ms = average_latency_ms ? (average_latency_ms * 3 + latency_ms) / 4 : latency_ms;
+            }
+            if (sync_block_interval.count() > 0) {
+                uint32_t interval_us = static_cast<uint32_t>(std::min<int64_t>(sync_block_interval.count(), std::numeric_limits<uint32_t>::max()));
+                sync_block_interval_us = sync_block_interval_us ? (sync_block_interval_us / 4) * 3 + interval_us / 4 : interval_us;
+            }
+        }
+
+        int64_t potential_peer_record::score() const {
+            int64_t result = 0;
+
+            result += 100 * std::min<uint32_t>(number_of_successful_connection_attempts, 10);
+            result -= 100 * std::min<uint32_t>(number_of_failed_connection_attempts, 10);
+            result -= 200 * std::min<uint32_t>(number_of_connection_errors, 10);
+
+            switch (last_connection_disposition.value) {
+                case last_connection_succeeded:
+                    result += 200;
+                    break;
+                case last_connection_failed:
+                case last_connection_handshaking_failed:
+                    result -= 100;
+                    break;
+                case last_connection_rejected:
+                    result -= 50;
+                    break;
+                default:
+                    break;
+            }
+
+            // up to 500 points for a nearby peer
+            if (average_latency_ms) {
+                result += 500 - std::min<uint32_t>(average_latency_ms, 1000) / 2;
+            }
+
+            // one point for every sync block per second, up to 1000
+            if (sync_block_interval_us) {
+                result += std::min<uint32_t>(1000000 / sync_block_interval_us, 1000);
+            }
+
+            return result;
+        }
+
         namespace detail {
             using namespace boost::multi_index;
 
+            enum peer_database_entry_type : uint8_t {
+                updated_entry = 0,
+                erased_entry = 1
+            };
+
+            template<typename Stream>
+            void pack_record(Stream &stream, const potential_peer_record &record) {
+                fc::raw::pack(stream, record.endpoint);
+                fc::raw::pack(stream, record.last_seen_time);
+                fc::raw::pack(stream, record.last_connection_disposition);
+                fc::raw::pack(stream, record.last_connection_attempt_time);
+                fc::raw::pack(stream, record.number_of_successful_connection_attempts);
+                fc::raw::pack(stream, record.number_of_failed_connection_attempts);
+                fc::raw::pack(stream, record.number_of_connection_errors);
+                fc::raw::pack(stream, record.average_latency_ms);
+                fc::raw::pack(stream, record.sync_block_interval_us);
+
+                // only the text of the error is kept, the full exception with its log
+                // context would make the records several times larger
+                fc::optional<std::string> last_error;
+                if (record.last_error) {
+                    last_error = record.last_error->to_string().substr(0, PEERDB_MAX_STORED_ERROR_SIZE);
+                }
+                fc::raw::pack(stream, last_error);
+            }
+
+            template<typename Stream>
+            void unpack_record(Stream &stream, potential_peer_record &record, uint32_t version) {
+                fc::raw::unpack(stream, record.endpoint);
+                fc::raw::unpack(stream, record.last_seen_time);
+                fc::raw::unpack(stream, record.last_connection_disposition);
+                fc::raw::unpack(stream, record.last_connection_attempt_time);
+                fc::raw::unpack(stream, record.number_of_successful_connection_attempts);
+                fc::raw::unpack(stream, record.number_of_failed_connection_attempts);
+                fc::raw::unpack(stream, record.number_of_connection_errors);
+                fc::raw::unpack(stream, record.average_latency_ms);
+                fc::raw::unpack(stream, record.sync_block_interval_us);
+
+                if (version >= 2) {
+                    fc::optional<std::string> last_error;
+                    fc::raw::unpack(stream, last_error);
+                    if (last_error) {
+                        record.last_error = fc::exception(FC_LOG_MESSAGE(warn, "${error}", ("error", *last_error)));
+                    }
+                }
+            }
+
+            template<typename Stream>
+            void pack_entry(Stream &stream, peer_database_entry_type type, const potential_peer_record &record) {
+                fc::raw::pack(stream, static_cast<uint8_t>(type));
+                if (type == updated_entry) {
+                    pack_record(stream, record);
+                } else {
+                    fc::raw::pack(stream, record.endpoint);
+                }
+            }
+
+            /// Entry prefixed by its size, so a write torn by a crash is detected on load
+            std::vector<char> serialize_entry(peer_database_entry_type type, const potential_peer_record &record) {
+                fc::datastream<size_t> size_stream;
+                pack_entry(size_stream, type, record);
+                uint32_t entry_size = static_cast<uint32_t>(size_stream.tellp());
+
+                std::vector<char> result(sizeof(entry_size) + entry_size);
+                fc::datastream<char *> stream(result.data(), result.size());
+                fc::raw::pack(stream, entry_size);
+                pack_entry(stream, type, record);
+                return result;
+            }
+
             class peer_database_impl {
             public:
-                struct last_seen_time_index {
+                struct score_index {
                 };
                 struct endpoint_index {
                 };
                 typedef boost::multi_index_container<potential_peer_record,
-                        indexed_by<ordered_non_unique<tag<last_seen_time_index>,
-                                member<potential_peer_record,
-                                        fc::time_point_sec,
-                                        &potential_peer_record::last_seen_time>>,
+                        indexed_by<ordered_non_unique<tag<score_index>,
+                                const_mem_fun<potential_peer_record,
+                                        int64_t,
+                                        &potential_peer_record::score>,
+                                std::greater<int64_t>>,
                                 hashed_unique<tag<endpoint_index>,
                                         member<potential_peer_record,
                                                 fc::ip::endpoint,
@@ -58,6 +189,16 @@ namespace graphene {
             private:
                 potential_peer_set _potential_peer_set;
                 fc::path _peer_database_filename;
+                std::ofstream _log;
+                size_t _log_entries = 0; /// entries written to the log, live or overwritten
+
+                bool load_log();
+
+                void load_legacy_json();
+
+                void append_entry(peer_database_entry_type type, const potential_peer_record &record);
+
+                void compact();
 
             public:
                 void open(const fc::path &databaseFilename);
@@ -83,10 +224,10 @@ namespace graphene {
 
             class peer_database_iterator_impl {
             public:
-                typedef peer_database_impl::potential_peer_set::index<peer_database_impl::last_seen_time_index>::type::iterator last_seen_time_index_iterator;
-                last_seen_time_index_iterator _iterator;
+                typedef peer_database_impl::potential_peer_set::index<peer_database_impl::score_index>::type::iterator score_index_iterator;
+                score_index_iterator _iterator;
 
-                peer_database_iterator_impl(const last_seen_time_index_iterator &iterator)
+                peer_database_iterator_impl(const score_index_iterator &iterator)
                         :
                         _iterator(iterator) {
                 }
@@ -97,53 +238,183 @@ namespace graphene {
                     boost::iterator_facade<peer_database_iterator, const potential_peer_record, boost::forward_traversal_tag>(c) {
             }
 
-            void peer_database_impl::open(const fc::path &peer_database_filename) {
-                _peer_database_filename = peer_database_filename;
-                if (fc::exists(_peer_database_filename)) {
-                    try {
-                        std::vector<potential_peer_record> peer_records = fc::json::from_file(_peer_database_filename).as<std::vector<potential_peer_record>>();
-                        std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
-#define MAXIMUM_PEERDB_SIZE 1000
-                        if (_potential_peer_set.size() > MAXIMUM_PEERDB_SIZE) {
-                            // prune database to a reasonable size
-                            auto iter = _potential_peer_set.begin();
-                            std::advance(iter, MAXIMUM_PEERDB_SIZE);
-                            _potential_peer_set.erase(iter, _potential_peer_set.end());
-                        }
+            bool peer_database_impl::load_log() {
+                std::ifstream file(_peer_database_filename.string(), std::ios::binary);
+                std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                fc::datastream<const char *> stream(contents.data(), contents.size());
+
+                uint32_t magic = 0;
+                uint32_t version = 0;
+                if (stream.remaining() < sizeof(magic) + sizeof(version)) {
+                    return false;
+                }
+                fc::raw::unpack(stream, magic);
+                fc::raw::unpack(stream, version);
+                FC_ASSERT(magic == PEERDB_FILE_MAGIC && version >= 1 && version <= PEERDB_FILE_VERSION,
+                        "Unknown peer database format");
+
+                bool complete = true;
+                while (stream.remaining()) {
+                    uint32_t entry_size = 0;
+                    if (stream.remaining() < sizeof(entry_size)) {
+                        complete = false;
+                        break;
                     }
-                    catch (const fc::exception &e) {
-                        elog("error opening peer database file ${peer_database_filename}, starting with a clean database",
-                                ("peer_database_filename", _peer_database_filename));
+                    fc::raw::unpack(stream, entry_size);
+                    if (stream.remaining() < entry_size) {
+                        complete = false;
+                        break;
                     }
+
+                    fc::datastream<const char *> entry_stream(contents.data() + stream.tellp(), entry_size);
+                    stream.skip(entry_size);
+
+                    uint8_t type = 0;
+                    potential_peer_record record;
+                    fc::raw::unpack(entry_stream, type);
+                    if (type == updated_entry) {
+                        unpack_record(entry_stream, record, version);
+                        auto iter = _potential_peer_set.get<endpoint_index>().find(record.endpoint);
+                        if (iter != _potential_peer_set.get<endpoint_index>().end()) {
+                            _potential_peer_set.get<endpoint_index>().replace(iter, record);
+                        } else {
+                            _potential_peer_set.get<endpoint_index>().insert(record);
+                        }
+                    } else {
+                        fc::raw::unpack(entry_stream, record.endpoint);
+                        _potential_peer_set.get<endpoint_index>().erase(record.endpoint);
+                    }
+                    ++_log_entries;
+                }
+
+                if (!complete) {
+                    wlog("peer database ${peer_database_filename} ends with an incomplete record, it will be dropped",
+                            ("peer_database_filename", _peer_database_filename));
                 }
+                // a log of an older version is rewritten before new entries are appended to it
+                return complete && version == PEERDB_FILE_VERSION;
             }
 
-            void peer_database_impl::close() {
-                std::vector<potential_peer_record> peer_records;
-                peer_records.reserve(_potential_peer_set.size());
-                std::copy(_potential_peer_set.begin(), _potential_peer_set.end(), std::back_inserter(peer_records));
+            void peer_database_impl::load_legacy_json() {
+                fc::path legacy_filename = _peer_database_filename.parent_path() / LEGACY_PEERDB_FILENAME;
+                if (!fc::exists(legacy_filename)) {
+                    return;
+                }
+
+                std::vector<potential_peer_record> peer_records = fc::json::from_file(legacy_filename).as<std::vector<potential_peer_record>>();
+                std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
+                ilog("imported ${count} peers from ${legacy_filename}",
+                        ("count", _potential_peer_set.size())("legacy_filename", legacy_filename));
+            }
 
+            void peer_database_impl::append_entry(peer_database_entry_type type, const potential_peer_record &record) {
+                if (!_log.is_open()) {
+                    if (!_peer_database_filename.string().empty()) {
+                        // the last compaction failed, retry it to save this change
+                        compact();
+                    }
+                    return;
+                }
+
+                std::vector<char> entry = serialize_entry(type, record);
+                _log.write(entry.data(), entry.size());
+                _log.flush();
+                ++_log_entries;
+
+                if (_log_entries > 2 * _potential_peer_set.size() + MAXIMUM_PEERDB_SIZE) {
+                    compact();
+                }
+            }
+
+            void peer_database_impl::compact() {
                 try {
                     fc::path peer_database_filename_dir = _peer_database_filename.parent_path();
                     if (!fc::exists(peer_database_filename_dir)) {
                         fc::create_directories(peer_database_filename_dir);
                     }
-                    fc::json::save_to_file(peer_records, _peer_database_filename);
+
+                    _log.close();
+
+                    fc::path temporary_filename = _peer_database_filename.string() + ".tmp";
+                    {
+                        std::ofstream file(temporary_filename.string(), std::ios::binary | std::ios::trunc);
+                        std::vector<char> header(sizeof(uint32_t) * 2);
+                        fc::datastream<char *> header_stream(header.data(), header.size());
+                        fc::raw::pack(header_stream, uint32_t(PEERDB_FILE_MAGIC));
+                        fc::raw::pack(header_stream, uint32_t(PEERDB_FILE_VERSION));
+                        file.write(header.data(), header.size());
+
+                        for (const potential_peer_record &record : _potential_peer_set) {
+                            std::vector<char> entry = serialize_entry(updated_entry, record);
+                            file.write(entry.data(), entry.size());
+                        }
+                        file.flush();
+                        FC_ASSERT(file.good(), "Unable to write ${temporary_filename}", ("temporary_filename", temporary_filename));
+                    }
+                    fc::rename(temporary_filename, _peer_database_filename);
+                    _log_entries = _potential_peer_set.size();
+                    _log.open(_peer_database_filename.string(), std::ios::binary | std::ios::app);
+                }
+                catch (const fc::exception &e) {
+                    // keep working with the peers in memory, they'll be saved by the next successful compaction
+                    elog("error saving peer database to file ${peer_database_filename}: ${e}",
+                            ("peer_database_filename", _peer_database_filename)("e", e.to_detail_string()));
+                }
+            }
+
+            void peer_database_impl::open(const fc::path &peer_database_filename) {
+                _peer_database_filename = peer_database_filename;
+                _log_entries = 0;
+                bool needs_compaction = true;
+                try {
+                    if (fc::exists(_peer_database_filename)) {
+                        needs_compaction = !load_log();
+                    } else {
+                        load_legacy_json();
+                    }
                 }
                 catch (const fc::exception &e) {
-                    elog("error saving peer database to file ${peer_database_filename}",
+                    elog("error opening peer database file ${peer_database_filename}, starting with a clean database",
                             ("peer_database_filename", _peer_database_filename));
+                    _potential_peer_set.clear();
+                    needs_compaction = true;
+                }
+
+                if (_potential_peer_set.size() > MAXIMUM_PEERDB_SIZE) {
+                    // prune database to a reasonable size, dropping the worst peers
+                    auto iter = _potential_peer_set.get<score_index>().begin();
+                    std::advance(iter, MAXIMUM_PEERDB_SIZE);
+                    _potential_peer_set.get<score_index>().erase(iter, _potential_peer_set.get<score_index>().end());
+                    needs_compaction = true;
+                }
+
+                if (needs_compaction ||
+                    _log_entries > 2 * _potential_peer_set.size() + MAXIMUM_PEERDB_SIZE) {
+                    compact();
+                } else {
+                    _log.open(_peer_database_filename.string(), std::ios::binary | std::ios::app);
                 }
+            }
+
+            void peer_database_impl::close() {
+                // every change is already in the log
+                _log.close();
+                _log_entries = 0;
+                _peer_database_filename = fc::path();
                 _potential_peer_set.clear();
             }
 
             void peer_database_impl::clear() {
                 _potential_peer_set.clear();
+                if (_log.is_open()) {
+                    compact();
+                }
             }
 
             void peer_database_impl::erase(const fc::ip::endpoint &endpointToErase) {
                 auto iter = _potential_peer_set.get<endpoint_index>().find(endpointToErase);
                 if (iter != _potential_peer_set.get<endpoint_index>().end()) {
+                    append_entry(erased_entry, *iter);
                     _potential_peer_set.get<endpoint_index>().erase(iter);
                 }
             }
@@ -155,6 +426,7 @@ namespace graphene {
                 } else {
                     _potential_peer_set.get<endpoint_index>().insert(updatedRecord);
                 }
+                append_entry(updated_entry, updatedRecord);
             }
 
             potential_peer_record peer_database_impl::lookup_or_create_entry_for_endpoint(const fc::ip::endpoint &endpointToLookup) {
@@ -174,11 +446,11 @@ namespace graphene {
             }
 
             peer_database::iterator peer_database_impl::begin() const {
-                return peer_database::iterator(new peer_database_iterator_impl(_potential_peer_set.get<last_seen_time_index>().begin()));
+                return peer_database::iterator(new peer_database_iterator_impl(_potential_peer_set.get<score_index>().begin()));
             }
 
             peer_database::iterator peer_database_impl::end() const {
-                return peer_database::iterator(new peer_database_iterator_impl(_potential_peer_set.get<last_seen_time_index>().end()));
+                return peer_database::iterator(new peer_database_iterator_impl(_potential_peer_set.get<score_index>().end()));
             }
 
             size_t peer_database_impl::size() const {
@@ -0,0 +1,130 @@
+#include <graphene/net/rolling_bloom_filter.hpp>
+
+#include <fc/crypto/rand.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace graphene {
+    namespace net {
+
+        namespace {
+            uint64_t mix(uint64_t value) {
+                value ^= value >> 33;
+                value *= 0xff51afd7ed558ccdull;
+                value ^= value >> 33;
+                value *= 0xc4ceb9fe1a85ec53ull;
+                value ^= value >> 33;
+                return value;
+            }
+
+            /// A generation filled this many times slower than the generation time is shrunk
+            const int64_t shrink_slowdown = 4;
+        }
+
+        rolling_bloom_filter::rolling_bloom_filter(uint32_t generation_size, double false_positive_rate)
+                : rolling_bloom_filter(generation_size, generation_size, false_positive_rate, fc::microseconds()) {
+        }
+
+        rolling_bloom_filter::rolling_bloom_filter(uint32_t min_generation_size, uint32_t max_generation_size,
+                double false_positive_rate, const fc::microseconds &generation_time)
+                : _min_generation_size(min_generation_size),
+                  _max_generation_size(max_generation_size),
+                  _false_positive_rate(false_positive_rate),
+                  _generation_time(generation_time) {
+            FC_ASSERT(min_generation_size > 0 && min_generation_size <= max_generation_size);
+            FC_ASSERT(false_positive_rate > 0 && false_positive_rate < 1);
+
+            fc::rand_pseudo_bytes(reinterpret_cast<char *>(&_tweak), sizeof(_tweak));
+
+            _current.reset(_min_generation_size, _false_positive_rate);
+            _previous.reset(_min_generation_size, _false_positive_rate);
+            if (_generation_time.count()) {
+                _generation_started = fc::time_point::now();
+            }
+        }
+
+        void rolling_bloom_filter::generation::reset(uint32_t new_capacity, double false_positive_rate) {
+            if (new_capacity != capacity) {
+                const double ln2 = std::log(2.0);
+                double optimal_bits = -std::log(false_positive_rate) * new_capacity / (ln2 * ln2);
+                capacity = new_capacity;
+                bit_count = std::max<uint64_t>(64, (static_cast<uint64_t>(std::ceil(optimal_bits)) + 63) / 64 * 64);
+                hash_count = std::max<uint32_t>(1, std::min<uint32_t>(32,
+                        static_cast<uint32_t>(std::round(double(bit_count) / new_capacity * ln2))));
+                bits.assign(bit_count / 64, 0);
+                bits.shrink_to_fit();
+            } else {
+                std::fill(bits.begin(), bits.end(), 0);
+            }
+            count = 0;
+        }
+
+        bool rolling_bloom_filter::generation::contains(const hashes &item_hashes) const {
+            for (uint32_t i = 0; i < hash_count; ++i) {
+                uint64_t bit = (item_hashes.first + i * item_hashes.second) % bit_count;
+                if (!(bits[bit / 64] & (uint64_t(1) << (bit % 64)))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void rolling_bloom_filter::generation::insert(const hashes &item_hashes) {
+            for (uint32_t i = 0; i < hash_count; ++i) {
+                uint64_t bit = (item_hashes.first + i * item_hashes.second) % bit_count;
+                bits[bit / 64] |= uint64_t(1) << (bit % 64);
+            }
+            ++count;
+        }
+
+        rolling_bloom_filter::hashes rolling_bloom_filter::hash_item(const item_id &item) const {
+            const uint32_t *words = item.item_hash._hash;
+            hashes result;
+            result.first = mix((uint64_t(words[0]) << 32 | words[1]) ^ _tweak ^ item.item_type);
+            // odd, so positions of one item never repeat
+            result.second = mix((uint64_t(words[2]) << 32 | words[3]) ^ words[4] ^ (_tweak >> 1)) | 1;
+            return result;
+        }
+
+        uint32_t rolling_bloom_filter::next_generation_size() const {
+            if (!_generation_time.count()) {
+                return _current.capacity;
+            }
+
+            auto elapsed = fc::time_point::now() - _generation_started;
+            if (elapsed < _generation_time) {
+                return std::min<uint64_t>(uint64_t(_current.capacity) * 2, _max_generation_size);
+            }
+            if (elapsed.count() > _generation_time.count() * shrink_slowdown) {
+                return std::max(_current.capacity / 2, _min_generation_size);
+            }
+            return _current.capacity;
+        }
+
+        void rolling_bloom_filter::insert(const item_id &item) {
+            if (_current.count >= _current.capacity) {
+                auto capacity = next_generation_size();
+                std::swap(_previous, _current);
+                _current.reset(capacity, _false_positive_rate);
+                if (_generation_time.count()) {
+                    _generation_started = fc::time_point::now();
+                }
+            }
+
+            _current.insert(hash_item(item));
+        }
+
+        bool rolling_bloom_filter::contains(const item_id &item) const {
+            hashes item_hashes = hash_item(item);
+            return _current.contains(item_hashes) || _previous.contains(item_hashes);
+        }
+
+        void rolling_bloom_filter::clear() {
+            _current.reset(_current.capacity, _false_positive_rate);
+            _previous.reset(_previous.capacity, _false_positive_rate);
+        }
+
+    }
+} // end namespace graphene::net
@@ -242,8 +242,15 @@ namespace steemit {
                 ilog("Initializing account_by_key plugin");
                 chain::database &db = database();
 
-                db.pre_apply_operation.connect([&](const operation_notification &o) { my->pre_operation(o); });
-                db.post_apply_operation.connect([&](const operation_notification &o) { my->post_operation(o); });
+                db.subscribe_operations<
+                        protocol::account_create_operation, protocol::account_update_operation,
+                        protocol::recover_account_operation, protocol::pow_operation, protocol::pow2_operation
+                >(db.pre_apply_handlers(), "account_by_key.pre_apply_operation", [&](const operation_notification &o) { my->pre_operation(o); });
+                db.subscribe_operations<
+                        protocol::account_create_operation, protocol::account_update_operation,
+                        protocol::recover_account_operation, protocol::pow_operation, protocol::pow2_operation,
+                        protocol::hardfork_operation
+                >(db.post_apply_handlers(), "account_by_key.post_apply_operation", [&](const operation_notification &o) { my->post_operation(o); });
 
                 add_plugin_index<key_lookup_index>(db);
             }
@@ -82,6 +82,8 @@ namespace steemit {
                     _db.create<account_history_object>([&](account_history_object &ahist) {
                         ahist.account = item;
                         ahist.sequence = sequence;
+                        ahist.op_type = static_cast<uint16_t>(_note.op.which());
+                        ahist.timestamp = new_obj->timestamp;
                         ahist.op = new_obj->id;
                     });
                 }
@@ -220,7 +222,7 @@ namespace steemit {
 
         void account_history_plugin::plugin_initialize(const boost::program_options::variables_map &options) {
             //ilog("Intializing account history plugin" );
-            database().pre_apply_operation.connect([&](const operation_notification &note) { my->on_operation(note); });
+            database().connect_profiled(database().pre_apply_operation, "account_history.pre_apply_operation", [&](const operation_notification &note) { my->on_operation(note); });
 
             typedef pair<string, string> pairstring;
             LOAD_VALUE_SET(options, "track-account-range", my->_tracked_accounts, pairstring);
@@ -77,7 +77,7 @@ namespace steemit {
             try {
                 ilog("account_stats plugin: plugin_initialize() begin");
 
-                database().post_apply_operation.connect([&](const operation_notification &o) { _my->on_operation(o); });
+                database().connect_profiled(database().post_apply_operation, "account_statistics.post_apply_operation", chain::virtual_operations<>(), [&](const operation_notification &o) { _my->on_operation(o); });
 
                 ilog("account_stats plugin: plugin_initialize() end");
             } FC_CAPTURE_AND_RETHROW()
@@ -0,0 +1,58 @@
+#include <steemit/app/api_context.hpp>
+#include <steemit/app/application.hpp>
+#include <steemit/chain/database.hpp>
+
+#include <steemit/plugins/apply_profiler/apply_profiler_api.hpp>
+#include <steemit/plugins/apply_profiler/apply_profiler_plugin.hpp>
+
+namespace steemit {
+    namespace plugin {
+        namespace apply_profiler {
+
+            namespace detail {
+
+                class apply_profiler_api_impl {
+                public:
+                    apply_profiler_api_impl(steemit::app::application &_app)
+                            : app(_app) {
+                    }
+
+                    steemit::app::application &app;
+                };
+
+            } // detail
+
+            apply_profiler_api::apply_profiler_api(const steemit::app::api_context &ctx) {
+                my = std::make_shared<detail::apply_profiler_api_impl>(ctx.app);
+            }
+
+            void apply_profiler_api::on_api_startup() {
+            }
+
+            chain::apply_profile apply_profiler_api::get_apply_profile() const {
+                auto &db = *my->app.chain_database();
+                return db.with_read_lock([&]() {
+                    return db.profiler().get_profile();
+                });
+            }
+
+            void apply_profiler_api::reset_apply_profile() {
+                auto &db = *my->app.chain_database();
+                db.with_write_lock([&]() {
+                    db.profiler().reset();
+                });
+            }
+
+            // Lock statistics are guarded by their own mutex, taking the
+            // database lock here would only add the API call to them
+            chain::lock_statistics apply_profiler_api::get_lock_statistics() const {
+                return my->app.chain_database()->locks().get_statistics();
+            }
+
+            void apply_profiler_api::reset_lock_statistics() {
+                my->app.chain_database()->locks().reset();
+            }
+
+        }
+    }
+} // steemit::plugin::apply_profiler
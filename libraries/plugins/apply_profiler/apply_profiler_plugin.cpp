@@ -0,0 +1,110 @@
+#include <steemit/chain/database.hpp>
+
+#include <steemit/plugins/apply_profiler/apply_profiler_api.hpp>
+#include <steemit/plugins/apply_profiler/apply_profiler_plugin.hpp>
+
+#include <algorithm>
+
+namespace steemit {
+    namespace plugin {
+        namespace apply_profiler {
+
+            namespace {
+
+                typedef std::pair<std::string, chain::apply_profile_entry> profile_item;
+
+                /// Entries with the biggest total time, formatted for the log
+                std::vector<std::string> top_entries(const std::map<std::string, chain::apply_profile_entry> &entries, uint32_t limit) {
+                    std::vector<profile_item> items(entries.begin(), entries.end());
+                    std::sort(items.begin(), items.end(), [](const profile_item &a, const profile_item &b) {
+                        return a.second.total_us > b.second.total_us;
+                    });
+
+                    if (items.size() > limit) {
+                        items.resize(limit);
+                    }
+
+                    std::vector<std::string> result;
+                    for (const auto &item : items) {
+                        result.push_back(item.first + ": " +
+                                         fc::to_string(item.second.total_us / 1000) + "ms total, " +
+                                         fc::to_string(item.second.count) + " calls, " +
+                                         fc::to_string(item.second.max_us) + "us max");
+                    }
+                    return result;
+                }
+
+            }
+
+            apply_profiler_plugin::apply_profiler_plugin(application *app)
+                    : plugin(app) {
+            }
+
+            apply_profiler_plugin::~apply_profiler_plugin() {
+            }
+
+            std::string apply_profiler_plugin::plugin_name() const {
+                return "apply_profiler";
+            }
+
+            void apply_profiler_plugin::plugin_set_program_options(
+                    boost::program_options::options_description &cli,
+                    boost::program_options::options_description &cfg
+            ) {
+                cli.add_options()
+                        ("apply-profiler-log-interval", boost::program_options::value<uint32_t>()->default_value(1200),
+                                "Log apply profile summary every N blocks, 0 disables logging (default: 1200)")
+                        ("apply-profiler-log-top", boost::program_options::value<uint32_t>()->default_value(10),
+                                "Amount of the slowest operations, subscribers and stages in the logged summary (default: 10)");
+                cfg.add(cli);
+            }
+
+            void apply_profiler_plugin::plugin_initialize(const boost::program_options::variables_map &options) {
+                try {
+                    ilog("Initializing apply profiler plugin");
+                    chain::database &db = database();
+
+                    if (options.count("apply-profiler-log-interval")) {
+                        _log_interval = options["apply-profiler-log-interval"].as<uint32_t>();
+                    }
+                    if (options.count("apply-profiler-log-top")) {
+                        _log_top = options["apply-profiler-log-top"].as<uint32_t>();
+                    }
+
+                    db.profiler().enable(true);
+
+                    if (_log_interval) {
+                        _applied_block_conn = db.applied_block.connect([this](const chain::signed_block &b) { on_applied_block(b); });
+                    }
+                } FC_CAPTURE_AND_RETHROW()
+            }
+
+            void apply_profiler_plugin::plugin_startup() {
+                app().register_api_factory<apply_profiler_api>("apply_profiler_api");
+            }
+
+            void apply_profiler_plugin::plugin_shutdown() {
+                database().profiler().enable(false);
+            }
+
+            void apply_profiler_plugin::on_applied_block(const chain::signed_block &b) {
+                if (b.block_num() % _log_interval != 0) {
+                    return;
+                }
+
+                // Profile is cumulative, it is cleared only through apply_profiler_api::reset_apply_profile
+                auto profile = database().profiler().get_profile();
+
+                ilog("Apply profile of ${n} blocks since ${since}: ${total}ms total, ${max}us max block",
+                        ("n", profile.blocks)("since", profile.since)
+                        ("total", profile.block_total.total_us / 1000)("max", profile.block_total.max_us));
+                ilog("Slowest operations: ${e}", ("e", top_entries(profile.operations, _log_top)));
+                ilog("Slowest subscribers: ${e}", ("e", top_entries(profile.subscribers, _log_top)));
+                ilog("Slowest block stages: ${e}", ("e", top_entries(profile.block_stages, _log_top)));
+            }
+
+        }
+    }
+} // steemit::plugin::apply_profiler
+
+STEEMIT_DEFINE_PLUGIN(apply_profiler, steemit::plugin::apply_profiler::apply_profiler_plugin)
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <steemit/chain/apply_profiler.hpp>
+#include <steemit/chain/lock_scheduler.hpp>
+
+#include <fc/api.hpp>
+
+namespace steemit {
+    namespace app {
+        struct api_context;
+    }
+}
+
+namespace steemit {
+    namespace plugin {
+        namespace apply_profiler {
+
+            namespace detail {
+                class apply_profiler_api_impl;
+            }
+
+            class apply_profiler_api {
+            public:
+                apply_profiler_api(const steemit::app::api_context &ctx);
+
+                void on_api_startup();
+
+                /// Returns timings collected since the node start or the last reset
+                chain::apply_profile get_apply_profile() const;
+
+                void reset_apply_profile();
+
+                /// Returns database lock wait and hold histograms collected since the node start or the last reset
+                chain::lock_statistics get_lock_statistics() const;
+
+                void reset_lock_statistics();
+
+            private:
+                std::shared_ptr<detail::apply_profiler_api_impl> my;
+            };
+
+        }
+    }
+}
+
+FC_API(steemit::plugin::apply_profiler::apply_profiler_api,
+        (get_apply_profile)
+                (reset_apply_profile)
+                (get_lock_statistics)
+                (reset_lock_statistics)
+)
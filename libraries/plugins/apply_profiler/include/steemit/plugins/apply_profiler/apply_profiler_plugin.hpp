@@ -0,0 +1,46 @@
+#pragma once
+
+#include <steemit/app/plugin.hpp>
+
+#include <string>
+
+namespace steemit {
+    namespace plugin {
+        namespace apply_profiler {
+
+            using steemit::app::application;
+
+            /**
+             *  Enables @ref steemit::chain::apply_profiler of the database, periodically
+             *  logs the slowest evaluators, plugin subscribers and block stages
+             *  and exposes the collected profile with apply_profiler_api
+             */
+            class apply_profiler_plugin : public steemit::app::plugin {
+            public:
+                apply_profiler_plugin(application *app);
+
+                virtual ~apply_profiler_plugin();
+
+                virtual std::string plugin_name() const override;
+
+                virtual void plugin_set_program_options(
+                        boost::program_options::options_description &cli,
+                        boost::program_options::options_description &cfg) override;
+
+                virtual void plugin_initialize(const boost::program_options::variables_map &options) override;
+
+                virtual void plugin_startup() override;
+
+                virtual void plugin_shutdown() override;
+
+                void on_applied_block(const chain::signed_block &b);
+
+                uint32_t _log_interval = 1200;
+                uint32_t _log_top = 10;
+
+                boost::signals2::scoped_connection _applied_block_conn;
+            };
+
+        }
+    }
+}
@@ -23,7 +23,7 @@ namespace steemit {
             void block_info_plugin::plugin_initialize(const boost::program_options::variables_map &options) {
                 chain::database &db = database();
 
-                _applied_block_conn = db.applied_block.connect([this](const chain::signed_block &b) { on_applied_block(b); });
+                _applied_block_conn = db.connect_profiled(db.applied_block, "block_info.applied_block", [this](const chain::signed_block &b) { on_applied_block(b); });
             }
 
             void block_info_plugin::plugin_startup() {
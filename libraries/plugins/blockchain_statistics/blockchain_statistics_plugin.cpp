@@ -399,9 +399,13 @@ namespace steemit {
                 ilog("chain_stats_plugin: plugin_initialize() begin");
                 chain::database &db = database();
 
-                db.applied_block.connect([&](const signed_block &b) { _my->on_block(b); });
-                db.pre_apply_operation.connect([&](const operation_notification &o) { _my->pre_operation(o); });
-                db.post_apply_operation.connect([&](const operation_notification &o) { _my->post_operation(o); });
+                db.connect_profiled(db.applied_block, "blockchain_statistics.applied_block", [&](const signed_block &b) { _my->on_block(b); });
+                db.subscribe_operations<
+                        protocol::delete_comment_operation, protocol::withdraw_vesting_operation
+                >(db.pre_apply_handlers(), "blockchain_statistics.pre_apply_operation", [&](const operation_notification &o) { _my->pre_operation(o); });
+                db.connect_profiled(db.post_apply_operation, "blockchain_statistics.post_apply_operation", chain::virtual_operations<
+                        protocol::interest_operation, protocol::author_reward_operation, protocol::curation_reward_operation, protocol::liquidity_reward_operation,
+                        protocol::fill_vesting_withdraw_operation, protocol::fill_order_operation, protocol::fill_convert_request_operation>(), [&](const operation_notification &o) { _my->post_operation(o); });
 
                 add_plugin_index<bucket_index>(db);
 
@@ -38,6 +38,8 @@ namespace steemit {
 
                 vector<account_reputation> get_account_reputations(string lower_bound_name, uint32_t limit) const;
 
+                vector<account_reputation> get_reputations(const std::set<string> &accounts) const;
+
                 steemit::app::application &app;
             };
 
@@ -266,6 +268,42 @@ namespace steemit {
                 return results;
             }
 
+            vector<account_reputation> follow_api_impl::get_reputations(const std::set<string> &accounts) const {
+                const auto &rep_idx = app.chain_database()->get_index<reputation_index>().indices().get<by_account>();
+
+                vector<account_reputation> results;
+                results.reserve(accounts.size());
+
+                if (accounts.empty()) {
+                    return results;
+                }
+
+                // Names are sorted, so the index is walked forward only: near names
+                // are reached by a few increments, distant ones by a new search
+                const uint32_t max_steps = 8;
+                auto itr = rep_idx.lower_bound(account_name_type(*accounts.begin()));
+
+                for (const auto &name : accounts) {
+                    account_name_type account(name);
+
+                    uint32_t steps = 0;
+                    while (itr != rep_idx.end() && itr->account < account && steps < max_steps) {
+                        ++itr;
+                        ++steps;
+                    }
+                    if (itr != rep_idx.end() && itr->account < account) {
+                        itr = rep_idx.lower_bound(account);
+                    }
+
+                    account_reputation rep;
+                    rep.account = name;
+                    rep.reputation = itr != rep_idx.end() && itr->account == account ? itr->reputation : 0;
+                    results.push_back(rep);
+                }
+
+                return results;
+            }
+
         } // detail
 
         follow_api::follow_api(const steemit::app::api_context &ctx) {
@@ -323,6 +361,12 @@ namespace steemit {
             });
         }
 
+        vector<account_reputation> follow_api::get_reputations(std::set<string> accounts) const {
+            return my->app.chain_database()->with_read_lock([&]() {
+                return my->get_reputations(accounts);
+            });
+        }
+
         vector<account_name_type> follow_api::get_reblogged_by(const string &author, const string &permlink) const {
             auto &db = *my->app.chain_database();
             return db.with_read_lock([&]() {
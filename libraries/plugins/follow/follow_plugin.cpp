@@ -358,8 +358,12 @@ namespace steemit {
                 chain::database &db = database();
                 my->plugin_initialize();
 
-                db.pre_apply_operation.connect([&](const operation_notification &o) { my->pre_operation(o); });
-                db.post_apply_operation.connect([&](const operation_notification &o) { my->post_operation(o); });
+                db.subscribe_operations<
+                        protocol::vote_operation, protocol::delete_comment_operation
+                >(db.pre_apply_handlers(), "follow.pre_apply_operation", [&](const operation_notification &o) { my->pre_operation(o); });
+                db.subscribe_operations<
+                        protocol::custom_json_operation, protocol::comment_operation, protocol::vote_operation
+                >(db.post_apply_handlers(), "follow.post_apply_operation", [&](const operation_notification &o) { my->post_operation(o); });
                 add_plugin_index<follow_index>(db);
                 add_plugin_index<feed_index>(db);
                 add_plugin_index<blog_index>(db);
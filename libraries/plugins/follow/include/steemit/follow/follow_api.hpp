@@ -96,6 +96,13 @@ namespace steemit {
 
             vector<account_reputation> get_account_reputations(string lower_bound_name, uint32_t limit = 1000) const;
 
+            /**
+             * Gets reputations of the given accounts in their order, accounts without
+             * reputation get zero. All accounts are resolved in one walk over the
+             * reputation index.
+             */
+            vector<account_reputation> get_reputations(std::set<string> accounts) const;
+
             /**
              * Gets list of accounts that have reblogged a particular post
              */
@@ -130,6 +137,7 @@ FC_API(steemit::follow::follow_api,
                 (get_blog_entries)
                 (get_blog)
                 (get_account_reputations)
+                (get_reputations)
                 (get_reblogged_by)
                 (get_blog_authors)
 )
@@ -176,7 +176,7 @@ namespace steemit {
                 ilog("market_history: plugin_initialize() begin");
                 chain::database &db = database();
 
-                db.post_apply_operation.connect([&](const operation_notification &o) { _my->update_market_histories(o); });
+                db.subscribe_operations<protocol::fill_order_operation>(db.post_apply_handlers(), "market_history.post_apply_operation", [&](const operation_notification &o) { _my->update_market_histories(o); });
                 add_plugin_index<bucket_index>(db);
                 add_plugin_index<order_history_index>(db);
 
@@ -571,6 +571,19 @@ namespace steemit {
             set<string> tags;
         };
 
+/**
+ * Lower cases the tags of a query and drops the universal empty tag, done once per
+ * query for @ref comment_has_any_tag
+ */
+        set<tag_name_type> normalize_tags(const set<string> &tags);
+
+/**
+ * Checks the normalized (lower case, limited) tags the plugin keeps for the comment
+ * in the tag index, so callers do not need to parse json_metadata.
+ * @param tags normalized by @ref normalize_tags
+ */
+        bool comment_has_any_tag(const database &db, comment_id_type comment, const set<tag_name_type> &tags);
+
 /**
  *  This plugin will scan all changes to posts and/or their meta data and
  *
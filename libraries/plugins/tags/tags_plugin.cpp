@@ -431,6 +431,31 @@ namespace steemit {
 
         } /// end detail namespace
 
+        set<tag_name_type> normalize_tags(const set<string> &tags) {
+            set<tag_name_type> result;
+            for (const auto &tag : tags) {
+                if (!tag.empty()) {
+                    result.insert(fc::to_lower(tag));
+                }
+            }
+            return result;
+        }
+
+        bool comment_has_any_tag(const database &db, comment_id_type comment, const set<tag_name_type> &tags) {
+            if (tags.empty()) {
+                return false;
+            }
+
+            const auto &idx = db.get_index<tag_index>().indices().get<by_comment>();
+            for (auto itr = idx.lower_bound(comment); itr != idx.end() && itr->comment == comment; ++itr) {
+                if (tags.find(itr->tag) != tags.end()) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
         tags_plugin::tags_plugin(application *app)
                 : plugin(app), my(new detail::tags_plugin_impl(*this)) {
             chain::database &db = database();
@@ -451,7 +476,12 @@ namespace steemit {
 
         void tags_plugin::plugin_initialize(const boost::program_options::variables_map &options) {
             ilog("Intializing tags plugin");
-            database().post_apply_operation.connect([&](const operation_notification &note) { my->on_operation(note); });
+            chain::database &db = database();
+            db.subscribe_operations<
+                    protocol::comment_operation, protocol::transfer_operation, protocol::vote_operation,
+                    protocol::delete_comment_operation, protocol::comment_reward_operation,
+                    protocol::comment_payout_update_operation
+            >(db.post_apply_handlers(), "tags.post_apply_operation", [&](const operation_notification &note) { my->on_operation(note); });
 
             app().register_api_factory<tag_api>("tag_api");
         }
@@ -172,7 +172,7 @@ void witness_plugin::plugin_startup() {
             elog("No witnesses configured! Please add witness names and private keys to configuration.");
         if (!_miners.empty()) {
             ilog("Starting mining...");
-            d.applied_block.connect([this](const protocol::signed_block &b) { this->on_applied_block(b); });
+            d.connect_profiled(d.applied_block, "witness.applied_block", [this](const protocol::signed_block &b) { this->on_applied_block(b); });
         } else {
             elog("No miners configured! Please add miner names and private keys to configuration.");
         }
@@ -0,0 +1,333 @@
+#ifdef STEEMIT_BUILD_TESTNET
+
+#include <boost/test/unit_test.hpp>
+
+#include <steemit/chain/account_object.hpp>
+#include <steemit/chain/comment_object.hpp>
+#include <steemit/chain/operation_notification.hpp>
+#include <steemit/protocol/steem_operations.hpp>
+
+#include <steemit/account_history/account_history_plugin.hpp>
+#include <steemit/market_history/market_history_plugin.hpp>
+#include <steemit/follow/follow_plugin.hpp>
+#include <steemit/tags/tags_plugin.hpp>
+
+#include "bench_fixture.hpp"
+
+using namespace steemit::chain;
+using namespace steemit::chain::bench;
+using namespace steemit::protocol;
+
+namespace {
+
+    /// Transfers between random accounts, one operation per transaction
+    void transfer_workload(bench_fixture &f, bench_sampler &trx_sampler, uint32_t count) {
+        bench_random rnd;
+        for (uint32_t i = 0; i < count; i++) {
+            transfer_operation op;
+            op.from = f.accounts[rnd.next(f.accounts.size())];
+            op.to = f.accounts[rnd.next(f.accounts.size())];
+            op.amount = asset(1 + rnd.next(1000), STEEM_SYMBOL);
+            op.memo = "bench";
+            trx_sampler.add(f.push_operation(op));
+        }
+    }
+
+    /**
+     * One root post and a reply chain by distinct authors, returns the
+     * author of the root post. Authors are shifted every round, so the
+     * same account does not comment more often than the chain allows.
+     */
+    std::string comment_tree_workload(bench_fixture &f, bench_sampler &trx_sampler, uint32_t round, uint32_t depth) {
+        const uint32_t first = round * (depth + 1);
+        const std::string root_author = f.accounts[first % f.accounts.size()];
+        const std::string root_permlink = "root-" + fc::to_string(round);
+
+        comment_operation root;
+        root.author = root_author;
+        root.permlink = root_permlink;
+        root.parent_permlink = "bench";
+        root.title = "Benchmark post " + fc::to_string(round);
+        root.body = std::string(2048, 'x');
+        root.json_metadata = "{\"tags\":[\"bench\",\"golos\",\"test\"]}";
+        trx_sampler.add(f.push_operation(root));
+
+        std::string parent_author = root_author;
+        std::string parent_permlink = root_permlink;
+        for (uint32_t i = 1; i <= depth; i++) {
+            comment_operation reply;
+            reply.author = f.accounts[(first + i) % f.accounts.size()];
+            reply.permlink = "re-" + fc::to_string(round) + "-" + fc::to_string(i);
+            reply.parent_author = parent_author;
+            reply.parent_permlink = parent_permlink;
+            reply.body = std::string(256, 'y');
+            reply.json_metadata = "{\"tags\":[\"bench\"]}";
+            trx_sampler.add(f.push_operation(reply));
+
+            parent_author = reply.author;
+            parent_permlink = reply.permlink;
+        }
+
+        return root_author;
+    }
+
+    /// Every bench account votes for the same post
+    void vote_storm_workload(bench_fixture &f, bench_sampler &trx_sampler, const std::string &author, const std::string &permlink, uint32_t voters) {
+        for (uint32_t i = 0; i < voters && i < f.accounts.size(); i++) {
+            vote_operation op;
+            op.voter = f.accounts[i];
+            op.author = author;
+            op.permlink = permlink;
+            op.weight = STEEMIT_100_PERCENT;
+            trx_sampler.add(f.push_operation(op));
+        }
+    }
+
+    /// Crossing limit orders, half of them are filled
+    void limit_order_workload(bench_fixture &f, bench_sampler &trx_sampler, uint32_t round, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            limit_order_create_operation op;
+            op.owner = f.accounts[i % f.accounts.size()];
+            op.orderid = round * count + i;
+            op.fill_or_kill = false;
+            op.expiration = f.db.head_block_time() + fc::hours(1);
+            if (i % 2 == 0) {
+                op.amount_to_sell = asset(1000 + i, STEEM_SYMBOL);
+                op.min_to_receive = asset(1000 + i, SBD_SYMBOL);
+            } else {
+                op.amount_to_sell = asset(1000 + i, SBD_SYMBOL);
+                op.min_to_receive = asset(1000 + i - 1, STEEM_SYMBOL);
+            }
+            trx_sampler.add(f.push_operation(op));
+        }
+    }
+
+    /**
+     * Runs the mixed workload used to compare plugins: transfers,
+     * comments, votes and limit orders in every block
+     */
+    void mixed_workload(bench_fixture &f, const std::string &prefix) {
+        signal_probe<void(const operation_notification &)> pre_probe(f.db.pre_apply_operation, prefix + ".pre_apply_operation");
+        signal_probe<void(const operation_notification &)> post_probe(f.db.post_apply_operation, prefix + ".post_apply_operation");
+        signal_probe<void(const signed_block &)> block_probe(f.db.applied_block, prefix + ".applied_block");
+
+        bench_sampler trx_sampler(prefix + ".push_transaction");
+        bench_sampler block_sampler(prefix + ".push_block");
+
+        for (uint32_t round = 0; round < BENCH_DEFAULT_ROUNDS; round++) {
+            transfer_workload(f, trx_sampler, 50);
+            auto author = comment_tree_workload(f, trx_sampler, round, 5);
+            vote_storm_workload(f, trx_sampler, author, "root-" + fc::to_string(round), 50);
+            limit_order_workload(f, trx_sampler, round, 20);
+            block_sampler.add(f.repush_head_block());
+        }
+
+        trx_sampler.report();
+        block_sampler.report();
+        pre_probe.report();
+        post_probe.report();
+        block_probe.report();
+    }
+
+    struct account_history_bench_fixture : public bench_fixture {
+        account_history_bench_fixture() {
+            enable_plugin<steemit::account_history::account_history_plugin>();
+            open_bench_database();
+        }
+    };
+
+    struct market_history_bench_fixture : public bench_fixture {
+        market_history_bench_fixture() {
+            enable_plugin<steemit::market_history::market_history_plugin>();
+            open_bench_database();
+        }
+    };
+
+    struct tags_bench_fixture : public bench_fixture {
+        tags_bench_fixture() {
+            enable_plugin<steemit::tags::tags_plugin>();
+            open_bench_database();
+        }
+    };
+
+    struct follow_bench_fixture : public bench_fixture {
+        follow_bench_fixture() {
+            enable_plugin<steemit::follow::follow_plugin>();
+            open_bench_database();
+        }
+    };
+
+}
+
+BOOST_FIXTURE_TEST_SUITE(apply_bench, core_bench_fixture)
+
+    BOOST_AUTO_TEST_CASE(transfers) {
+        try {
+            create_bench_accounts();
+
+            bench_sampler trx_sampler("push_transaction");
+            bench_sampler block_sampler("push_block");
+            bench_sampler generate_sampler("generate_block");
+
+            for (uint32_t round = 0; round < BENCH_DEFAULT_ROUNDS; round++) {
+                transfer_workload(*this, trx_sampler, 200);
+                block_sampler.add(repush_head_block());
+            }
+
+            for (uint32_t round = 0; round < BENCH_DEFAULT_ROUNDS; round++) {
+                bench_sampler ignored("ignored");
+                transfer_workload(*this, ignored, 200);
+                generate_sampler.measure([&]() { generate_block(); });
+            }
+
+            trx_sampler.report();
+            block_sampler.report();
+            generate_sampler.report();
+            validate_database();
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(comment_trees) {
+        try {
+            create_bench_accounts();
+
+            bench_sampler trx_sampler("push_transaction");
+            bench_sampler block_sampler("push_block");
+
+            for (uint32_t round = 0; round < BENCH_DEFAULT_ROUNDS; round++) {
+                comment_tree_workload(*this, trx_sampler, round, 20);
+                block_sampler.add(repush_head_block());
+
+                // STEEMIT_MIN_REPLY_INTERVAL limits replies of the same author
+                generate_blocks(db.head_block_time() + STEEMIT_MIN_REPLY_INTERVAL);
+            }
+
+            trx_sampler.report();
+            block_sampler.report();
+            validate_database();
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(vote_storms) {
+        try {
+            create_bench_accounts();
+
+            bench_sampler trx_sampler("push_transaction");
+            bench_sampler block_sampler("push_block");
+
+            for (uint32_t round = 0; round < BENCH_DEFAULT_ROUNDS; round++) {
+                bench_sampler ignored("ignored");
+                auto author = comment_tree_workload(*this, ignored, round, 0);
+                generate_block();
+
+                vote_storm_workload(*this, trx_sampler, author, "root-" + fc::to_string(round), accounts.size());
+                block_sampler.add(repush_head_block());
+
+                generate_blocks(db.head_block_time() + STEEMIT_MIN_VOTE_INTERVAL_SEC);
+            }
+
+            trx_sampler.report();
+            block_sampler.report();
+            validate_database();
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(limit_orders) {
+        try {
+            create_bench_accounts();
+            set_price_feed(price(ASSET("1.000 TESTS"), ASSET("1.000 TBD")));
+
+            bench_sampler trx_sampler("push_transaction");
+            bench_sampler block_sampler("push_block");
+
+            for (uint32_t round = 0; round < BENCH_DEFAULT_ROUNDS; round++) {
+                limit_order_workload(*this, trx_sampler, round, 200);
+                block_sampler.add(repush_head_block());
+            }
+
+            trx_sampler.report();
+            block_sampler.report();
+            validate_database();
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(payouts) {
+        try {
+            create_bench_accounts();
+            set_price_feed(price(ASSET("1.000 TESTS"), ASSET("1.000 TBD")));
+
+            bench_sampler block_sampler("cashout_block");
+
+            // Every round is created in its own block, so each of the
+            // following cashout blocks pays exactly one comment tree out
+            for (uint32_t round = 0; round < BENCH_DEFAULT_ROUNDS; round++) {
+                bench_sampler ignored("ignored");
+                auto author = comment_tree_workload(*this, ignored, round, 3);
+                vote_storm_workload(*this, ignored, author, "root-" + fc::to_string(round), 50);
+                generate_block();
+            }
+
+            auto cashout_time = db.get_comment(accounts[0], std::string("root-0")).cashout_time;
+            generate_blocks(cashout_time - STEEMIT_BLOCK_INTERVAL);
+
+            for (uint32_t round = 0; round < BENCH_DEFAULT_ROUNDS; round++) {
+                block_sampler.add(repush_head_block());
+            }
+
+            block_sampler.report();
+            validate_database();
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(core_signals) {
+        try {
+            create_bench_accounts();
+            mixed_workload(*this, "core");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(plugin_bench)
+
+    BOOST_FIXTURE_TEST_CASE(account_history, account_history_bench_fixture) {
+        try {
+            create_bench_accounts();
+            mixed_workload(*this, "account_history");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_FIXTURE_TEST_CASE(market_history, market_history_bench_fixture) {
+        try {
+            create_bench_accounts();
+            mixed_workload(*this, "market_history");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_FIXTURE_TEST_CASE(tags, tags_bench_fixture) {
+        try {
+            create_bench_accounts();
+            mixed_workload(*this, "tags");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_FIXTURE_TEST_CASE(follow, follow_bench_fixture) {
+        try {
+            create_bench_accounts();
+            mixed_workload(*this, "follow");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
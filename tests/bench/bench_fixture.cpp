@@ -0,0 +1,221 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/program_options.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
+
+#include <steemit/chain/steem_objects.hpp>
+
+#include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
+
+#include "bench_fixture.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace steemit {
+    namespace chain {
+        namespace bench {
+
+            bench_report &bench_report::instance() {
+                static bench_report report;
+                return report;
+            }
+
+            void bench_report::set_output(const std::string &path) {
+                _output = path;
+            }
+
+            void bench_report::record(const bench_result &result) {
+                _results.push_back(result);
+
+                if (_output.empty()) {
+                    std::cout << fc::json::to_string(result) << std::endl;
+                }
+            }
+
+            void bench_report::record_value(const std::string &name, double value) {
+                bench_result result;
+                result.suite = boost::unit_test::framework::current_test_case().p_name;
+                result.name = name;
+                result.samples = 1;
+                result.value = value;
+                record(result);
+            }
+
+            void bench_report::flush() {
+                if (_output.empty()) {
+                    return;
+                }
+
+                fc::json::save_to_file(_results, fc::path(_output));
+            }
+
+            bench_sampler::bench_sampler(const std::string &name, uint64_t units_per_sample)
+                    : _name(name), _units(units_per_sample) {
+            }
+
+            void bench_sampler::add(const fc::microseconds &sample) {
+                _samples.push_back(sample.count());
+            }
+
+            bench_result bench_sampler::result() const {
+                bench_result result;
+                result.suite = boost::unit_test::framework::current_test_case().p_name;
+                result.name = _name;
+                result.samples = static_cast<uint32_t>(_samples.size());
+                result.units = _units * _samples.size();
+
+                if (_samples.empty()) {
+                    return result;
+                }
+
+                std::vector<int64_t> sorted(_samples);
+                std::sort(sorted.begin(), sorted.end());
+
+                for (auto sample : sorted) {
+                    result.total_us += sample;
+                }
+
+                result.min_us = sorted.front();
+                result.max_us = sorted.back();
+                result.median_us = sorted[sorted.size() / 2];
+                result.avg_us = double(result.total_us) / sorted.size();
+
+                if (result.total_us > 0) {
+                    result.units_per_sec = double(result.units) * 1000000.0 / result.total_us;
+                }
+
+                return result;
+            }
+
+            void bench_sampler::report() const {
+                bench_report::instance().record(result());
+            }
+
+            bench_fixture::bench_fixture() {
+                int argc = boost::unit_test::framework::master_test_suite().argc;
+                char **argv = boost::unit_test::framework::master_test_suite().argv;
+                for (int i = 1; i < argc; i++) {
+                    const std::string arg = argv[i];
+                    if (arg == "--show-test-names") {
+                        std::cout << "running benchmark "
+                                  << boost::unit_test::framework::current_test_case().p_name
+                                  << std::endl;
+                    }
+                }
+
+                db_plugin = app.register_plugin<steemit::plugin::debug_node::debug_node_plugin>();
+                init_account_pub_key = init_account_priv_key.get_public_key();
+            }
+
+            bench_fixture::~bench_fixture() {
+                try {
+                    if (data_dir) {
+                        db.close();
+                    }
+                } FC_CAPTURE_AND_RETHROW()
+            }
+
+            void bench_fixture::open_bench_database() {
+                try {
+                    boost::program_options::variables_map options;
+
+                    data_dir = fc::temp_directory(graphene::utilities::temp_directory_path());
+                    db._log_hardforks = false;
+                    db.open(data_dir->path(), data_dir->path(), INITIAL_TEST_SUPPLY, BENCH_SHARED_MEM_SIZE, chainbase::database::read_write);
+
+                    for (auto &plugin : _plugins) {
+                        plugin->plugin_initialize(options);
+                    }
+
+                    db_plugin->logging = false;
+                    db_plugin->plugin_initialize(options);
+
+                    generate_block();
+                    db.set_hardfork(STEEMIT_NUM_HARDFORKS);
+                    generate_block();
+
+                    db_plugin->plugin_startup();
+                    vest(STEEMIT_INIT_MINER_NAME, 10000);
+
+                    // Fill up the rest of the required miners
+                    for (int i = STEEMIT_NUM_INIT_MINERS;
+                         i < STEEMIT_MAX_WITNESSES; i++) {
+                        account_create(STEEMIT_INIT_MINER_NAME +
+                                       fc::to_string(i), init_account_pub_key);
+                        fund(STEEMIT_INIT_MINER_NAME +
+                             fc::to_string(i), STEEMIT_MIN_PRODUCER_REWARD.amount.value);
+                        witness_create(STEEMIT_INIT_MINER_NAME +
+                                       fc::to_string(i), init_account_priv_key, "foo.bar", init_account_pub_key, STEEMIT_MIN_PRODUCER_REWARD.amount);
+                    }
+
+                    generate_block();
+                    validate_database();
+                } catch (const fc::exception &e) {
+                    edump((e.to_detail_string()));
+                    throw;
+                }
+            }
+
+            const std::vector<std::string> &bench_fixture::create_bench_accounts(uint32_t count) {
+                try {
+                    for (uint32_t i = 0; i < count; i++) {
+                        std::string name = "bench" + fc::to_string(accounts.size());
+                        account_create(name, init_account_pub_key);
+                        fund(name, asset(100000000, STEEM_SYMBOL));
+                        fund(name, asset(100000000, SBD_SYMBOL));
+                        vest(name, asset(10000000, STEEM_SYMBOL));
+                        accounts.push_back(name);
+
+                        // Keep blocks close to the real sized ones
+                        if (i % 50 == 49) {
+                            generate_block();
+                        }
+                    }
+
+                    generate_block();
+                    return accounts;
+                } FC_CAPTURE_AND_RETHROW((count))
+            }
+
+            signed_transaction bench_fixture::make_transaction(const operation &op) {
+                signed_transaction tx;
+                tx.operations.push_back(op);
+                tx.set_expiration(db.head_block_time() +
+                                  STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+                tx.sign(init_account_priv_key, db.get_chain_id());
+                return tx;
+            }
+
+            fc::microseconds bench_fixture::push_operation(const operation &op, uint32_t skip) {
+                auto tx = make_transaction(op);
+
+                auto start = fc::time_point::now();
+                db.push_transaction(tx, skip);
+                return fc::time_point::now() - start;
+            }
+
+            fc::microseconds bench_fixture::repush_head_block(uint32_t skip) {
+                try {
+                    generate_block();
+
+                    auto block = db.fetch_block_by_number(db.head_block_num());
+                    FC_ASSERT(block.valid());
+
+                    db.pop_block();
+                    db.clear_pending();
+
+                    auto start = fc::time_point::now();
+                    db.push_block(*block, skip | default_skip);
+                    return fc::time_point::now() - start;
+                } FC_CAPTURE_AND_RETHROW((skip))
+            }
+
+            core_bench_fixture::core_bench_fixture() {
+                open_bench_database();
+            }
+
+        }
+    }
+}
@@ -0,0 +1,233 @@
+#ifndef BENCH_FIXTURE_HPP
+#define BENCH_FIXTURE_HPP
+
+#include "../common/database_fixture.hpp"
+
+#include <fc/time.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <string>
+#include <vector>
+
+#define BENCH_SHARED_MEM_SIZE (1024 * 1024 * 256)
+
+/// Amount of accounts created by @ref bench_fixture::create_bench_accounts by default
+#define BENCH_DEFAULT_ACCOUNTS 200
+
+/// Amount of blocks every block-level measurement is repeated for
+#define BENCH_DEFAULT_ROUNDS 20
+
+namespace steemit {
+    namespace chain {
+        namespace bench {
+
+            /**
+             * @brief Machine-readable result of a single measurement
+             *
+             * Every duration is measured in microseconds, @ref units is
+             * the amount of processed items (operations, transactions
+             * or blocks) per sample. Results which aren't durations, like
+             * ratios or counters, have only @ref value set.
+             */
+            struct bench_result {
+                std::string suite;
+                std::string name;
+                uint32_t samples = 0;
+                uint64_t units = 0;
+                int64_t total_us = 0;
+                int64_t min_us = 0;
+                int64_t max_us = 0;
+                int64_t median_us = 0;
+                double avg_us = 0;
+                double units_per_sec = 0;
+                double value = 0;
+            };
+
+            /**
+             * @brief Collects results of all measurements and writes them
+             * when the benchmark run is finished
+             *
+             * Results are written as a JSON array into the file passed
+             * with "--bench-output <path>", or printed to stdout one JSON
+             * object per line if no output file was provided.
+             */
+            class bench_report {
+            public:
+                static bench_report &instance();
+
+                void set_output(const std::string &path);
+
+                void record(const bench_result &result);
+
+                /// Records a single value measured by the current test case
+                void record_value(const std::string &name, double value);
+
+                void flush();
+
+            private:
+                std::vector<bench_result> _results;
+                std::string _output;
+            };
+
+            /**
+             * @brief Accumulates timing samples of one measured action
+             */
+            class bench_sampler {
+            public:
+                bench_sampler(const std::string &name, uint64_t units_per_sample = 1);
+
+                template<typename Lambda>
+                void measure(Lambda &&action) {
+                    auto start = fc::time_point::now();
+                    action();
+                    add(fc::time_point::now() - start);
+                }
+
+                void add(const fc::microseconds &sample);
+
+                void set_units(uint64_t units_per_sample) {
+                    _units = units_per_sample;
+                }
+
+                bench_result result() const;
+
+                /// Records the result into @ref bench_report
+                void report() const;
+
+            private:
+                std::string _name;
+                uint64_t _units;
+                std::vector<int64_t> _samples;
+            };
+
+            /**
+             * @brief Measures time spent by all subscribers of a database signal
+             *
+             * Connects one slot in front of and one slot behind all
+             * existing subscribers, so the difference between them is the
+             * time spent by the plugins connected to the signal.
+             */
+            template<typename Signature>
+            class signal_probe {
+            public:
+                signal_probe(boost::signals2::signal<Signature> &sig, const std::string &name)
+                        : _sampler(name) {
+                    _front = sig.connect(front_slot{this}, boost::signals2::at_front);
+                    _back = sig.connect(back_slot{this}, boost::signals2::at_back);
+                }
+
+                void report() const {
+                    _sampler.report();
+                }
+
+            private:
+                struct front_slot {
+                    signal_probe *self;
+
+                    template<typename... Args>
+                    void operator()(Args &&...) const {
+                        self->_start_stamp = fc::time_point::now();
+                    }
+                };
+
+                struct back_slot {
+                    signal_probe *self;
+
+                    template<typename... Args>
+                    void operator()(Args &&...) const {
+                        self->_sampler.add(fc::time_point::now() - self->_start_stamp);
+                    }
+                };
+
+                bench_sampler _sampler;
+                fc::time_point _start_stamp;
+                boost::signals2::scoped_connection _front;
+                boost::signals2::scoped_connection _back;
+            };
+
+            /**
+             * @brief Base fixture for the block apply benchmarks
+             *
+             * Unlike @ref clean_database_fixture it lets derived fixtures
+             * register plugins before the database is opened, so the
+             * plugins' indexes are created, and uses a bigger shared
+             * memory file to fit the generated workloads.
+             */
+            struct bench_fixture : public database_fixture {
+                bench_fixture();
+
+                ~bench_fixture() override;
+
+                template<typename PluginType>
+                std::shared_ptr<PluginType> enable_plugin() {
+                    auto plugin = app.register_plugin<PluginType>();
+                    _plugins.push_back(plugin);
+                    return plugin;
+                }
+
+                /// Opens the database, initializes registered plugins and creates initial witnesses
+                void open_bench_database();
+
+                /// Creates @ref count accounts controlled by init_account_priv_key, funds them with STEEM and SBD and vests
+                const std::vector<std::string> &create_bench_accounts(uint32_t count = BENCH_DEFAULT_ACCOUNTS);
+
+                /// Builds a signed single operation transaction expiring at the maximal allowed time
+                signed_transaction make_transaction(const operation &op);
+
+                /// Builds and pushes a transaction, returning time spent in push_transaction
+                fc::microseconds push_operation(const operation &op, uint32_t skip = 0);
+
+                /**
+                 * Generates a block including all pending transactions, pops
+                 * it and pushes it back. Returns time spent in push_block, so
+                 * the measurement includes neither transaction signing nor
+                 * generation.
+                 */
+                fc::microseconds repush_head_block(uint32_t skip = 0);
+
+                std::vector<std::string> accounts;
+
+            private:
+                std::vector<std::shared_ptr<steemit::app::abstract_plugin>> _plugins;
+            };
+
+            /// Fixture without any plugins besides the debug node one
+            struct core_bench_fixture : public bench_fixture {
+                core_bench_fixture();
+            };
+
+            /**
+             * @brief Simple deterministic generator used to build workloads
+             *
+             * std::rand is seeded by time in main, but the benchmark
+             * workloads must be the same between runs to be comparable.
+             */
+            class bench_random {
+            public:
+                explicit bench_random(uint64_t seed = 0x9e3779b97f4a7c15ull)
+                        : _state(seed) {
+                }
+
+                uint64_t next() {
+                    _state ^= _state << 13;
+                    _state ^= _state >> 7;
+                    _state ^= _state << 17;
+                    return _state;
+                }
+
+                uint32_t next(uint32_t bound) {
+                    return static_cast<uint32_t>(next() % bound);
+                }
+
+            private:
+                uint64_t _state;
+            };
+
+        }
+    }
+}
+
+FC_REFLECT(steemit::chain::bench::bench_result,
+        (suite)(name)(samples)(units)(total_us)(min_us)(max_us)(median_us)(avg_us)(units_per_sec)(value))
+
+#endif
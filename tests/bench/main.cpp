@@ -0,0 +1,41 @@
+#include <cstdlib>
+#include <iostream>
+
+#ifdef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE chain_bench
+#include <boost/test/unit_test.hpp>
+#else
+#include <boost/test/included/unit_test.hpp>
+#endif
+
+#include "bench_fixture.hpp"
+
+/**
+ * Writes collected results once all benchmarks are finished
+ */
+struct bench_report_flusher {
+    bench_report_flusher() {
+        int argc = boost::unit_test::framework::master_test_suite().argc;
+        char **argv = boost::unit_test::framework::master_test_suite().argv;
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            if (arg == "--bench-output" && i + 1 < argc) {
+                steemit::chain::bench::bench_report::instance().set_output(argv[++i]);
+            }
+        }
+    }
+
+    ~bench_report_flusher() {
+        try {
+            steemit::chain::bench::bench_report::instance().flush();
+        } catch (const fc::exception &e) {
+            edump((e.to_detail_string()));
+        }
+    }
+};
+
+BOOST_GLOBAL_FIXTURE(bench_report_flusher);
+
+boost::unit_test::test_suite *init_unit_test_suite(int argc, char *argv[]) {
+    return nullptr;
+}
@@ -0,0 +1,102 @@
+#ifdef STEEMIT_BUILD_TESTNET
+
+#include <boost/test/unit_test.hpp>
+
+#include "bench_fixture.hpp"
+#include "network_simulation.hpp"
+
+#include <algorithm>
+
+using namespace steemit::chain;
+using namespace steemit::chain::bench;
+
+namespace {
+
+    /// Config with the amount of nodes, slots and the seed overridable by "--sim-nodes", "--sim-blocks" and "--sim-seed"
+    network_simulation_config make_config(const fc::microseconds &latency, uint64_t bandwidth = 0, double drop_rate = 0,
+            network_topology topology = full_mesh) {
+        network_simulation_config config;
+        config.topology = topology;
+        config.link.latency = latency;
+        config.link.bandwidth = bandwidth;
+        config.link.drop_rate = drop_rate;
+
+        int argc = boost::unit_test::framework::master_test_suite().argc;
+        char **argv = boost::unit_test::framework::master_test_suite().argv;
+        for (int i = 1; i + 1 < argc; i++) {
+            const std::string arg = argv[i];
+            if (arg == "--sim-nodes") {
+                config.nodes = std::stoul(argv[++i]);
+            } else if (arg == "--sim-blocks") {
+                config.blocks = std::stoul(argv[++i]);
+            } else if (arg == "--sim-seed") {
+                config.random_seed = std::stoull(argv[++i]);
+            }
+        }
+        return config;
+    }
+
+    void run_simulation(const network_simulation_config &config, const std::string &name) {
+        network_simulation simulation(config);
+        simulation.run();
+        simulation.report(name);
+    }
+
+}
+
+BOOST_AUTO_TEST_SUITE(network_bench)
+
+    BOOST_AUTO_TEST_CASE(ideal_links) {
+        try {
+            run_simulation(make_config(fc::microseconds(0)), "ideal_links");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(datacenter) {
+        try {
+            run_simulation(make_config(fc::milliseconds(20)), "datacenter");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(intercontinental) {
+        try {
+            run_simulation(make_config(fc::milliseconds(250), 1024 * 1024), "intercontinental");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(lossy) {
+        try {
+            run_simulation(make_config(fc::milliseconds(100), 0, 0.05), "lossy");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(slow_links) {
+        try {
+            run_simulation(make_config(fc::seconds(1), 128 * 1024), "slow_links");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(ring_topology) {
+        try {
+            run_simulation(make_config(fc::milliseconds(100), 0, 0, ring), "ring_topology");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(random_topology) {
+        try {
+            network_simulation_config config = make_config(fc::milliseconds(100), 1024 * 1024, 0.01, random_graph);
+            config.nodes = std::max<uint32_t>(config.nodes, 8);
+            run_simulation(config, "random_topology");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
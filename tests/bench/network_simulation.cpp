@@ -0,0 +1,722 @@
+#ifdef STEEMIT_BUILD_TESTNET
+
+#include <graphene/net/exceptions.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <steemit/chain/database_exceptions.hpp>
+#include <steemit/chain/witness_objects.hpp>
+#include <steemit/protocol/steem_operations.hpp>
+
+#include <fc/thread/thread.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/range/adaptor/reversed.hpp>
+#include <boost/range/algorithm/reverse.hpp>
+
+#include "bench_fixture.hpp"
+#include "network_simulation.hpp"
+
+#include <algorithm>
+
+namespace steemit {
+    namespace chain {
+        namespace bench {
+
+            using graphene::net::block_message;
+            using graphene::net::trx_message;
+
+            simulated_link::simulated_link(const fc::ip::endpoint &destination, const simulated_link_parameters &parameters,
+                    uint64_t random_seed, simulated_link_statistics &statistics)
+                    : _destination(destination),
+                      _parameters(parameters),
+                      _random_state(random_seed ? random_seed : 1),
+                      _statistics(statistics) {
+                _server.listen(fc::ip::endpoint(fc::ip::address("127.0.0.1"), 0));
+                _to_destination.from = &_incoming;
+                _to_destination.to = &_outgoing;
+                _from_destination.from = &_outgoing;
+                _from_destination.to = &_incoming;
+                _accept_done = fc::async([this]() { accept(); }, "simulated_link_accept");
+            }
+
+            simulated_link::~simulated_link() {
+                close();
+                for (fc::future<void> *task : {&_accept_done,
+                                               &_to_destination.read_done, &_to_destination.write_done,
+                                               &_from_destination.read_done, &_from_destination.write_done}) {
+                    try {
+                        if (task->valid() && !task->ready()) {
+                            task->cancel_and_wait("~simulated_link()");
+                        }
+                    } catch (const fc::exception &) {
+                    }
+                }
+            }
+
+            fc::ip::endpoint simulated_link::endpoint() const {
+                return fc::ip::endpoint(fc::ip::address("127.0.0.1"), _server.get_port());
+            }
+
+            void simulated_link::accept() {
+                try {
+                    _server.accept(_incoming);
+                    _server.close();
+                    _outgoing.connect_to(_destination);
+                } catch (const fc::canceled_exception &) {
+                    throw;
+                } catch (const fc::exception &e) {
+                    wlog("simulated link to ${destination} failed to connect: ${e}", ("destination", _destination)("e", e.to_string()));
+                    close();
+                    return;
+                }
+
+                for (direction *dir : {&_to_destination, &_from_destination}) {
+                    dir->read_done = fc::async([this, dir]() { read_loop(*dir); }, "simulated_link_read");
+                    dir->write_done = fc::async([this, dir]() { write_loop(*dir); }, "simulated_link_write");
+                }
+            }
+
+            bool simulated_link::lose_chunk() {
+                if (_parameters.drop_rate <= 0) {
+                    return false;
+                }
+                // xorshift64*, the sequence depends only on the seed
+                _random_state ^= _random_state >> 12;
+                _random_state ^= _random_state << 25;
+                _random_state ^= _random_state >> 27;
+                double random = double((_random_state * 0x2545f4914f6cdd1dull) >> 11) / double(uint64_t(1) << 53);
+                return random < _parameters.drop_rate;
+            }
+
+            void simulated_link::read_loop(direction &dir) {
+                std::vector<char> buffer(64 * 1024);
+                try {
+                    while (!_closed) {
+                        size_t bytes_read = dir.from->readsome(buffer.data(), buffer.size());
+
+                        fc::time_point send_time = std::max(fc::time_point::now(), dir.link_free_time);
+                        if (_parameters.bandwidth) {
+                            send_time += fc::microseconds(bytes_read * 1000000 / _parameters.bandwidth);
+                        }
+                        dir.link_free_time = send_time;
+
+                        fc::time_point arrival_time = send_time + _parameters.latency;
+                        if (lose_chunk()) {
+                            arrival_time += _parameters.latency + _parameters.latency +
+                                            fc::milliseconds(NETWORK_SIM_RETRANSMISSION_TIMEOUT_MS);
+                            ++_statistics.retransmissions;
+                        }
+                        // the stream is ordered, nothing overtakes a retransmitted chunk
+                        arrival_time = std::max(arrival_time, dir.last_arrival_time);
+                        dir.last_arrival_time = arrival_time;
+
+                        dir.chunks.emplace_back(arrival_time, std::vector<char>(buffer.begin(), buffer.begin() + bytes_read));
+                        if (dir.chunk_queued && !dir.chunk_queued->ready()) {
+                            dir.chunk_queued->set_value();
+                        }
+                    }
+                } catch (const fc::canceled_exception &) {
+                    throw;
+                } catch (const fc::exception &) {
+                    // the node closed the connection
+                }
+                close();
+            }
+
+            void simulated_link::write_loop(direction &dir) {
+                try {
+                    while (!_closed) {
+                        if (dir.chunks.empty()) {
+                            dir.chunk_queued = fc::promise<void>::ptr(new fc::promise<void>("simulated_link chunk queued"));
+                            dir.chunk_queued->wait();
+                            continue;
+                        }
+
+                        fc::time_point arrival_time = dir.chunks.front().first;
+                        if (arrival_time > fc::time_point::now()) {
+                            fc::usleep(arrival_time - fc::time_point::now());
+                        }
+                        const std::vector<char> &chunk = dir.chunks.front().second;
+                        dir.to->write(chunk.data(), chunk.size());
+                        dir.to->flush();
+                        _statistics.bytes_relayed += chunk.size();
+                        dir.chunks.pop_front();
+                    }
+                } catch (const fc::canceled_exception &) {
+                    throw;
+                } catch (const fc::exception &) {
+                    // the node closed the connection
+                }
+                close();
+            }
+
+            void simulated_link::close() {
+                if (_closed) {
+                    return;
+                }
+                _closed = true;
+
+                for (direction *dir : {&_to_destination, &_from_destination}) {
+                    if (dir->chunk_queued && !dir->chunk_queued->ready()) {
+                        dir->chunk_queued->set_value();
+                    }
+                }
+                for (fc::tcp_socket *socket : {&_incoming, &_outgoing}) {
+                    try {
+                        socket->close();
+                    } catch (const fc::exception &) {
+                    }
+                }
+                try {
+                    _server.close();
+                } catch (const fc::exception &) {
+                }
+            }
+
+            simulated_node::simulated_node(network_simulation &simulation, uint32_t index)
+                    : index(index),
+                      _simulation(simulation),
+                      _data_dir(graphene::utilities::temp_directory_path()) {
+                db._log_hardforks = false;
+                db.open(_data_dir.path(), _data_dir.path(), INITIAL_TEST_SUPPLY, NETWORK_SIM_SHARED_MEM_SIZE, chainbase::database::read_write);
+            }
+
+            simulated_node::~simulated_node() {
+                try {
+                    if (p2p) {
+                        p2p->close();
+                        p2p.reset();
+                    }
+                    db.close();
+                } FC_CAPTURE_AND_LOG((index))
+            }
+
+            void simulated_node::start(uint32_t links) {
+                p2p = std::make_shared<graphene::net::node>("network_simulation");
+                p2p->load_configuration(_data_dir.path() / "p2p");
+                p2p->set_node_delegate(this);
+
+                // the topology is fixed: nodes connect only to the links they're given and don't advertise
+                // each other, which would let them connect directly
+                fc::mutable_variant_object parameters;
+                parameters["desired_number_of_connections"] = 0;
+                parameters["maximum_number_of_connections"] = std::max<uint32_t>(links, 1);
+                p2p->set_advanced_node_parameters(parameters);
+                p2p->disable_peer_advertising();
+
+                p2p->listen_on_endpoint(fc::ip::endpoint(fc::ip::address("127.0.0.1"), 0), false);
+                p2p->listen_to_p2p_network();
+                p2p->sync_from(graphene::net::item_id(graphene::net::block_message_type, db.head_block_id()), std::vector<uint32_t>());
+                p2p->connect_to_p2p_network();
+            }
+
+            bool simulated_node::has_item(const graphene::net::item_id &id) {
+                if (id.item_type == graphene::net::block_message_type) {
+                    return db.is_known_block(id.item_hash);
+                }
+                return db.is_known_transaction(id.item_hash);
+            }
+
+            bool simulated_node::handle_block(const block_message &blk_msg, bool sync_mode,
+                    std::vector<fc::uint160_t> &contained_transaction_message_ids) {
+                try {
+                    bool switched_forks = db.push_block(blk_msg.block);
+                    _simulation.on_block_accepted(*this, blk_msg.block);
+                    return switched_forks;
+                } catch (const unlinkable_block_exception &e) {
+                    // the node fetches the missing blocks from the peer with the sync protocol
+                    ++_simulation._unlinkable_blocks;
+                    FC_THROW_EXCEPTION(graphene::net::unlinkable_block_exception, "Error when pushing block:\n${e}", ("e", e.to_detail_string()));
+                }
+            }
+
+            void simulated_node::handle_transaction(const trx_message &trx_msg) {
+                db.push_transaction(trx_msg.trx);
+            }
+
+            bool simulated_node::is_included_block(const block_id_type &block_id) {
+                return db.get_block_id_for_num(block_header::num_from_id(block_id)) == block_id;
+            }
+
+            std::vector<graphene::net::item_hash_t> simulated_node::get_block_ids(const std::vector<graphene::net::item_hash_t> &blockchain_synopsis,
+                    uint32_t &remaining_item_count, uint32_t limit) {
+                // same as the application's delegate
+                std::vector<graphene::net::item_hash_t> result;
+                remaining_item_count = 0;
+                if (db.head_block_num() == 0) {
+                    return result;
+                }
+
+                block_id_type last_known_block_id;
+                if (!blockchain_synopsis.empty() &&
+                    !(blockchain_synopsis.size() == 1 && blockchain_synopsis[0] == block_id_type())) {
+                    bool found_a_block_in_synopsis = false;
+                    for (const graphene::net::item_hash_t &block_id_in_synopsis : boost::adaptors::reverse(blockchain_synopsis)) {
+                        if (block_id_in_synopsis == block_id_type() ||
+                            (db.is_known_block(block_id_in_synopsis) && is_included_block(block_id_in_synopsis))) {
+                            last_known_block_id = block_id_in_synopsis;
+                            found_a_block_in_synopsis = true;
+                            break;
+                        }
+                    }
+                    if (!found_a_block_in_synopsis) {
+                        FC_THROW_EXCEPTION(graphene::net::peer_is_on_an_unreachable_fork, "Unable to provide a list of blocks starting at any of the blocks in peer's synopsis");
+                    }
+                }
+
+                for (uint32_t num = block_header::num_from_id(last_known_block_id);
+                     num <= db.head_block_num() && result.size() < limit; ++num) {
+                    if (num > 0) {
+                        result.push_back(db.get_block_id_for_num(num));
+                    }
+                }
+                if (!result.empty() && block_header::num_from_id(result.back()) < db.head_block_num()) {
+                    remaining_item_count = db.head_block_num() - block_header::num_from_id(result.back());
+                }
+                return result;
+            }
+
+            graphene::net::message simulated_node::get_item(const graphene::net::item_id &id) {
+                if (id.item_type == graphene::net::block_message_type) {
+                    auto block = db.fetch_block_by_id(id.item_hash);
+                    FC_ASSERT(block.valid(), "Unknown item ${id}", ("id", id));
+                    return block_message(*block);
+                }
+                return trx_message(db.get_recent_transaction(id.item_hash));
+            }
+
+            std::vector<signed_transaction> simulated_node::get_pending_transactions() {
+                return db.pending_transactions();
+            }
+
+            std::vector<std::vector<char>> simulated_node::get_packed_blocks(uint32_t first_block_num, uint32_t limit, uint32_t max_bytes) {
+                return db.fetch_packed_blocks(first_block_num, limit, max_bytes);
+            }
+
+            std::vector<graphene::net::item_hash_t> simulated_node::get_blockchain_synopsis(const graphene::net::item_hash_t &reference_point,
+                    uint32_t number_of_blocks_after_reference_point) {
+                // same as the application's delegate
+                std::vector<graphene::net::item_hash_t> synopsis;
+                uint32_t high_block_num;
+                uint32_t non_fork_high_block_num;
+                uint32_t low_block_num = db.last_non_undoable_block_num();
+                std::vector<block_id_type> fork_history;
+
+                if (reference_point != graphene::net::item_hash_t()) {
+                    if (is_included_block(reference_point)) {
+                        high_block_num = block_header::num_from_id(reference_point);
+                        non_fork_high_block_num = high_block_num;
+                        low_block_num = std::min(low_block_num, high_block_num);
+                    } else {
+                        // returns the reference point first and the common ancestor with the preferred chain last
+                        fork_history = db.get_block_ids_on_fork(reference_point);
+                        block_id_type last_non_fork_block = fork_history.back();
+                        fork_history.pop_back();
+                        boost::reverse(fork_history);
+
+                        non_fork_high_block_num = last_non_fork_block == block_id_type() ? 0 : block_header::num_from_id(last_non_fork_block);
+                        high_block_num = non_fork_high_block_num + fork_history.size();
+                        if (non_fork_high_block_num < low_block_num) {
+                            FC_THROW_EXCEPTION(graphene::net::block_older_than_undo_history, "Peer is are on a fork I'm unable to switch to");
+                        }
+                    }
+                } else {
+                    high_block_num = db.head_block_num();
+                    non_fork_high_block_num = high_block_num;
+                    if (high_block_num == 0) {
+                        return synopsis;
+                    }
+                }
+
+                if (low_block_num == 0) {
+                    low_block_num = 1;
+                }
+
+                uint32_t true_high_block_num = high_block_num + number_of_blocks_after_reference_point;
+                do {
+                    if (low_block_num <= non_fork_high_block_num) {
+                        synopsis.push_back(db.get_block_id_for_num(low_block_num));
+                    } else {
+                        synopsis.push_back(fork_history[low_block_num - non_fork_high_block_num - 1]);
+                    }
+                    low_block_num += (true_high_block_num - low_block_num + 2) / 2;
+                } while (low_block_num <= high_block_num);
+
+                return synopsis;
+            }
+
+            uint32_t simulated_node::get_block_number(const graphene::net::item_hash_t &block_id) {
+                return block_header::num_from_id(block_id);
+            }
+
+            fc::time_point_sec simulated_node::get_block_time(const graphene::net::item_hash_t &block_id) {
+                auto block = db.fetch_block_by_id(block_id);
+                return block.valid() ? block->timestamp : fc::time_point_sec::min();
+            }
+
+            fc::time_point_sec simulated_node::get_blockchain_now() {
+                return fc::time_point_sec(_simulation.now());
+            }
+
+            graphene::net::item_hash_t simulated_node::get_head_block_id() const {
+                return db.head_block_id();
+            }
+
+            void simulated_node::error_encountered(const std::string &message, const fc::oexception &error) {
+                elog("node ${n}: ${message}", ("n", index)("message", message));
+            }
+
+            network_simulation::network_simulation(const network_simulation_config &config)
+                    : _config(config),
+                      _key(STEEMIT_INIT_PRIVATE_KEY),
+                      _random_state(config.random_seed ? config.random_seed : 1) {
+                FC_ASSERT(config.nodes > 0);
+                for (uint32_t i = 0; i < config.nodes; i++) {
+                    _nodes.emplace_back(new simulated_node(*this, i));
+                }
+            }
+
+            network_simulation::~network_simulation() {
+                // stop the p2p nodes first, they may still call into the databases
+                for (auto &node : _nodes) {
+                    try {
+                        if (node->p2p) {
+                            node->p2p->close();
+                            node->p2p.reset();
+                        }
+                    } FC_CAPTURE_AND_LOG((node->index))
+                }
+                _links.clear();
+                _nodes.clear();
+            }
+
+            uint64_t network_simulation::random() {
+                _random_state ^= _random_state << 13;
+                _random_state ^= _random_state >> 7;
+                _random_state ^= _random_state << 17;
+                return _random_state;
+            }
+
+            fc::time_point network_simulation::now() const {
+                if (_real_start == fc::time_point()) {
+                    return _chain_start;
+                }
+                return _chain_start + (fc::time_point::now() - _real_start);
+            }
+
+            uint32_t network_simulation::witness_node(const account_name_type &witness) const {
+                std::string name = witness;
+                std::string suffix = name.substr(std::string(STEEMIT_INIT_MINER_NAME).size());
+                return suffix.empty() ? 0 : std::stoul(suffix) % _nodes.size();
+            }
+
+            void network_simulation::push_setup_block() {
+                auto &db = _nodes.front()->db;
+                auto slot_time = db.get_slot_time(1);
+                auto block = db.generate_block(slot_time, db.get_scheduled_witness(1), _key, database::skip_nothing);
+
+                for (size_t i = 1; i < _nodes.size(); i++) {
+                    _nodes[i]->db.push_block(block, database::skip_witness_signature |
+                                                    database::skip_transaction_signatures);
+                }
+            }
+
+            void network_simulation::push_setup_transaction(const operation &op) {
+                auto &db = _nodes.front()->db;
+                signed_transaction tx;
+                tx.operations.push_back(op);
+                tx.set_expiration(db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+                tx.sign(_key, db.get_chain_id());
+                db.push_transaction(tx);
+            }
+
+            std::set<std::pair<uint32_t, uint32_t>> network_simulation::make_topology() {
+                std::set<std::pair<uint32_t, uint32_t>> links;
+                const uint32_t n = _nodes.size();
+                auto link = [&](uint32_t a, uint32_t b) {
+                    if (a != b) {
+                        links.emplace(std::min(a, b), std::max(a, b));
+                    }
+                };
+
+                if (_config.topology == full_mesh) {
+                    for (uint32_t a = 0; a < n; a++) {
+                        for (uint32_t b = a + 1; b < n; b++) {
+                            link(a, b);
+                        }
+                    }
+                    return links;
+                }
+
+                // the ring keeps every topology connected
+                for (uint32_t a = 0; a < n; a++) {
+                    link(a, (a + 1) % n);
+                }
+
+                if (_config.topology == random_graph) {
+                    std::vector<uint32_t> degrees(n, 0);
+                    for (const auto &pair : links) {
+                        ++degrees[pair.first];
+                        ++degrees[pair.second];
+                    }
+                    const uint32_t degree = std::min(_config.degree, n - 1);
+                    for (uint32_t a = 0; a < n; a++) {
+                        // give up on a node whose candidates are all taken after a few tries
+                        for (uint32_t attempt = 0; degrees[a] < degree && attempt < 8 * n; attempt++) {
+                            uint32_t b = random() % n;
+                            if (b == a || links.count(std::make_pair(std::min(a, b), std::max(a, b)))) {
+                                continue;
+                            }
+                            link(a, b);
+                            ++degrees[a];
+                            ++degrees[b];
+                        }
+                    }
+                }
+                return links;
+            }
+
+            void network_simulation::connect_nodes() {
+                std::set<std::pair<uint32_t, uint32_t>> topology = make_topology();
+                std::vector<uint32_t> degrees(_nodes.size(), 0);
+                for (const auto &pair : topology) {
+                    ++degrees[pair.first];
+                    ++degrees[pair.second];
+                }
+
+                for (auto &node : _nodes) {
+                    node->start(degrees[node->index]);
+                }
+
+                for (const auto &pair : topology) {
+                    _links.emplace_back(new simulated_link(_nodes[pair.second]->p2p->get_actual_listening_endpoint(),
+                            _config.link, random(), _link_statistics));
+                    _nodes[pair.first]->p2p->connect_to_endpoint(_links.back()->endpoint());
+                }
+
+                fc::time_point deadline = fc::time_point::now() + fc::seconds(NETWORK_SIM_CONNECT_TIMEOUT_SECONDS);
+                for (auto &node : _nodes) {
+                    while (node->p2p->get_connection_count() < degrees[node->index] &&
+                           fc::time_point::now() < deadline) {
+                        fc::usleep(fc::milliseconds(50));
+                    }
+                    if (node->p2p->get_connection_count() < degrees[node->index]) {
+                        wlog("node ${n} has only ${count} of ${links} connections",
+                                ("n", node->index)("count", node->p2p->get_connection_count())("links", degrees[node->index]));
+                    }
+                }
+            }
+
+            void network_simulation::run() {
+                try {
+                    // setup happens outside of the network, every node applies the same blocks
+                    push_setup_block();
+                    for (auto &node : _nodes) {
+                        node->db.set_hardfork(STEEMIT_NUM_HARDFORKS);
+                    }
+                    push_setup_block();
+
+                    transfer_to_vesting_operation vest;
+                    vest.from = STEEMIT_INIT_MINER_NAME;
+                    vest.amount = asset(10000, STEEM_SYMBOL);
+                    push_setup_transaction(vest);
+
+                    // every witness also sends transactions, they all use the same key
+                    for (uint32_t i = STEEMIT_NUM_INIT_MINERS; i < STEEMIT_MAX_WITNESSES; i++) {
+                        std::string name = STEEMIT_INIT_MINER_NAME + fc::to_string(i);
+
+                        account_create_operation create;
+                        create.new_account_name = name;
+                        create.creator = STEEMIT_INIT_MINER_NAME;
+                        create.fee = asset(100, STEEM_SYMBOL);
+                        create.owner = authority(1, public_key_type(_key.get_public_key()), 1);
+                        create.active = create.owner;
+                        create.posting = create.owner;
+                        create.memo_key = _key.get_public_key();
+                        push_setup_transaction(create);
+
+                        transfer_operation fund;
+                        fund.from = STEEMIT_INIT_MINER_NAME;
+                        fund.to = name;
+                        fund.amount = asset(100000000, STEEM_SYMBOL);
+                        push_setup_transaction(fund);
+
+                        transfer_to_vesting_operation vest_account;
+                        vest_account.from = name;
+                        vest_account.amount = asset(10000000, STEEM_SYMBOL);
+                        push_setup_transaction(vest_account);
+
+                        witness_update_operation witness;
+                        witness.owner = name;
+                        witness.url = "simulated";
+                        witness.block_signing_key = _key.get_public_key();
+                        witness.fee = asset(STEEMIT_MIN_PRODUCER_REWARD.amount, STEEM_SYMBOL);
+                        push_setup_transaction(witness);
+
+                        _accounts.push_back(name);
+                    }
+                    push_setup_block();
+
+                    // let the new witnesses get into the schedule
+                    for (uint32_t i = 0; i < 2 * STEEMIT_MAX_WITNESSES; i++) {
+                        push_setup_block();
+                    }
+
+                    _chain_start = _nodes.front()->db.head_block_time();
+                    connect_nodes();
+                    _real_start = fc::time_point::now();
+
+                    const fc::microseconds interval = fc::seconds(STEEMIT_BLOCK_INTERVAL);
+                    for (uint32_t i = 0; i < _config.blocks; i++) {
+                        fc::time_point slot_start = _real_start + fc::microseconds(interval.count() * i);
+                        for (uint32_t t = 0; t < _config.transactions_per_block; t++) {
+                            fc::usleep(slot_start + fc::microseconds(interval.count() * (t + 1) / (_config.transactions_per_block + 1)) -
+                                       fc::time_point::now());
+                            submit_transaction();
+                        }
+
+                        fc::usleep(slot_start + interval - fc::time_point::now());
+                        produce_blocks(fc::time_point_sec(_chain_start + fc::microseconds(interval.count() * (i + 1))));
+                    }
+
+                    // let the last blocks reach everyone
+                    fc::time_point deadline = fc::time_point::now() + fc::seconds(NETWORK_SIM_SETTLE_TIMEOUT_SECONDS);
+                    do {
+                        fc::usleep(fc::milliseconds(100));
+                    } while (!nodes_in_consensus() && fc::time_point::now() < deadline);
+                } FC_CAPTURE_AND_RETHROW((_config.nodes)(_config.blocks))
+            }
+
+            void network_simulation::submit_transaction() {
+                auto &node = *_nodes[random() % _nodes.size()];
+                transfer_operation op;
+                op.from = _accounts[random() % _accounts.size()];
+                op.to = _accounts[random() % _accounts.size()];
+                op.amount = asset(1, STEEM_SYMBOL);
+                op.memo = "sim-" + fc::to_string(_transaction_counter++);
+
+                signed_transaction tx;
+                tx.operations.push_back(op);
+                tx.set_expiration(node.db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+                tx.sign(_key, node.db.get_chain_id());
+
+                try {
+                    node.db.push_transaction(tx);
+                } catch (const fc::exception &) {
+                    ++_rejected_transactions;
+                    return;
+                }
+
+                _submitted_transactions[tx.id()] = fc::time_point::now();
+                node.p2p->broadcast_transaction(tx);
+            }
+
+            void network_simulation::produce_blocks(const fc::time_point_sec &slot_time) {
+                for (auto &node : _nodes) {
+                    auto slot = node->db.get_slot_at_time(slot_time);
+                    if (slot == 0) {
+                        continue;
+                    }
+
+                    auto witness = node->db.get_scheduled_witness(slot);
+                    if (witness_node(witness) != node->index) {
+                        continue;
+                    }
+
+                    signed_block block;
+                    try {
+                        block = node->db.generate_block(slot_time, witness, _key, database::skip_nothing);
+                    } catch (const fc::exception &e) {
+                        wlog("node ${n} failed to produce a block: ${e}", ("n", node->index)("e", e.to_string()));
+                        continue;
+                    }
+
+                    auto &produced = _blocks[block.id()];
+                    produced.id = block.id();
+                    produced.produced = fc::time_point::now();
+                    produced.producer = node->index;
+                    produced.accepted[node->index] = produced.produced;
+
+                    node->p2p->broadcast(block_message(block));
+                }
+            }
+
+            void network_simulation::on_block_accepted(simulated_node &node, const signed_block &block) {
+                auto iter = _blocks.find(block.id());
+                if (iter != _blocks.end()) {
+                    iter->second.accepted.emplace(node.index, fc::time_point::now());
+                }
+            }
+
+            bool network_simulation::nodes_in_consensus() const {
+                for (const auto &node : _nodes) {
+                    if (node->db.head_block_id() != _nodes.front()->db.head_block_id()) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            void network_simulation::report(const std::string &prefix) const {
+                bench_sampler propagation(prefix + ".block_propagation");
+                bench_sampler full_propagation(prefix + ".block_full_propagation");
+                bench_sampler inclusion(prefix + ".transaction_inclusion");
+
+                const auto &reference = _nodes.front()->db;
+                uint32_t orphaned_blocks = 0;
+
+                for (const auto &item : _blocks) {
+                    const produced_block &block = item.second;
+                    uint32_t block_num = block_header::num_from_id(block.id);
+                    if (block_num > reference.head_block_num() ||
+                        reference.get_block_id_for_num(block_num) != block.id) {
+                        ++orphaned_blocks;
+                        continue;
+                    }
+
+                    fc::time_point last_accepted = block.produced;
+                    for (const auto &accepted : block.accepted) {
+                        if (accepted.first != block.producer) {
+                            propagation.add(accepted.second - block.produced);
+                        }
+                        last_accepted = std::max(last_accepted, accepted.second);
+                    }
+                    if (block.accepted.size() == _nodes.size()) {
+                        full_propagation.add(last_accepted - block.produced);
+                    }
+
+                    auto included = reference.fetch_block_by_id(block.id);
+                    for (const auto &tx : included->transactions) {
+                        auto submitted = _submitted_transactions.find(tx.id());
+                        if (submitted != _submitted_transactions.end()) {
+                            inclusion.add(block.produced - submitted->second);
+                        }
+                    }
+                }
+
+                uint32_t nodes_in_consensus = 0;
+                for (const auto &node : _nodes) {
+                    nodes_in_consensus += node->db.head_block_id() == reference.head_block_id();
+                }
+
+                auto &bench = bench_report::instance();
+
+                propagation.report();
+                full_propagation.report();
+                inclusion.report();
+                bench.record_value(prefix + ".fork_rate", _blocks.empty() ? 0 : double(orphaned_blocks) / _blocks.size());
+                bench.record_value(prefix + ".transactions_not_included", _submitted_transactions.empty() ? 0 :
+                        1 - double(inclusion.result().samples) / _submitted_transactions.size());
+                bench.record_value(prefix + ".transactions_rejected", _rejected_transactions);
+                bench.record_value(prefix + ".nodes_in_consensus", nodes_in_consensus);
+                bench.record_value(prefix + ".links", _links.size());
+                bench.record_value(prefix + ".unlinkable_blocks", _unlinkable_blocks);
+                bench.record_value(prefix + ".retransmissions", _link_statistics.retransmissions);
+                bench.record_value(prefix + ".bytes_relayed", _link_statistics.bytes_relayed);
+            }
+
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,266 @@
+#ifndef NETWORK_SIMULATION_HPP
+#define NETWORK_SIMULATION_HPP
+
+#include <steemit/chain/database.hpp>
+
+#include <graphene/net/node.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/future.hpp>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#define NETWORK_SIM_SHARED_MEM_SIZE (1024 * 1024 * 64)
+
+/// Amount of slots every network simulation produces by default, they take the real block interval each
+#define NETWORK_SIM_DEFAULT_BLOCKS 20
+
+/// Minimal time a lost chunk waits for the retransmission on top of the round trip, like the TCP RTO
+#define NETWORK_SIM_RETRANSMISSION_TIMEOUT_MS 200
+
+/// Time the nodes have to connect to each other before the first slot
+#define NETWORK_SIM_CONNECT_TIMEOUT_SECONDS 10
+
+/// Time the last blocks have to reach every node
+#define NETWORK_SIM_SETTLE_TIMEOUT_SECONDS 30
+
+namespace steemit {
+    namespace chain {
+        namespace bench {
+
+            enum network_topology {
+                full_mesh, ///< every node is linked to every other node
+                ring, ///< every node is linked to two neighbours
+                random_graph ///< ring with random links added until every node has @ref network_simulation_config::degree links
+            };
+
+            /// Link between two simulated nodes, applied to both directions
+            struct simulated_link_parameters {
+                fc::microseconds latency; ///< added to every chunk
+                uint64_t bandwidth = 0; ///< bytes per second, chunks wait for the previous ones to pass. Zero is unlimited
+                double drop_rate = 0; ///< probability of losing a chunk, it's retransmitted after a timeout
+            };
+
+            struct network_simulation_config {
+                uint32_t nodes = 5;
+                uint32_t blocks = NETWORK_SIM_DEFAULT_BLOCKS;
+                uint32_t transactions_per_block = 20;
+                network_topology topology = full_mesh;
+                uint32_t degree = 3; ///< links of every node in @ref random_graph
+                simulated_link_parameters link; ///< every link, in both directions
+                uint64_t random_seed = 1;
+            };
+
+            struct simulated_link_statistics {
+                uint64_t bytes_relayed = 0;
+                uint64_t retransmissions = 0;
+            };
+
+            /**
+             * @brief TCP relay between two nodes adding latency, bandwidth limit and loss
+             *
+             * The connecting node is pointed to the relay instead of the other node,
+             * so both run the real p2p protocol. TCP doesn't lose data, a lost chunk
+             * arrives after a retransmission timeout and holds up the data sent after it.
+             */
+            class simulated_link {
+            public:
+                simulated_link(const fc::ip::endpoint &destination, const simulated_link_parameters &parameters,
+                        uint64_t random_seed, simulated_link_statistics &statistics);
+
+                ~simulated_link();
+
+                /// Endpoint the connecting node has to connect to
+                fc::ip::endpoint endpoint() const;
+
+            private:
+                struct direction {
+                    fc::tcp_socket *from = nullptr;
+                    fc::tcp_socket *to = nullptr;
+                    fc::time_point link_free_time; ///< when the link finishes passing the chunks already sent over it
+                    fc::time_point last_arrival_time;
+                    std::deque<std::pair<fc::time_point, std::vector<char>>> chunks;
+                    fc::promise<void>::ptr chunk_queued;
+                    fc::future<void> read_done;
+                    fc::future<void> write_done;
+                };
+
+                void accept();
+
+                void read_loop(direction &dir);
+
+                void write_loop(direction &dir);
+
+                void close();
+
+                bool lose_chunk();
+
+                fc::ip::endpoint _destination;
+                simulated_link_parameters _parameters;
+                uint64_t _random_state;
+                simulated_link_statistics &_statistics;
+                fc::tcp_server _server;
+                fc::tcp_socket _incoming;
+                fc::tcp_socket _outgoing;
+                direction _to_destination;
+                direction _from_destination;
+                bool _closed = false;
+                fc::future<void> _accept_done;
+            };
+
+            class network_simulation;
+
+            /**
+             * @brief Full database behind a real p2p node
+             */
+            class simulated_node : public graphene::net::node_delegate {
+            public:
+                simulated_node(network_simulation &simulation, uint32_t index);
+
+                ~simulated_node() override;
+
+                /// Starts listening on the loopback interface and syncing from the current head block
+                void start(uint32_t links);
+
+                bool has_item(const graphene::net::item_id &id) override;
+
+                bool handle_block(const graphene::net::block_message &blk_msg, bool sync_mode,
+                        std::vector<fc::uint160_t> &contained_transaction_message_ids) override;
+
+                void handle_transaction(const graphene::net::trx_message &trx_msg) override;
+
+                void handle_message(const graphene::net::message &message_to_process) override {
+                    FC_THROW("Invalid Message Type");
+                }
+
+                std::vector<graphene::net::item_hash_t> get_block_ids(const std::vector<graphene::net::item_hash_t> &blockchain_synopsis,
+                        uint32_t &remaining_item_count, uint32_t limit) override;
+
+                graphene::net::message get_item(const graphene::net::item_id &id) override;
+
+                std::vector<signed_transaction> get_pending_transactions() override;
+
+                std::vector<std::vector<char>> get_packed_blocks(uint32_t first_block_num, uint32_t limit, uint32_t max_bytes) override;
+
+                std::vector<graphene::net::item_hash_t> get_blockchain_synopsis(const graphene::net::item_hash_t &reference_point,
+                        uint32_t number_of_blocks_after_reference_point) override;
+
+                void sync_status(uint32_t item_type, uint32_t item_count) override {
+                }
+
+                void connection_count_changed(uint32_t c) override {
+                }
+
+                uint32_t get_block_number(const graphene::net::item_hash_t &block_id) override;
+
+                fc::time_point_sec get_block_time(const graphene::net::item_hash_t &block_id) override;
+
+                fc::time_point_sec get_blockchain_now() override;
+
+                graphene::net::item_hash_t get_head_block_id() const override;
+
+                uint32_t estimate_last_known_fork_from_git_revision_timestamp(uint32_t unix_timestamp) const override {
+                    return 0;
+                }
+
+                void error_encountered(const std::string &message, const fc::oexception &error) override;
+
+                const uint32_t index;
+                database db;
+                graphene::net::node_ptr p2p;
+
+            private:
+                bool is_included_block(const block_id_type &block_id);
+
+                network_simulation &_simulation;
+                fc::temp_directory _data_dir;
+            };
+
+            /**
+             * @brief Nodes producing blocks by the witness schedule over simulated links
+             *
+             * Every node runs a real graphene::net::node on the loopback interface,
+             * linked to the others by the configured topology through
+             * @ref simulated_link relays. Witnesses are assigned to nodes in turn.
+             * In every slot the node owning the witness scheduled in its own view of
+             * the chain produces a block and broadcasts it, so slow links lead to real
+             * forks, and nodes missing blocks fetch them with the sync protocol.
+             * Transactions are submitted to random nodes spread over the slot.
+             *
+             * Slots take the real block interval, the chain time starts at the head
+             * block of the setup. The topology, the witnesses, the transactions and
+             * the lost chunks depend only on the seed, the timing of the nodes doesn't.
+             */
+            class network_simulation {
+            public:
+                explicit network_simulation(const network_simulation_config &config);
+
+                ~network_simulation();
+
+                /// Creates witnesses and funded accounts, connects the nodes, then produces @ref network_simulation_config::blocks slots
+                void run();
+
+                /// Records block propagation, fork rate and transaction inclusion into @ref bench_report
+                void report(const std::string &prefix) const;
+
+                /// Chain time of the simulation, the wall clock shifted to the setup head block
+                fc::time_point now() const;
+
+            private:
+                friend class simulated_node;
+
+                struct produced_block {
+                    block_id_type id;
+                    fc::time_point produced;
+                    uint32_t producer = 0;
+                    std::map<uint32_t, fc::time_point> accepted; ///< by node index
+                };
+
+                void push_setup_block();
+
+                void push_setup_transaction(const operation &op);
+
+                /// Linked pairs of nodes, the lower index connects to the higher one
+                std::set<std::pair<uint32_t, uint32_t>> make_topology();
+
+                void connect_nodes();
+
+                void produce_blocks(const fc::time_point_sec &slot_time);
+
+                void submit_transaction();
+
+                void on_block_accepted(simulated_node &node, const signed_block &block);
+
+                bool nodes_in_consensus() const;
+
+                uint32_t witness_node(const account_name_type &witness) const;
+
+                uint64_t random();
+
+                network_simulation_config _config;
+                std::vector<std::unique_ptr<simulated_node>> _nodes;
+                std::vector<std::unique_ptr<simulated_link>> _links;
+                simulated_link_statistics _link_statistics;
+                std::vector<std::string> _accounts;
+                fc::ecc::private_key _key;
+                uint64_t _random_state;
+                uint64_t _transaction_counter = 0;
+                uint32_t _rejected_transactions = 0;
+                uint32_t _unlinkable_blocks = 0;
+                fc::time_point _real_start;
+                fc::time_point _chain_start;
+                std::map<block_id_type, produced_block> _blocks;
+                std::map<transaction_id_type, fc::time_point> _submitted_transactions;
+            };
+
+        }
+    }
+}
+
+#endif
@@ -27,9 +27,25 @@
 
 #include <steemit/chain/database.hpp>
 
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/exceptions.hpp>
+#include <graphene/net/io_thread_pool.hpp>
+#include <graphene/net/message_oriented_connection.hpp>
+#include <graphene/net/metrics.hpp>
+#include <graphene/net/node.hpp>
+#include <graphene/net/peer_connection.hpp>
+#include <graphene/net/peer_database.hpp>
+#include <graphene/net/rolling_bloom_filter.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
 #include <fc/crypto/digest.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
 #include "../common/database_fixture.hpp"
 
+#include <fstream>
 #include <random>
 
 using namespace steemit;
@@ -313,4 +329,788 @@ BOOST_FIXTURE_TEST_SUITE(basic_tests, clean_database_fixture)
         BOOST_CHECK(block.calculate_merkle_root() == c(dO));
     }
 
+    BOOST_AUTO_TEST_CASE(virtual_operation_interest_test) {
+        auto interest = std::make_shared<virtual_operation_interest>();
+        const auto fill_order = operation::tag<fill_order_operation>::value;
+        const auto author_reward = operation::tag<author_reward_operation>::value;
+
+        BOOST_TEST_MESSAGE("No subscribers need no virtual operations");
+        BOOST_CHECK(!interest->is_needed(fill_order, 0));
+
+        BOOST_TEST_MESSAGE("Subscriber without a list needs every virtual operation");
+        BOOST_CHECK(interest->is_needed(fill_order, 1));
+        BOOST_CHECK(interest->is_needed(author_reward, 1));
+
+        {
+            virtual_operation_subscription market(interest, virtual_operations<fill_order_operation>());
+
+            BOOST_TEST_MESSAGE("Filtered subscriber needs only listed operations");
+            BOOST_CHECK(interest->is_needed(fill_order, 1));
+            BOOST_CHECK(!interest->is_needed(author_reward, 1));
+
+            BOOST_TEST_MESSAGE("Filtered and unfiltered subscribers need every operation");
+            BOOST_CHECK(interest->is_needed(author_reward, 2));
+
+            virtual_operation_subscription follow(interest, virtual_operations<>());
+            BOOST_CHECK(interest->is_needed(fill_order, 2));
+            BOOST_CHECK(!interest->is_needed(author_reward, 2));
+        }
+
+        BOOST_TEST_MESSAGE("Interest is released with subscriptions");
+        BOOST_CHECK(interest->is_needed(author_reward, 1));
+        BOOST_CHECK(interest->is_needed(fill_order, 1));
+    }
+
+    BOOST_AUTO_TEST_CASE(lock_scheduler_test) {
+        BOOST_TEST_MESSAGE("Histogram buckets are powers of two microseconds");
+        lock_histogram histogram;
+        histogram.add(fc::microseconds(0));
+        histogram.add(fc::microseconds(3));
+        histogram.add(fc::seconds(100));
+        BOOST_CHECK_EQUAL(histogram.count, 3);
+        BOOST_CHECK_EQUAL(histogram.max_us, fc::seconds(100).count());
+        BOOST_CHECK_EQUAL(histogram.buckets[0], 1);
+        BOOST_CHECK_EQUAL(histogram.buckets[2], 1);
+        BOOST_CHECK_EQUAL(histogram.buckets.back(), 1);
+
+        lock_scheduler scheduler;
+        scheduler.set_read_quantum(fc::microseconds(0));
+
+        BOOST_TEST_MESSAGE("Read lock is not yielded without pending writers");
+        {
+            lock_scheduler::lock_scope scope(scheduler, false, fc::time_point::now());
+            BOOST_CHECK(lock_scheduler::in_read_lock());
+            BOOST_CHECK(!scheduler.should_yield_read_lock());
+
+            lock_scheduler::write_intent writer(scheduler);
+            BOOST_CHECK(scheduler.should_yield_read_lock());
+
+            BOOST_TEST_MESSAGE("Nested read lock is never yielded");
+            lock_scheduler::nested_lock_scope nested(false);
+            BOOST_CHECK(!scheduler.should_yield_read_lock());
+        }
+        BOOST_CHECK(!lock_scheduler::in_read_lock());
+        BOOST_CHECK(!scheduler.has_pending_writers());
+
+        auto statistics = scheduler.get_statistics();
+        BOOST_CHECK_EQUAL(statistics.read_wait.count, 1);
+        BOOST_CHECK_EQUAL(statistics.read_hold.count, 1);
+        BOOST_CHECK_EQUAL(statistics.write_hold.count, 0);
+
+        BOOST_TEST_MESSAGE("Lock depth belongs to the task, not to the thread");
+        {
+            lock_scheduler::lock_scope scope(scheduler, false, fc::time_point::now());
+            bool other_task_in_lock = fc::async([]() {
+                return lock_scheduler::in_read_lock();
+            }).wait();
+            BOOST_CHECK(!other_task_in_lock);
+            BOOST_CHECK(lock_scheduler::in_read_lock());
+        }
+
+        BOOST_TEST_MESSAGE("Delayed reader wakes up once the last writer is gone");
+        scheduler.set_writer_priority(true);
+        std::unique_ptr<lock_scheduler::write_intent> writer(new lock_scheduler::write_intent(scheduler));
+        auto release = fc::schedule([&]() {
+            writer.reset();
+        }, fc::time_point::now() + fc::milliseconds(10), "release writer");
+
+        auto start = fc::time_point::now();
+        scheduler.wait_for_writers();
+        BOOST_CHECK(!scheduler.has_pending_writers());
+        BOOST_CHECK(fc::time_point::now() - start < fc::milliseconds(500));
+        BOOST_CHECK_EQUAL(scheduler.get_statistics().delayed_readers, 1);
+        release.wait();
+    }
+
+    BOOST_AUTO_TEST_CASE(rolling_bloom_filter_test) {
+        using graphene::net::item_id;
+        auto make_item = [](uint32_t n) {
+            return item_id(graphene::net::trx_message_type, fc::ripemd160::hash(fc::to_string(n)));
+        };
+
+        graphene::net::rolling_bloom_filter filter(100, 0.001);
+        auto memory_usage = filter.memory_usage();
+
+        BOOST_TEST_MESSAGE("Items of the last generation are always found");
+        for (uint32_t i = 0; i < 100; ++i) {
+            filter.insert(make_item(i));
+        }
+        for (uint32_t i = 0; i < 100; ++i) {
+            BOOST_CHECK(filter.contains(make_item(i)));
+        }
+
+        BOOST_TEST_MESSAGE("Items are kept for one more generation");
+        for (uint32_t i = 100; i < 200; ++i) {
+            filter.insert(make_item(i));
+        }
+        for (uint32_t i = 0; i < 200; ++i) {
+            BOOST_CHECK(filter.contains(make_item(i)));
+        }
+
+        BOOST_TEST_MESSAGE("Oldest generation is dropped without growing the filter");
+        for (uint32_t i = 200; i < 300; ++i) {
+            filter.insert(make_item(i));
+        }
+        uint32_t false_positives = 0;
+        for (uint32_t i = 0; i < 100; ++i) {
+            false_positives += filter.contains(make_item(i));
+        }
+        BOOST_CHECK_LT(false_positives, 5);
+        BOOST_CHECK_EQUAL(filter.memory_usage(), memory_usage);
+
+        filter.clear();
+        BOOST_CHECK(!filter.contains(make_item(299)));
+
+        BOOST_TEST_MESSAGE("Generations filled faster than the generation time grow up to the maximal size");
+        graphene::net::rolling_bloom_filter growing(100, 400, 0.001, fc::hours(1));
+        BOOST_CHECK_EQUAL(growing.generation_size(), 100);
+        auto initial_memory_usage = growing.memory_usage();
+        for (uint32_t i = 0; i < 101; ++i) {
+            growing.insert(make_item(i));
+        }
+        BOOST_CHECK_EQUAL(growing.generation_size(), 200);
+        for (uint32_t i = 101; i < 301; ++i) {
+            growing.insert(make_item(i));
+        }
+        BOOST_CHECK_EQUAL(growing.generation_size(), 400);
+        BOOST_CHECK_GT(growing.memory_usage(), initial_memory_usage);
+        for (uint32_t i = 100; i < 301; ++i) {
+            BOOST_CHECK(growing.contains(make_item(i)));
+        }
+        for (uint32_t i = 301; i < 1200; ++i) {
+            growing.insert(make_item(i));
+        }
+        BOOST_CHECK_EQUAL(growing.generation_size(), 400);
+    }
+
+    BOOST_AUTO_TEST_CASE(message_oriented_connection_io_thread_test) {
+        using namespace graphene::net;
+
+        struct collecting_delegate : public message_oriented_connection_delegate {
+            fc::thread *delegate_thread = &fc::thread::current();
+            bool delivered_on_other_thread = false;
+            std::vector<message> messages;
+            size_t expected = 0;
+            fc::promise<void>::ptr all_received{new fc::promise<void>("all messages received")};
+
+            void on_message(message_oriented_connection *, const message &received_message) override {
+                delivered_on_other_thread |= !delegate_thread->is_current();
+                messages.push_back(received_message);
+                if (messages.size() == expected) {
+                    all_received->set_value();
+                }
+            }
+
+            void on_connection_closed(message_oriented_connection *) override {
+            }
+        };
+
+        io_thread_pool pool;
+        pool.set_thread_count(1);
+
+        collecting_delegate delegate;
+        // more than the received message queue holds, so the I/O thread has to wait for the dispatch loop
+        const size_t transaction_count = GRAPHENE_NET_IO_RECEIVED_MESSAGE_QUEUE_SIZE * 4;
+        delegate.expected = transaction_count + 1;
+
+        fc::tcp_server server;
+        server.listen(fc::ip::endpoint(fc::ip::address("127.0.0.1"), 0));
+
+        message_oriented_connection receiving(&delegate, pool.next_thread());
+        message_oriented_connection sending;
+        auto accepted = fc::async([&]() {
+            server.accept(receiving.get_socket());
+            receiving.accept();
+        }, "accept test connection");
+        sending.connect_to(fc::ip::endpoint(fc::ip::address("127.0.0.1"), server.get_port()));
+        accepted.wait();
+
+        BOOST_TEST_MESSAGE("Messages arrive in order on the delegate thread, hashed and unpacked by the I/O thread");
+        std::vector<message> sent;
+        for (size_t i = 0; i < transaction_count; ++i) {
+            signed_transaction trx;
+            trx.ref_block_num = static_cast<uint16_t>(i);
+            sent.push_back(message(trx_message(trx)));
+            sending.send_message(sent.back());
+        }
+        sent.push_back(message(current_time_request_message()));
+        sending.send_message(sent.back());
+        delegate.all_received->wait(fc::seconds(10));
+
+        BOOST_CHECK(!delegate.delivered_on_other_thread);
+        BOOST_REQUIRE_EQUAL(delegate.messages.size(), sent.size());
+        for (size_t i = 0; i < transaction_count; ++i) {
+            const message &received = delegate.messages[i];
+            BOOST_CHECK(received.precomputed_id.valid());
+            BOOST_CHECK(received.id() == sent[i].id());
+            BOOST_REQUIRE(received.unpacked);
+            BOOST_CHECK_EQUAL(received.as_shared<trx_message>()->trx.ref_block_num, static_cast<uint16_t>(i));
+        }
+
+        BOOST_TEST_MESSAGE("Messages without blocks or transactions are left packed");
+        BOOST_CHECK_EQUAL(delegate.messages.back().msg_type, current_time_request_message::type);
+        BOOST_CHECK(!delegate.messages.back().unpacked);
+
+        sending.close_connection();
+        receiving.destroy_connection();
+    }
+
+    BOOST_AUTO_TEST_CASE(peer_database_test) {
+        using namespace graphene::net;
+
+        fc::temp_directory data_dir(graphene::utilities::temp_directory_path());
+        fc::path peers_filename = data_dir.path() / "peers.dat";
+
+        auto make_endpoint = [](uint16_t port) {
+            return fc::ip::endpoint(fc::ip::address("10.0.0.1"), port);
+        };
+        auto make_record = [&](uint16_t port) {
+            potential_peer_record record(make_endpoint(port), fc::time_point_sec(1000 + port), last_connection_succeeded);
+            record.number_of_successful_connection_attempts = port;
+            record.average_latency_ms = port * 2;
+            return record;
+        };
+
+        BOOST_TEST_MESSAGE("Appended updates, erases and errors survive a reopen");
+        {
+            peer_database db;
+            db.open(peers_filename);
+            for (uint16_t port = 1; port <= 10; ++port) {
+                db.update_entry(make_record(port));
+            }
+            db.erase(make_endpoint(3));
+            potential_peer_record failed = make_record(5);
+            failed.last_connection_disposition = last_connection_failed;
+            failed.last_error = fc::exception(FC_LOG_MESSAGE(error, "connection refused by ${peer}", ("peer", "10.0.0.1:5")));
+            db.update_entry(failed);
+            db.close();
+        }
+        {
+            peer_database db;
+            db.open(peers_filename);
+            BOOST_CHECK_EQUAL(db.size(), 9);
+            BOOST_CHECK(!db.lookup_entry_for_endpoint(make_endpoint(3)));
+
+            fc::optional<potential_peer_record> record = db.lookup_entry_for_endpoint(make_endpoint(7));
+            BOOST_REQUIRE(record);
+            BOOST_CHECK_EQUAL(record->number_of_successful_connection_attempts, 7);
+            BOOST_CHECK_EQUAL(record->average_latency_ms, 14);
+            BOOST_CHECK(record->last_seen_time == fc::time_point_sec(1007));
+            BOOST_CHECK(!record->last_error);
+
+            record = db.lookup_entry_for_endpoint(make_endpoint(5));
+            BOOST_REQUIRE(record);
+            BOOST_CHECK(record->last_connection_disposition == last_connection_failed);
+            BOOST_REQUIRE(record->last_error);
+            BOOST_CHECK(record->last_error->to_string().find("connection refused by 10.0.0.1:5") != std::string::npos);
+            db.close();
+        }
+
+        BOOST_TEST_MESSAGE("Torn tail of the log is dropped, the records before it are kept");
+        {
+            std::ofstream file(peers_filename.string(), std::ios::binary | std::ios::app);
+            uint32_t entry_size = 1000;
+            file.write(reinterpret_cast<const char *>(&entry_size), sizeof(entry_size));
+            file.write("torn", 4);
+        }
+        {
+            peer_database db;
+            db.open(peers_filename);
+            BOOST_CHECK_EQUAL(db.size(), 9);
+            db.update_entry(make_record(11));
+            db.close();
+        }
+        {
+            peer_database db;
+            db.open(peers_filename);
+            BOOST_CHECK_EQUAL(db.size(), 10);
+            BOOST_CHECK(db.lookup_entry_for_endpoint(make_endpoint(11)));
+            db.close();
+        }
+
+        BOOST_TEST_MESSAGE("Log is compacted once it's much larger than the live records");
+        {
+            peer_database db;
+            db.open(peers_filename);
+            uint64_t compacted_size = fc::file_size(peers_filename);
+            uint64_t largest_size = compacted_size;
+            potential_peer_record record = make_record(1);
+            for (uint32_t i = 0; i < 2 * db.size() + 1000; ++i) {
+                record.number_of_failed_connection_attempts = i;
+                db.update_entry(record);
+                largest_size = std::max<uint64_t>(largest_size, fc::file_size(peers_filename));
+            }
+            BOOST_CHECK_GT(largest_size, compacted_size);
+            BOOST_CHECK_LT(fc::file_size(peers_filename), largest_size);
+            BOOST_CHECK_EQUAL(db.size(), 10);
+            db.close();
+
+            db.open(peers_filename);
+            BOOST_CHECK_EQUAL(db.size(), 10);
+            fc::optional<potential_peer_record> reloaded = db.lookup_entry_for_endpoint(make_endpoint(1));
+            BOOST_REQUIRE(reloaded);
+            BOOST_CHECK_EQUAL(reloaded->number_of_failed_connection_attempts, record.number_of_failed_connection_attempts);
+            db.close();
+        }
+
+        BOOST_TEST_MESSAGE("JSON database of older versions is imported when there's no log");
+        fc::temp_directory legacy_dir(graphene::utilities::temp_directory_path());
+        fc::path legacy_peers_filename = legacy_dir.path() / "peers.dat";
+        {
+            std::vector<potential_peer_record> legacy_records = {make_record(20), make_record(21)};
+            fc::json::save_to_file(legacy_records, legacy_dir.path() / "peers.json");
+
+            peer_database db;
+            db.open(legacy_peers_filename);
+            BOOST_CHECK_EQUAL(db.size(), 2);
+            BOOST_CHECK(fc::exists(legacy_peers_filename));
+            db.close();
+
+            db.open(legacy_peers_filename);
+            BOOST_CHECK_EQUAL(db.size(), 2);
+            fc::optional<potential_peer_record> record = db.lookup_entry_for_endpoint(make_endpoint(21));
+            BOOST_REQUIRE(record);
+            BOOST_CHECK_EQUAL(record->average_latency_ms, 42);
+            db.close();
+        }
+
+        BOOST_TEST_MESSAGE("Truncated JSON database starts a clean database");
+        fc::temp_directory truncated_dir(graphene::utilities::temp_directory_path());
+        {
+            std::vector<potential_peer_record> legacy_records = {make_record(30), make_record(31)};
+            std::string json = fc::json::to_string(legacy_records);
+            std::ofstream file((truncated_dir.path() / "peers.json").string(), std::ios::trunc);
+            file << json.substr(0, json.size() / 2);
+        }
+        {
+            peer_database db;
+            BOOST_CHECK_NO_THROW(db.open(truncated_dir.path() / "peers.dat"));
+            BOOST_CHECK_EQUAL(db.size(), 0);
+            db.update_entry(make_record(32));
+            db.close();
+
+            db.open(truncated_dir.path() / "peers.dat");
+            BOOST_CHECK_EQUAL(db.size(), 1);
+            db.close();
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(peer_connection_send_queue_test) {
+        using namespace graphene::net;
+
+        struct idle_delegate : public peer_connection_delegate {
+            void on_message(peer_connection *, const message &) override {
+            }
+
+            void on_connection_closed(peer_connection *) override {
+            }
+
+            void on_message_sent(peer_connection *, const message &) override {
+            }
+
+            message get_message_for_item(const item_id &item) override {
+                FC_THROW("Unknown item ${item}", ("item", item));
+            }
+
+            void on_message_dropped(peer_connection *, const item_id &) override {
+                ++dropped_messages;
+            }
+
+            fc::thread *get_io_thread() override {
+                return nullptr;
+            }
+
+            uint32_t dropped_messages = 0;
+        };
+
+        typedef peer_connection::message_priority priority;
+
+        BOOST_TEST_MESSAGE("Requests and replies the other side waits for have their own class");
+        BOOST_CHECK(peer_connection::get_priority_of_type(block_message_type) == priority::block);
+        BOOST_CHECK(peer_connection::get_priority_of_type(compact_block_message_type) == priority::block);
+        BOOST_CHECK(peer_connection::get_priority_of_type(hello_message_type) == priority::block);
+        BOOST_CHECK(peer_connection::get_priority_of_type(fetch_items_message_type) == priority::block_fetch);
+        BOOST_CHECK(peer_connection::get_priority_of_type(item_not_available_message_type) == priority::block_fetch);
+        BOOST_CHECK(peer_connection::get_priority_of_type(item_ids_inventory_message_type) == priority::inventory);
+        BOOST_CHECK(peer_connection::get_priority_of_type(trx_message_type) == priority::transaction);
+        for (uint32_t msg_type : {address_request_message_type, address_message_type,
+                                  current_time_request_message_type, current_time_reply_message_type,
+                                  check_firewall_message_type, check_firewall_reply_message_type,
+                                  get_current_connections_request_message_type, get_current_connections_reply_message_type}) {
+            BOOST_CHECK(peer_connection::get_priority_of_type(msg_type) == priority::request_reply);
+        }
+
+        // nothing is sent until the test yields, so the queues only grow
+        idle_delegate delegate;
+
+        BOOST_TEST_MESSAGE("The oldest transactions over the budget are dropped and answered with item_not_available");
+        peer_connection_ptr relaying = peer_connection::make_shared(&delegate);
+        signed_transaction trx;
+        transfer_operation transfer;
+        transfer.memo = std::string(16 * 1024, 'x');
+        trx.operations.push_back(transfer);
+        const size_t transaction_size = message(trx_message(trx)).size;
+        const size_t transaction_count = GRAPHENE_NET_MAXIMUM_QUEUED_TRANSACTION_BYTES / transaction_size + 8;
+        for (size_t i = 0; i < transaction_count; ++i) {
+            trx.ref_block_num = static_cast<uint16_t>(i);
+            relaying->send_message(message(trx_message(trx)));
+        }
+        BOOST_CHECK_LE(relaying->get_queued_messages_size(priority::transaction), GRAPHENE_NET_MAXIMUM_QUEUED_TRANSACTION_BYTES);
+        BOOST_CHECK_GE(relaying->get_number_of_dropped_messages(), 8);
+        BOOST_CHECK_EQUAL(delegate.dropped_messages, relaying->get_number_of_dropped_messages());
+        BOOST_CHECK_GT(relaying->get_queued_messages_size(priority::block_fetch), 0);
+        BOOST_CHECK(relaying->negotiation_status != peer_connection::connection_negotiation_status::closing);
+
+        BOOST_TEST_MESSAGE("Replies are never dropped, a peer flooding us with requests is disconnected");
+        peer_connection_ptr flooding = peer_connection::make_shared(&delegate);
+        address_message addresses;
+        addresses.addresses.resize(100);
+        const message reply(addresses);
+        const size_t replies_in_budget = GRAPHENE_NET_MAXIMUM_QUEUED_REQUEST_REPLY_BYTES / reply.size;
+        for (size_t i = 0; i < replies_in_budget; ++i) {
+            flooding->send_message(reply);
+        }
+        BOOST_CHECK_EQUAL(flooding->get_queued_messages_size(priority::request_reply), replies_in_budget * reply.size);
+        BOOST_CHECK(flooding->negotiation_status != peer_connection::connection_negotiation_status::closing);
+        flooding->send_message(reply);
+        BOOST_CHECK(flooding->negotiation_status == peer_connection::connection_negotiation_status::closing);
+        BOOST_CHECK_EQUAL(flooding->get_number_of_dropped_messages(), 0);
+        BOOST_CHECK_EQUAL(delegate.dropped_messages, relaying->get_number_of_dropped_messages());
+
+        relaying->destroy_connection();
+        flooding->destroy_connection();
+    }
+
+    BOOST_AUTO_TEST_CASE(metrics_registry_test) {
+        using namespace graphene::net;
+
+        metrics_registry metrics;
+        metrics.describe("p2p_requests_total", counter_metric, "Requests by type");
+        metrics.describe("p2p_queue_bytes", gauge_metric, "Queued bytes");
+        metrics.describe("p2p_delay_seconds", histogram_metric, "Delays", {0.1, 1});
+
+        BOOST_TEST_MESSAGE("Metrics have to be described and updated by their type");
+        BOOST_CHECK_THROW(metrics.increment("p2p_unknown_total"), fc::exception);
+        BOOST_CHECK_THROW(metrics.set("p2p_requests_total", 1), fc::exception);
+        BOOST_CHECK_THROW(metrics.describe("p2p_queue_bytes", gauge_metric, "Queued bytes", {1}), fc::exception);
+
+        metrics.increment("p2p_requests_total", {{"type", "fetch"}});
+        metrics.increment("p2p_requests_total", {{"type", "fetch"}}, 2);
+        metrics.increment("p2p_requests_total", {{"type", "quote\"back\\slash\nline"}});
+        metrics.set("p2p_queue_bytes", 1024);
+        metrics.set("p2p_queue_bytes", 512);
+        metrics.observe("p2p_delay_seconds", {{"peer", "1.2.3.4:2001"}}, 0.1);
+        metrics.observe("p2p_delay_seconds", {{"peer", "1.2.3.4:2001"}}, 0.5);
+        metrics.observe("p2p_delay_seconds", {{"peer", "1.2.3.4:2001"}}, 0.5);
+        metrics.observe("p2p_delay_seconds", {{"peer", "1.2.3.4:2001"}}, 4);
+
+        BOOST_TEST_MESSAGE("Counters add up, gauges keep the last value, histogram buckets are cumulative and labels escaped");
+        BOOST_CHECK_EQUAL(metrics.to_text(),
+                "# HELP p2p_delay_seconds Delays\n"
+                "# TYPE p2p_delay_seconds histogram\n"
+                "p2p_delay_seconds_bucket{peer=\"1.2.3.4:2001\",le=\"0.1\"} 1\n"
+                "p2p_delay_seconds_bucket{peer=\"1.2.3.4:2001\",le=\"1\"} 3\n"
+                "p2p_delay_seconds_bucket{peer=\"1.2.3.4:2001\",le=\"+Inf\"} 4\n"
+                "p2p_delay_seconds_sum{peer=\"1.2.3.4:2001\"} 5.1\n"
+                "p2p_delay_seconds_count{peer=\"1.2.3.4:2001\"} 4\n"
+                "# HELP p2p_queue_bytes Queued bytes\n"
+                "# TYPE p2p_queue_bytes gauge\n"
+                "p2p_queue_bytes 512\n"
+                "# HELP p2p_requests_total Requests by type\n"
+                "# TYPE p2p_requests_total counter\n"
+                "p2p_requests_total{type=\"fetch\"} 3\n"
+                "p2p_requests_total{type=\"quote\\\"back\\\\slash\\nline\"} 1\n");
+
+        BOOST_TEST_MESSAGE("Cleared metrics keep their description");
+        metrics.clear("p2p_delay_seconds");
+        metrics.clear("p2p_requests_total");
+        BOOST_CHECK_EQUAL(metrics.to_text(),
+                "# HELP p2p_delay_seconds Delays\n"
+                "# TYPE p2p_delay_seconds histogram\n"
+                "# HELP p2p_queue_bytes Queued bytes\n"
+                "# TYPE p2p_queue_bytes gauge\n"
+                "p2p_queue_bytes 512\n"
+                "# HELP p2p_requests_total Requests by type\n"
+                "# TYPE p2p_requests_total counter\n");
+    }
+
+    BOOST_AUTO_TEST_CASE(block_range_sync_test) {
+        using namespace graphene::net;
+
+        /// Chain of unvalidated blocks in memory behind a real p2p node on the loopback interface
+        struct memory_chain_node : public node_delegate {
+            std::vector<signed_block> blocks; ///< block n at n - 1
+            std::vector<signed_block> block_log; ///< streamed in block ranges, may end early or hold another fork
+            fc::temp_directory data_dir{graphene::utilities::temp_directory_path()};
+            node_ptr p2p;
+
+            ~memory_chain_node() {
+                if (p2p) {
+                    p2p->close();
+                    p2p.reset();
+                }
+            }
+
+            void start() {
+                p2p = std::make_shared<node>("block_range_sync_test");
+                p2p->load_configuration(data_dir.path());
+                p2p->set_node_delegate(this);
+
+                fc::mutable_variant_object parameters;
+                parameters["desired_number_of_connections"] = 0;
+                parameters["maximum_number_of_connections"] = 2;
+                p2p->set_advanced_node_parameters(parameters);
+                p2p->disable_peer_advertising();
+
+                p2p->listen_on_endpoint(fc::ip::endpoint(fc::ip::address("127.0.0.1"), 0), false);
+                p2p->listen_to_p2p_network();
+                p2p->sync_from(item_id(block_message_type, get_head_block_id()), std::vector<uint32_t>());
+                p2p->connect_to_p2p_network();
+            }
+
+            bool is_known_block(const item_hash_t &block_id) const {
+                uint32_t block_num = block_header::num_from_id(block_id);
+                return block_num > 0 && block_num <= blocks.size() && blocks[block_num - 1].id() == block_id;
+            }
+
+            bool has_item(const item_id &id) override {
+                return id.item_type == block_message_type && is_known_block(id.item_hash);
+            }
+
+            bool handle_block(const block_message &blk_msg, bool sync_mode,
+                    std::vector<fc::uint160_t> &contained_transaction_message_ids) override {
+                if (is_known_block(blk_msg.block_id)) {
+                    return false;
+                }
+                if (blk_msg.block.previous != get_head_block_id()) {
+                    FC_THROW_EXCEPTION(unlinkable_block_exception, "Block ${id} doesn't link to the head block", ("id", blk_msg.block_id));
+                }
+                blocks.push_back(blk_msg.block);
+                return false;
+            }
+
+            void handle_transaction(const trx_message &trx_msg) override {
+            }
+
+            void handle_message(const message &message_to_process) override {
+                FC_THROW("Invalid Message Type");
+            }
+
+            std::vector<item_hash_t> get_block_ids(const std::vector<item_hash_t> &blockchain_synopsis,
+                    uint32_t &remaining_item_count, uint32_t limit) override {
+                std::vector<item_hash_t> result;
+                remaining_item_count = 0;
+                if (blocks.empty()) {
+                    return result;
+                }
+
+                uint32_t last_known_block_num = 0;
+                bool found_a_block_in_synopsis = blockchain_synopsis.empty();
+                for (auto itr = blockchain_synopsis.rbegin(); itr != blockchain_synopsis.rend(); ++itr) {
+                    if (*itr == item_hash_t() || is_known_block(*itr)) {
+                        last_known_block_num = block_header::num_from_id(*itr);
+                        found_a_block_in_synopsis = true;
+                        break;
+                    }
+                }
+                if (!found_a_block_in_synopsis) {
+                    FC_THROW_EXCEPTION(peer_is_on_an_unreachable_fork, "Unable to provide a list of blocks starting at any of the blocks in peer's synopsis");
+                }
+
+                for (uint32_t num = std::max<uint32_t>(last_known_block_num, 1); num <= blocks.size() && result.size() < limit; ++num) {
+                    result.push_back(blocks[num - 1].id());
+                }
+                if (!result.empty()) {
+                    remaining_item_count = blocks.size() - block_header::num_from_id(result.back());
+                }
+                return result;
+            }
+
+            message get_item(const item_id &id) override {
+                FC_ASSERT(has_item(id), "Unknown item ${id}", ("id", id));
+                return block_message(blocks[block_header::num_from_id(id.item_hash) - 1]);
+            }
+
+            std::vector<signed_transaction> get_pending_transactions() override {
+                return std::vector<signed_transaction>();
+            }
+
+            std::vector<std::vector<char>> get_packed_blocks(uint32_t first_block_num, uint32_t limit, uint32_t max_bytes) override {
+                std::vector<std::vector<char>> result;
+                size_t bytes = 0;
+                for (uint32_t num = first_block_num; num <= block_log.size() && result.size() < limit; ++num) {
+                    std::vector<char> packed_block = fc::raw::pack(block_log[num - 1]);
+                    if (!result.empty() && bytes + packed_block.size() > max_bytes) {
+                        break;
+                    }
+                    bytes += packed_block.size();
+                    result.push_back(std::move(packed_block));
+                }
+                return result;
+            }
+
+            std::vector<item_hash_t> get_blockchain_synopsis(const item_hash_t &reference_point,
+                    uint32_t number_of_blocks_after_reference_point) override {
+                // the chain never forks, so the synopsis is built as for the preferred chain
+                std::vector<item_hash_t> synopsis;
+                uint32_t high_block_num = reference_point == item_hash_t() ? blocks.size() :
+                                          std::min<uint32_t>(block_header::num_from_id(reference_point), blocks.size());
+                if (high_block_num == 0) {
+                    return synopsis;
+                }
+
+                uint32_t true_high_block_num = high_block_num + number_of_blocks_after_reference_point;
+                uint32_t low_block_num = 1;
+                do {
+                    synopsis.push_back(blocks[low_block_num - 1].id());
+                    low_block_num += (true_high_block_num - low_block_num + 2) / 2;
+                } while (low_block_num <= high_block_num);
+                return synopsis;
+            }
+
+            void sync_status(uint32_t item_type, uint32_t item_count) override {
+            }
+
+            void connection_count_changed(uint32_t c) override {
+            }
+
+            uint32_t get_block_number(const item_hash_t &block_id) override {
+                return block_header::num_from_id(block_id);
+            }
+
+            fc::time_point_sec get_block_time(const item_hash_t &block_id) override {
+                return is_known_block(block_id) ? blocks[block_header::num_from_id(block_id) - 1].timestamp : fc::time_point_sec::min();
+            }
+
+            fc::time_point_sec get_blockchain_now() override {
+                return fc::time_point::now();
+            }
+
+            item_hash_t get_head_block_id() const override {
+                return blocks.empty() ? item_hash_t() : blocks.back().id();
+            }
+
+            uint32_t estimate_last_known_fork_from_git_revision_timestamp(uint32_t unix_timestamp) const override {
+                return 0;
+            }
+
+            void error_encountered(const std::string &message, const fc::oexception &error) override {
+            }
+        };
+
+        auto extend_chain = [](std::vector<signed_block> chain, uint32_t count, const std::string &witness) -> std::vector<signed_block> {
+            for (uint32_t i = 0; i < count; ++i) {
+                signed_block block;
+                block.previous = chain.empty() ? block_id_type() : chain.back().id();
+                block.timestamp = STEEMIT_GENESIS_TIME + static_cast<uint32_t>(STEEMIT_BLOCK_INTERVAL * (chain.size() + 1));
+                block.witness = witness;
+                chain.push_back(block);
+            }
+            return chain;
+        };
+
+        auto metric = [](const memory_chain_node &chain_node, const std::string &name, const std::string &label, const std::string &value) -> double {
+            fc::variant metrics = chain_node.p2p->get_metrics();
+            if (!metrics.get_object().contains(name.c_str())) {
+                return 0.0;
+            }
+            for (const fc::variant &series : metrics[name.c_str()]["series"].get_array()) {
+                const fc::variant_object &labels = series["labels"].get_object();
+                if (labels.contains(label.c_str()) && labels[label.c_str()].as_string() == value) {
+                    return series["value"].as_double();
+                }
+            }
+            return 0.0;
+        };
+
+        auto wait_for = [](const std::function<bool()> &done) -> bool {
+            fc::time_point deadline = fc::time_point::now() + fc::seconds(30);
+            while (!done() && fc::time_point::now() < deadline) {
+                fc::usleep(fc::milliseconds(50));
+            }
+            return done();
+        };
+
+        auto is_synced = [](const memory_chain_node &syncing, const memory_chain_node &serving) {
+            return syncing.get_head_block_id() == serving.get_head_block_id();
+        };
+
+        BOOST_TEST_MESSAGE("Blocks are streamed as far as the block log goes, the rest is fetched one by one");
+        {
+            memory_chain_node serving;
+            serving.blocks = extend_chain(std::vector<signed_block>(), 120, "alice");
+            serving.block_log.assign(serving.blocks.begin(), serving.blocks.begin() + 90);
+            memory_chain_node syncing;
+            serving.start();
+            syncing.start();
+            syncing.p2p->connect_to_endpoint(serving.p2p->get_actual_listening_endpoint());
+
+            BOOST_REQUIRE(wait_for([&]() { return is_synced(syncing, serving); }));
+            for (size_t i = 0; i < serving.blocks.size(); ++i) {
+                BOOST_CHECK(syncing.blocks[i].id() == serving.blocks[i].id());
+            }
+            BOOST_CHECK_EQUAL(metric(serving, "p2p_block_range_blocks_total", "direction", "sent"), 90);
+            BOOST_CHECK_EQUAL(metric(syncing, "p2p_block_range_blocks_total", "direction", "received"), 90);
+            BOOST_CHECK_GT(metric(syncing, "p2p_messages_received_total", "type", "block_range_message_type"), 0);
+            BOOST_CHECK_GE(metric(syncing, "p2p_messages_received_total", "type", "block_message_type"), 30);
+            BOOST_CHECK_EQUAL(syncing.p2p->get_connection_count(), 1);
+        }
+
+        BOOST_TEST_MESSAGE("A range starting on another fork than the block log is refused, the peer stays connected");
+        {
+            memory_chain_node serving;
+            serving.blocks = extend_chain(std::vector<signed_block>(), 60, "alice");
+            std::vector<signed_block> common(serving.blocks.begin(), serving.blocks.begin() + 30);
+            serving.block_log = extend_chain(common, 30, "bob");
+            BOOST_REQUIRE(serving.block_log[30].id() != serving.blocks[30].id());
+            memory_chain_node syncing;
+            syncing.blocks = common;
+            serving.start();
+            syncing.start();
+            syncing.p2p->connect_to_endpoint(serving.p2p->get_actual_listening_endpoint());
+
+            BOOST_REQUIRE(wait_for([&]() { return is_synced(syncing, serving); }));
+            for (size_t i = 0; i < serving.blocks.size(); ++i) {
+                BOOST_CHECK(syncing.blocks[i].id() == serving.blocks[i].id());
+            }
+            BOOST_CHECK_EQUAL(metric(serving, "p2p_block_range_blocks_total", "direction", "sent"), 0);
+            BOOST_CHECK_GT(metric(syncing, "p2p_messages_received_total", "type", "block_range_message_type"), 0);
+            BOOST_CHECK_GE(metric(syncing, "p2p_messages_received_total", "type", "block_message_type"), 30);
+            BOOST_CHECK_EQUAL(syncing.p2p->get_connection_count(), 1);
+        }
+
+        BOOST_TEST_MESSAGE("A peer sending a block range that wasn't requested is disconnected");
+        {
+            struct closing_delegate : public message_oriented_connection_delegate {
+                fc::promise<closing_connection_message>::ptr closing{new fc::promise<closing_connection_message>("closing message received")};
+
+                void on_message(message_oriented_connection *, const message &received_message) override {
+                    if (received_message.msg_type == closing_connection_message::type && !closing->ready()) {
+                        closing->set_value(received_message.as<closing_connection_message>());
+                    }
+                }
+
+                void on_connection_closed(message_oriented_connection *) override {
+                }
+            };
+
+            memory_chain_node receiving;
+            receiving.blocks = extend_chain(std::vector<signed_block>(), 10, "alice");
+            receiving.start();
+
+            closing_delegate delegate;
+            message_oriented_connection sending(&delegate);
+            sending.connect_to(receiving.p2p->get_actual_listening_endpoint());
+
+            block_range_message unrequested(receiving.blocks.front().id(), true);
+            unrequested.packed_blocks.push_back(fc::raw::pack(receiving.blocks.front()));
+            sending.send_message(message(unrequested));
+
+            closing_connection_message closing = delegate.closing->wait(fc::seconds(10));
+            BOOST_CHECK_EQUAL(closing.reason_for_closing, "You sent me a block range that I didn't ask for");
+            sending.close_connection();
+            sending.destroy_connection();
+        }
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
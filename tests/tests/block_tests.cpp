@@ -498,6 +498,93 @@ BOOST_AUTO_TEST_SUITE(block_tests)
         } FC_LOG_AND_RETHROW()
     }
 
+    BOOST_FIXTURE_TEST_CASE(push_transaction_batch, clean_database_fixture) {
+        try {
+            generate_block();
+            ACTOR(bob);
+
+            auto make_transfer = [&](const std::string &from, const std::string &memo) {
+                signed_transaction tx;
+                transfer_operation t;
+                t.from = from;
+                t.to = from == "bob" ? STEEMIT_INIT_MINER_NAME : "bob";
+                t.amount = asset(1000, STEEM_SYMBOL);
+                t.memo = memo;
+                tx.operations.push_back(t);
+                tx.set_expiration(db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+                return tx;
+            };
+
+            std::vector<signed_transaction> batch;
+            batch.push_back(make_transfer(STEEMIT_INIT_MINER_NAME, "first"));
+            batch.back().sign(init_account_priv_key, db.get_chain_id());
+            batch.push_back(batch.back());
+            batch.push_back(make_transfer("bob", "unsigned"));
+            batch.push_back(make_transfer(STEEMIT_INIT_MINER_NAME, "second"));
+            batch.back().sign(init_account_priv_key, db.get_chain_id());
+
+            BOOST_TEST_MESSAGE("Verify that rejected transactions don't stop the batch");
+            auto errors = db.push_transactions(batch);
+            BOOST_REQUIRE_EQUAL(errors.size(), batch.size());
+            BOOST_CHECK(!errors[0]);
+            BOOST_CHECK(errors[1]);
+            BOOST_CHECK(errors[2]);
+            BOOST_CHECK(!errors[3]);
+            BOOST_CHECK_EQUAL(db.get_balance("bob", STEEM_SYMBOL).amount.value, 2000);
+
+            generate_block();
+            BOOST_CHECK_EQUAL(db.get_balance("bob", STEEM_SYMBOL).amount.value, 2000);
+
+            BOOST_TEST_MESSAGE("Verify that recovered keys are checked against the authorities instead of the signatures");
+            std::vector<signed_transaction> recovered_batch;
+            recovered_batch.push_back(make_transfer(STEEMIT_INIT_MINER_NAME, "recovered"));
+            recovered_batch.back().sign(init_account_priv_key, db.get_chain_id());
+            recovered_batch.push_back(make_transfer(STEEMIT_INIT_MINER_NAME, "wrong keys"));
+            recovered_batch.back().sign(init_account_priv_key, db.get_chain_id());
+
+            std::vector<flat_set<public_key_type>> signature_keys;
+            signature_keys.push_back(recovered_batch[0].get_signature_keys(db.get_chain_id()));
+            signature_keys.push_back({bob_public_key});
+
+            errors = db.push_transactions(recovered_batch, signature_keys);
+            BOOST_REQUIRE_EQUAL(errors.size(), recovered_batch.size());
+            BOOST_CHECK(!errors[0]);
+            BOOST_CHECK(errors[1]);
+            BOOST_CHECK_EQUAL(db.get_balance("bob", STEEM_SYMBOL).amount.value, 3000);
+        } FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_FIXTURE_TEST_CASE(read_packed_blocks, clean_database_fixture) {
+        try {
+            while (db.get_dynamic_global_properties().last_irreversible_block_num < 20) {
+                generate_block();
+            }
+            uint32_t last_irreversible = db.get_dynamic_global_properties().last_irreversible_block_num;
+
+            BOOST_TEST_MESSAGE("Verify that packed blocks are the irreversible blocks in order");
+            auto packed = db.fetch_packed_blocks(3, 10, std::numeric_limits<uint64_t>::max());
+            BOOST_REQUIRE_EQUAL(packed.size(), 10u);
+            for (size_t i = 0; i < packed.size(); ++i) {
+                auto block = fc::raw::unpack<signed_block>(packed[i]);
+                BOOST_CHECK_EQUAL(block.block_num(), 3 + i);
+                BOOST_CHECK(block.id() == db.get_block_id_for_num(3 + i));
+            }
+
+            BOOST_TEST_MESSAGE("Verify that the byte limit cuts the result, but not below one block");
+            auto limited = db.fetch_packed_blocks(3, 10, packed[0].size() + packed[1].size());
+            BOOST_REQUIRE_EQUAL(limited.size(), 2u);
+            BOOST_CHECK(limited[1] == packed[1]);
+            BOOST_CHECK_EQUAL(db.fetch_packed_blocks(3, 10, 0).size(), 1u);
+
+            BOOST_TEST_MESSAGE("Verify that only blocks in the block log are returned");
+            auto tail = db.fetch_packed_blocks(last_irreversible - 1, 10, std::numeric_limits<uint64_t>::max());
+            BOOST_REQUIRE(!tail.empty());
+            BOOST_CHECK(tail.size() <= 2);
+            BOOST_CHECK(db.fetch_packed_blocks(db.head_block_num() + 1, 10, std::numeric_limits<uint64_t>::max()).empty());
+            BOOST_CHECK(db.fetch_packed_blocks(0, 10, std::numeric_limits<uint64_t>::max()).empty());
+        } FC_LOG_AND_RETHROW()
+    }
+
     BOOST_FIXTURE_TEST_CASE(pop_block_twice, clean_database_fixture) {
         try {
             uint32_t skip_flags = (
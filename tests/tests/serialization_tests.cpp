@@ -28,6 +28,8 @@
 #include <steemit/chain/steem_objects.hpp>
 #include <steemit/chain/database.hpp>
 
+#include <graphene/net/message.hpp>
+
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/elliptic.hpp>
 #include <fc/reflect/variant.hpp>
@@ -309,5 +311,47 @@ BOOST_FIXTURE_TEST_SUITE(serialization_tests, clean_database_fixture)
         FC_LOG_AND_RETHROW();
     }
 
+    BOOST_AUTO_TEST_CASE(compact_block_message_test) {
+        try {
+            signed_block block;
+            block.timestamp = STEEMIT_GENESIS_TIME;
+            block.witness = STEEMIT_INIT_MINER_NAME;
+            for (int i = 1; i <= 3; i++) {
+                transfer_operation op;
+                op.from = STEEMIT_INIT_MINER_NAME;
+                op.to = "bob";
+                op.amount = asset(i, STEEM_SYMBOL);
+
+                signed_transaction tx;
+                tx.operations.push_back(op);
+                tx.set_expiration(block.timestamp + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+                block.transactions.push_back(tx);
+            }
+            block.transaction_merkle_root = block.calculate_merkle_root();
+
+            graphene::net::message full_message(graphene::net::block_message(block));
+            graphene::net::compact_block_message compact(full_message.as<graphene::net::block_message>(), full_message.id());
+            BOOST_REQUIRE(compact.short_transaction_ids.size() == 3);
+            BOOST_REQUIRE(compact.short_transaction_ids[1] ==
+                          graphene::net::compact_block_message::short_transaction_id(block.transactions[1].id()));
+
+            graphene::net::message compact_message(compact);
+            BOOST_CHECK(compact_message.size < full_message.size);
+
+            auto unpacked = compact_message.as<graphene::net::compact_block_message>();
+            graphene::net::message rebuilt(unpacked.to_block_message(block.transactions));
+            BOOST_REQUIRE(rebuilt.id() == unpacked.block_message_hash);
+
+            auto reordered = block.transactions;
+            std::swap(reordered[0], reordered[2]);
+            graphene::net::message wrong(unpacked.to_block_message(reordered));
+            BOOST_REQUIRE(wrong.id() != unpacked.block_message_hash);
+
+            reordered.pop_back();
+            STEEMIT_REQUIRE_THROW(unpacked.to_block_message(reordered), fc::exception);
+        }
+        FC_LOG_AND_RETHROW();
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif